@@ -43,8 +43,10 @@
 #include "libavutil/fifo.h"
 #include "libavutil/intreadwrite.h"
 #include "libavutil/pixdesc.h"
+#include "libavutil/imgutils.h"
 #include "libavutil/avstring.h"
 #include "libavutil/libm.h"
+#include "libavutil/profile.h"
 #include "libavformat/os_support.h"
 
 #include "libavformat/ffm.h" // not public API
@@ -208,6 +210,8 @@ static int64_t input_ts_offset = 0;
 static int file_overwrite = 0;
 static AVMetadata *metadata;
 static int do_benchmark = 0;
+static int do_profile = 0;
+static int use_mem_pool = 0;
 static int do_hex_dump = 0;
 static int do_pkt_dump = 0;
 static int do_psnr = 0;
@@ -282,6 +286,7 @@ typedef struct AVOutputStream
     //double sync_ipts;        /* dts from the AVPacket of the demuxer in second units */
     struct AVInputStream *sync_ist; /* input stream to sync against */
     int64_t sync_opts;       /* output frame counter, could be changed to some true timestamp */ //FIXME look at frame_number
+    int64_t wallclock_offset; /* recovered input wallclock at sync_ipts 0, see get_sync_wallclock() */
     AVBitStreamFilterContext *bitstream_filters;
     /* video only */
     int video_resample;
@@ -796,6 +801,37 @@ static int read_ffserver_streams(AVFormatContext *s, const char *filename)
     return 0;
 }
 
+/* sections of the transcoding loop timed with -profile_sections */
+enum ProfileSection
+{
+    PROF_DEMUX,
+    PROF_DECODE_AUDIO,
+    PROF_DECODE_VIDEO,
+    PROF_FILTER,
+    PROF_SCALE,
+    PROF_ENCODE_AUDIO,
+    PROF_ENCODE_VIDEO,
+    PROF_MUX,
+    PROF_NB
+};
+
+static const char *const prof_names[PROF_NB] =
+{
+    "demux", "decode audio", "decode video", "filter",
+    "scale", "encode audio", "encode video", "mux",
+};
+
+static int prof_scopes[PROF_NB];
+
+static void init_profile(void)
+{
+    int i;
+
+    for (i = 0; i < PROF_NB; i++)
+        prof_scopes[i] = av_profile_register(prof_names[i]);
+    av_profile_enable(do_profile);
+}
+
 static double
 get_sync_ipts(const AVOutputStream *ost)
 {
@@ -803,9 +839,33 @@ get_sync_ipts(const AVOutputStream *ost)
     return (double)(ist->pts - start_time) / AV_TIME_BASE;
 }
 
+/* Like get_sync_ipts(), but on the local clock when the input recovers the
+   sender clock: the dup/drop decisions then follow the jitter-free arrival
+   times, so that a sender clock drifting from the local one is compensated. */
+static double
+get_sync_wallclock(AVOutputStream *ost)
+{
+    const AVInputStream *ist = ost->sync_ist;
+    AVFormatContext *ic = input_files[ist->file_index];
+    double sync_ipts = get_sync_ipts(ost);
+    int64_t ts, wallclock;
+
+    if (!(ic->flags & AVFMT_FLAG_CLOCK_RECOVERY))
+        return sync_ipts;
+    ts = av_rescale_q(ist->pts - input_files_ts_offset[ist->file_index],
+                      AV_TIME_BASE_Q, ist->st->time_base);
+    wallclock = av_get_input_wallclock(ic, ist->st->index, ts);
+    if (wallclock == AV_NOPTS_VALUE)
+        return sync_ipts;
+    if (ost->wallclock_offset == AV_NOPTS_VALUE)
+        ost->wallclock_offset = wallclock - llrint(sync_ipts * AV_TIME_BASE);
+    return (double)(wallclock - ost->wallclock_offset) / AV_TIME_BASE;
+}
+
 static void write_frame(AVFormatContext *s, AVPacket *pkt, AVCodecContext *avctx, AVBitStreamFilterContext *bsfc)
 {
     int ret;
+    AVProfileTimer ptimer;
 
     while(bsfc)
     {
@@ -833,7 +893,9 @@ static void write_frame(AVFormatContext *s, AVPacket *pkt, AVCodecContext *avctx
         bsfc = bsfc->next;
     }
 
+    av_profile_begin(&ptimer);
     ret = av_interleaved_write_frame(s, pkt);
+    av_profile_end(prof_scopes[PROF_MUX], &ptimer);
     if(ret < 0)
     {
         print_error("av_interleaved_write_frame()", ret);
@@ -853,6 +915,7 @@ static void do_audio_out(AVFormatContext *s,
     int64_t allocated_for_size = size;
 
     int size_out, frame_bytes, ret, resample_changed;
+    AVProfileTimer ptimer;
     AVCodecContext *enc = ost->st->codec;
     AVCodecContext *dec = ist->st->codec;
     int osize = av_get_bits_per_sample_fmt(enc->sample_fmt) / 8;
@@ -1063,8 +1126,10 @@ need_realloc:
 
             //FIXME pass ost->sync_opts as AVFrame.pts in avcodec_encode_audio()
 
+            av_profile_begin(&ptimer);
             ret = avcodec_encode_audio(enc, audio_out, audio_out_size,
                                        (short *)audio_buf);
+            av_profile_end(prof_scopes[PROF_ENCODE_AUDIO], &ptimer);
             if (ret < 0)
             {
                 fprintf(stderr, "Audio encoding failed\n");
@@ -1102,8 +1167,10 @@ need_realloc:
         }
 
         //FIXME pass ost->sync_opts as AVFrame.pts in avcodec_encode_audio()
+        av_profile_begin(&ptimer);
         ret = avcodec_encode_audio(enc, audio_out, size_out,
                                    (short *)buftmp);
+        av_profile_end(prof_scopes[PROF_ENCODE_AUDIO], &ptimer);
         if (ret < 0)
         {
             fprintf(stderr, "Audio encoding failed\n");
@@ -1132,16 +1199,12 @@ static void pre_process_video_frame(AVInputStream *ist, AVPicture *picture, void
     /* deinterlace : must be done before any resize */
     if (do_deinterlace)
     {
-        int size;
-
         /* create temporary picture */
-        size = avpicture_get_size(dec->pix_fmt, dec->width, dec->height);
-        buf = av_malloc(size);
-        if (!buf)
-            return;
-
         picture2 = &picture_tmp;
-        avpicture_fill(picture2, buf, dec->pix_fmt, dec->width, dec->height);
+        if (av_image_alloc(picture2->data, picture2->linesize,
+                           dec->width, dec->height, dec->pix_fmt, 16) < 0)
+            return;
+        buf = picture2->data[0];
 
         if(avpicture_deinterlace(picture2, picture,
                                  dec->pix_fmt, dec->width, dec->height) < 0)
@@ -1250,11 +1313,13 @@ static void do_video_out(AVFormatContext *s,
     AVFrame *final_picture, *formatted_picture, *resampling_dst, *padding_src;
     AVCodecContext *enc, *dec;
     double sync_ipts;
+    AVProfileTimer ptimer;
 
     enc = ost->st->codec;
     dec = ist->st->codec;
 
-    sync_ipts = get_sync_ipts(ost) / av_q2d(enc->time_base);
+    sync_ipts = (video_sync_method ? get_sync_wallclock(ost) : get_sync_ipts(ost)) /
+                av_q2d(enc->time_base);
 
     /* by default, we output a single frame */
     nb_frames = 1;
@@ -1341,8 +1406,10 @@ static void do_video_out(AVFormatContext *s,
                 ffmpeg_exit(1);
             }
         }
+        av_profile_begin(&ptimer);
         sws_scale(ost->img_resample_ctx, formatted_picture->data, formatted_picture->linesize,
                   0, ost->resample_height, resampling_dst->data, resampling_dst->linesize);
+        av_profile_end(prof_scopes[PROF_SCALE], &ptimer);
     }
 #endif
 
@@ -1399,9 +1466,11 @@ static void do_video_out(AVFormatContext *s,
                 big_picture.pict_type = FF_I_TYPE;
                 ost->forced_kf_index++;
             }
+            av_profile_begin(&ptimer);
             ret = avcodec_encode_video(enc,
                                        bit_buffer, bit_buffer_size,
                                        &big_picture);
+            av_profile_end(prof_scopes[PROF_ENCODE_VIDEO], &ptimer);
             if (ret < 0)
             {
                 fprintf(stderr, "Video encoding failed\n");
@@ -1598,6 +1667,11 @@ static void print_report(AVFormatContext **output_files,
             snprintf(buf + strlen(buf), sizeof(buf) - strlen(buf), " dup=%d drop=%d",
                      nb_frames_dup, nb_frames_drop);
 
+        for (i = 0; i < nb_input_files; i++)
+            if (input_files[i]->flags & AVFMT_FLAG_CLOCK_RECOVERY)
+                snprintf(buf + strlen(buf), sizeof(buf) - strlen(buf), " drift=%+.0fppm",
+                         av_get_input_clock_drift(input_files[i]));
+
         if (verbose >= 0)
             fprintf(stderr, "%s    \r", buf);
 
@@ -1639,6 +1713,7 @@ static int output_packet(AVInputStream *ist, int ist_index,
     static unsigned int samples_size = 0;
     AVSubtitle subtitle, *subtitle_to_free;
     int64_t pkt_pts = AV_NOPTS_VALUE;
+    AVProfileTimer ptimer;
 #if CONFIG_AVFILTER
     int frame_available;
 #endif
@@ -1703,8 +1778,10 @@ handle_eof:
                 decoded_data_size = samples_size;
                 /* XXX: could avoid copy if PCM 16 bits with same
                    endianness as CPU */
+                av_profile_begin(&ptimer);
                 ret = avcodec_decode_audio3(ist->st->codec, samples, &decoded_data_size,
                                             &avpkt);
+                av_profile_end(prof_scopes[PROF_DECODE_AUDIO], &ptimer);
                 if (ret < 0)
                     goto fail_decode;
                 avpkt.data += ret;
@@ -1730,8 +1807,10 @@ handle_eof:
                 avpkt.dts = ist->pts;
                 pkt_pts = AV_NOPTS_VALUE;
 
+                av_profile_begin(&ptimer);
                 ret = avcodec_decode_video2(ist->st->codec,
                                             &picture, &got_picture, &avpkt);
+                av_profile_end(prof_scopes[PROF_DECODE_VIDEO], &ptimer);
                 ist->st->quality = picture.quality;
                 if (ret < 0)
                     goto fail_decode;
@@ -1858,7 +1937,11 @@ handle_eof:
                     {
                         AVRational ist_pts_tb;
                         if (ist->st->codec->codec_type == AVMEDIA_TYPE_VIDEO && ost->output_video_filter)
+                        {
+                            av_profile_begin(&ptimer);
                             get_filtered_video_frame(ost->output_video_filter, &picture, &ost->picref, &ist_pts_tb);
+                            av_profile_end(prof_scopes[PROF_FILTER], &ptimer);
+                        }
                         if (ost->picref)
                             ist->pts = av_rescale_q(ost->picref->pts, ist_pts_tb, AV_TIME_BASE_Q);
 #endif
@@ -2174,6 +2257,7 @@ static int transcode(AVFormatContext **output_files,
     char error[1024];
     int key;
     int want_sdp = 1;
+    AVProfileTimer ptimer;
     uint8_t no_packet[MAX_FILES] = {0};
     int no_packet_count = 0;
     int nb_frame_threshold[AVMEDIA_TYPE_NB] = {0};
@@ -2409,6 +2493,7 @@ static int transcode(AVFormatContext **output_files,
             ost->sync_ist = (nb_stream_maps > 0) ?
                             ist_table[file_table[stream_maps[n].sync_file_index].ist_index +
                                       stream_maps[n].sync_stream_index] : ist;
+            ost->wallclock_offset = AV_NOPTS_VALUE;
         }
     }
 
@@ -2951,7 +3036,9 @@ redo:
 
         /* read a frame from it and output it in the fifo */
         is = input_files[file_index];
+        av_profile_begin(&ptimer);
         ret = av_read_frame(is, &pkt);
+        av_profile_end(prof_scopes[PROF_DEMUX], &ptimer);
         if(ret == AVERROR(EAGAIN))
         {
             no_packet[file_index] = 1;
@@ -4789,6 +4876,14 @@ static const OptionDef options[] =
         "benchmark", OPT_BOOL | OPT_EXPERT, {(void *)&do_benchmark},
         "add timings for benchmarking"
     },
+    {
+        "profile_sections", OPT_BOOL | OPT_EXPERT, {(void *)&do_profile},
+        "print the time spent demuxing, decoding, filtering, scaling, encoding and muxing"
+    },
+    {
+        "mem_pool", OPT_BOOL | OPT_EXPERT, {(void *)&use_mem_pool},
+        "serve small allocations from per-thread pools"
+    },
     { "timelimit", OPT_FUNC2 | HAS_ARG, {(void *)opt_timelimit}, "set max runtime in seconds", "limit" },
     {
         "dump", OPT_BOOL | OPT_EXPERT, {(void *)&do_pkt_dump},
@@ -4968,6 +5063,13 @@ int main(int argc, char **argv)
         ffmpeg_exit(1);
     }
 
+    init_profile();
+#if CONFIG_MEM_POOL
+    av_mem_pool_enable(use_mem_pool);
+#else
+    if (use_mem_pool && verbose >= 0)
+        fprintf(stderr, "Warning: not compiled with --enable-mem-pool, -mem_pool is ignored\n");
+#endif
     ti = getutime();
     if (transcode(output_files, nb_output_files, input_files, nb_input_files,
                   stream_maps, nb_stream_maps) < 0)
@@ -4977,7 +5079,11 @@ int main(int argc, char **argv)
     {
         int maxrss = getmaxrss() / 1024;
         printf("bench: utime=%0.3fs maxrss=%ikB\n", ti / 1000000.0, maxrss);
+        if (use_mem_pool)
+            av_mem_pool_dump(NULL, AV_LOG_INFO);
     }
+    if (do_profile)
+        av_profile_dump(NULL, AV_LOG_INFO);
 
     return ffmpeg_exit(0);
 }
@@ -27,6 +27,7 @@
 
 #include "libavutil/avstring.h"
 #include "libavutil/libm.h"
+#include "libavutil/sampleconv.h"
 #include "libavutil/samplefmt.h"
 #include "avcodec.h"
 #include "audioconvert.h"
@@ -82,6 +83,8 @@ int avcodec_channel_layout_num_channels(int64_t channel_layout)
 struct AVAudioConvert {
     int in_channels, out_channels;
     int fmt_pair;
+    enum AVSampleFormat in_fmt, out_fmt;
+    AVSampleConv *conv[4];  ///< by AV_SAMPLE_CONV_PLANAR_* flags, allocated on first use
 };
 
 AVAudioConvert *av_audio_convert_alloc(enum AVSampleFormat out_fmt, int out_channels,
@@ -97,21 +100,67 @@ AVAudioConvert *av_audio_convert_alloc(enum AVSampleFormat out_fmt, int out_chan
     ctx->in_channels = in_channels;
     ctx->out_channels = out_channels;
     ctx->fmt_pair = out_fmt + AV_SAMPLE_FMT_NB*in_fmt;
+    ctx->in_fmt  = in_fmt;
+    ctx->out_fmt = out_fmt;
+    memset(ctx->conv, 0, sizeof(ctx->conv));
     return ctx;
 }
 
 void av_audio_convert_free(AVAudioConvert *ctx)
 {
+    int i;
+
+    if (!ctx)
+        return;
+    for (i = 0; i < FF_ARRAY_ELEMS(ctx->conv); i++)
+        av_sample_conv_freep(&ctx->conv[i]);
     av_free(ctx);
 }
 
+/**
+ * @return 0 if the channels are interleaved in ptr[0], 1 if each has its
+ *         own contiguous buffer, -1 for any other arrangement
+ */
+static int get_packing(const void * const ptr[6], const int stride[6],
+                       int channels, int bps)
+{
+    int ch, packed = 1, planar = 1;
+
+    for (ch = 0; ch < channels; ch++) {
+        if (!ptr[ch])
+            return -1;
+        packed &= stride[ch] == channels * bps &&
+                  (const uint8_t *)ptr[ch] == (const uint8_t *)ptr[0] + ch * bps;
+        planar &= stride[ch] == bps;
+    }
+    return packed ? 0 : planar ? 1 : -1;
+}
+
 int av_audio_convert(AVAudioConvert *ctx,
                            void * const out[6], const int out_stride[6],
                      const void * const  in[6], const int  in_stride[6], int len)
 {
-    int ch;
-
-    //FIXME optimize common cases
+    int ch, in_packing, out_packing;
+
+    in_packing  = get_packing(in,  in_stride,  ctx->in_channels,
+                              av_get_bits_per_sample_fmt(ctx->in_fmt)  >> 3);
+    out_packing = get_packing((const void * const *)out, out_stride, ctx->out_channels,
+                              av_get_bits_per_sample_fmt(ctx->out_fmt) >> 3);
+    if (in_packing >= 0 && out_packing >= 0 && ctx->in_channels <= 6) {
+        int planar = in_packing  * AV_SAMPLE_CONV_PLANAR_IN |
+                     out_packing * AV_SAMPLE_CONV_PLANAR_OUT;
+        /* same channel count on both sides, so any layout of that many
+         * channels makes the converter copy the channels through */
+        int64_t layout = (1 << ctx->in_channels) - 1;
+
+        if (!ctx->conv[planar])
+            ctx->conv[planar] = av_sample_conv_alloc(ctx->out_fmt, layout,
+                                                     ctx->in_fmt,  layout,
+                                                     planar, NULL, 0);
+        if (ctx->conv[planar])
+            return av_sample_conv(ctx->conv[planar], (uint8_t * const *)out,
+                                  (const uint8_t * const *)in, len);
+    }
 
     for(ch=0; ch<ctx->out_channels; ch++){
         const int is=  in_stride[ch];
@@ -608,7 +608,7 @@ typedef struct RcOverride{
                                                   location instead of only at frame boundaries. */
 #define CODEC_FLAG_NORMALIZE_AQP  0x00020000 ///< Normalize adaptive quantization.
 #define CODEC_FLAG_INTERLACED_DCT 0x00040000 ///< Use interlaced DCT.
-#define CODEC_FLAG_LOW_DELAY      0x00080000 ///< Force low delay.
+#define CODEC_FLAG_LOW_DELAY      0x00080000 ///< Force low delay, also selects slice instead of frame threads.
 #define CODEC_FLAG_ALT_SCAN       0x00100000 ///< Use alternate scan.
 #define CODEC_FLAG_GLOBAL_HEADER  0x00400000 ///< Place global headers in extradata instead of every keyframe.
 #define CODEC_FLAG_BITEXACT       0x00800000 ///< Use only bitexact stuff (except (I)DCT).
@@ -646,6 +646,7 @@ typedef struct RcOverride{
 #define CODEC_FLAG2_PSY           0x00080000 ///< Use psycho visual optimizations.
 #define CODEC_FLAG2_SSIM          0x00100000 ///< Compute SSIM during encoding, error[] values are undefined.
 #define CODEC_FLAG2_INTRA_REFRESH 0x00200000 ///< Use periodic insertion of intra blocks instead of keyframes.
+#define CODEC_FLAG2_LOW_MEMORY    0x00400000 ///< Reduce the memory footprint of the decoder, possibly at some speed cost (H.264).
 
 /* Unsupported options :
  *              Syntax Arithmetic coding (SAC)
@@ -3014,6 +3015,13 @@ typedef struct AVCodec {
      */
     int (*update_thread_context)(AVCodecContext *dst, const AVCodecContext *src);
     /** @} */
+
+    /**
+     * Return the number of bytes held by the codec for its private context
+     * and tables, not counting buffers obtained with get_buffer().
+     * Optional, see avcodec_get_memory_usage().
+     */
+    int64_t (*memory_usage)(AVCodecContext *);
 } AVCodec;
 
 /**
@@ -3359,6 +3367,47 @@ FFMPEGLIB_API int av_resample(struct AVResampleContext *c, short *dst, short *sr
 FFMPEGLIB_API void av_resample_compensate(struct AVResampleContext *c, int sample_delta, int compensation_distance);
 FFMPEGLIB_API void av_resample_close(struct AVResampleContext *c);
 
+/* resampler.c */
+
+typedef struct AVResampler AVResampler;
+
+/**
+ * Initialize a resampler of planar float samples.
+ * Unlike av_resample(), it keeps the input samples it still needs itself,
+ * so each call can be given only the new samples.
+ * @param channels number of channels, all filtered with the same phases
+ * @param filter_length length of each FIR filter in the filterbank relative to the cutoff freq
+ * @param log2_phase_count log2 of the maximum number of entries in the polyphase filterbank;
+ *                         fewer are used if they give the exact phase of every output
+ * @param cutoff cutoff frequency, 1.0 corresponds to half the output sampling rate
+ * @param cpu_flags AV_CPU_FLAG_* flags of the filter kernels that may be used, in addition
+ *                  to those of av_get_cpu_flags() and to SSE on targets that always have
+ *                  it, unless AV_CPU_FLAG_FORCE is set
+ * @return the resampler or NULL on error
+ */
+FFMPEGLIB_API AVResampler *av_resampler_init(int out_rate, int in_rate, int channels,
+                                             int filter_length, int log2_phase_count,
+                                             double cutoff, int cpu_flags);
+
+/**
+ * @return the number of samples per channel that av_resampler_process()
+ *         outputs for in_samples new input samples
+ */
+FFMPEGLIB_API int av_resampler_get_out_samples(AVResampler *r, int in_samples);
+
+/**
+ * Resample planar float samples. All of src is consumed.
+ * @param dst one array per channel
+ * @param dst_size space in samples available in each dst array, at least
+ *                 av_resampler_get_out_samples(r, src_size)
+ * @param src one array per channel, or NULL to flush the samples still
+ *            buffered by padding the input with silence
+ * @return the number of samples written per channel or a negative error code
+ */
+FFMPEGLIB_API int av_resampler_process(AVResampler *r, float * const *dst, int dst_size,
+                                       const float * const *src, int src_size);
+FFMPEGLIB_API void av_resampler_close(AVResampler *r);
+
 /**
  * Allocate memory for a picture.  Call avpicture_free() to free it.
  *
@@ -4016,6 +4065,28 @@ FFMPEGLIB_API void avcodec_flush_buffers(AVCodecContext *avctx);
 
 FFMPEGLIB_API void avcodec_default_free_buffers(AVCodecContext *s);
 
+/**
+ * Return the memory currently held by a codec context, summed over its
+ * frame threads. This counts the buffers allocated by the default
+ * get_buffer(), including released ones kept for reuse, and the private
+ * tables of codecs that report them (H.264). Buffers from a user supplied
+ * get_buffer() are not counted. With frame threads the value is a snapshot
+ * taken while the threads may still be decoding.
+ *
+ * @return size in bytes
+ */
+FFMPEGLIB_API int64_t avcodec_get_memory_usage(AVCodecContext *avctx);
+
+/**
+ * Return the number of frames a decoder currently holds back, that is
+ * has_b_frames. With frame threads this includes one frame per additional
+ * thread, which the threading code adds to has_b_frames.
+ * With CODEC_FLAG_LOW_DELAY set before avcodec_open() this is 0 for
+ * streams that do not reorder pictures, e.g. H.264 streams signalling
+ * num_reorder_frames = 0 or using POC type 2.
+ */
+FFMPEGLIB_API int avcodec_get_latency(AVCodecContext *avctx);
+
 /* misc useful functions */
 
 /**
@@ -341,3 +341,253 @@ void free_vlc(VLC *vlc)
     av_freep(&vlc->table);
 }
 
+#ifdef TEST
+#include <stdio.h>
+#include "libavutil/lfg.h"
+#include "golomb.h"
+#undef printf
+
+#define NB_SEQUENCES 20000
+#define MAX_OPS      64
+#define BUF_SIZE     (MAX_OPS * 32)
+
+enum { OP_BITS, OP_SHOW, OP_BIT1, OP_LONG, OP_SBITS, OP_XBITS, OP_UE, OP_SE,
+       OP_VLC, OP_SKIP, OP_REWIND, OP_ALIGN, NB_OPS };
+
+typedef struct Op {
+    int type, n;
+    int value;
+} Op;
+
+static void ref_put(uint8_t *buf, int *pos, int n, uint32_t v)
+{
+    while (n--) {
+        if ((v >> n) & 1)
+            buf[*pos >> 3] |= 0x80 >> (*pos & 7);
+        (*pos)++;
+    }
+}
+
+static uint32_t ref_get(const uint8_t *buf, int pos, int n)
+{
+    uint32_t v = 0;
+
+    while (n--) {
+        v = v << 1 | ((buf[pos >> 3] >> (7 - (pos & 7))) & 1);
+        pos++;
+    }
+    return v;
+}
+
+/* unary VLC: symbol i < 18 is i zeros and a one, symbol 18 is 18 zeros */
+#define VLC_SYMBOLS 19
+static VLC vlc;
+
+static void init_unary_vlc(void)
+{
+    uint8_t  bits[VLC_SYMBOLS];
+    uint32_t codes[VLC_SYMBOLS];
+    int i;
+
+    for (i = 0; i < VLC_SYMBOLS; i++) {
+        bits[i]  = FFMIN(i + 1, VLC_SYMBOLS - 1);
+        codes[i] = i < VLC_SYMBOLS - 1;
+    }
+    init_vlc(&vlc, 6, VLC_SYMBOLS, bits, 1, 1, codes, 4, 4, 0);
+}
+
+/**
+ * Fill ops with random operations and write them with both the writer
+ * and the reference, expected values are stored in the ops.
+ * @return the number of bits written, or -1 if the writers disagree
+ */
+static int write_sequence(AVLFG *prng, Op *ops, int nb_ops, uint8_t *buf, uint8_t *ref)
+{
+    PutBitContext pb;
+    int i, pos = 0;
+
+    memset(ref, 0, BUF_SIZE);
+    init_put_bits(&pb, buf, BUF_SIZE);
+    for (i = 0; i < nb_ops; i++) {
+        Op *op = &ops[i];
+        unsigned r = av_lfg_get(prng);
+
+        op->type = av_lfg_get(prng) % NB_OPS;
+        switch (op->type) {
+        case OP_BITS:
+        case OP_SHOW:
+        case OP_XBITS:
+            op->n     = r % 25 + 1;
+            op->value = av_lfg_get(prng) & ((1U << op->n) - 1);
+            put_bits(&pb, op->n, op->value);
+            ref_put(ref, &pos, op->n, op->value);
+            break;
+        case OP_BIT1:
+            op->n     = 1;
+            op->value = r & 1;
+            put_bits(&pb, 1, op->value);
+            ref_put(ref, &pos, 1, op->value);
+            break;
+        case OP_LONG:
+            op->n     = r % 32 + 1;
+            op->value = av_lfg_get(prng) & (0xFFFFFFFFU >> (32 - op->n));
+            if (op->n > 16) {
+                put_bits(&pb, op->n - 16, (unsigned)op->value >> 16);
+                put_bits(&pb, 16, op->value & 0xFFFF);
+            } else
+                put_bits(&pb, op->n, op->value);
+            ref_put(ref, &pos, op->n, op->value);
+            break;
+        case OP_SBITS:
+            op->n     = r % 25 + 1;
+            op->value = (int)(av_lfg_get(prng) << (32 - op->n)) >> (32 - op->n);
+            put_sbits(&pb, op->n, op->value);
+            ref_put(ref, &pos, op->n, op->value & ((1U << op->n) - 1));
+            break;
+        case OP_UE:
+            /* small values are the common case, codes are at most 25 bits
+             * as get_ue_golomb() reads them with a single show_bits */
+            op->value = r & 1 ? av_lfg_get(prng) % 16 : av_lfg_get(prng) % 8191;
+            set_ue_golomb(&pb, op->value);
+            op->n = 2 * av_log2(op->value + 1) + 1;
+            ref_put(ref, &pos, op->n, op->value + 1);
+            break;
+        case OP_SE:
+            op->value = (int)(av_lfg_get(prng) % 8191) - 4095;
+            set_se_golomb(&pb, op->value);
+            {
+                int u = op->value > 0 ? 2 * op->value - 1 : -2 * op->value;
+                op->n = 2 * av_log2(u + 1) + 1;
+                ref_put(ref, &pos, op->n, u + 1);
+            }
+            break;
+        case OP_VLC:
+            op->value = r % VLC_SYMBOLS;
+            op->n     = FFMIN(op->value + 1, VLC_SYMBOLS - 1);
+            put_bits(&pb, op->n, op->value < VLC_SYMBOLS - 1);
+            ref_put(ref, &pos, op->n, op->value < VLC_SYMBOLS - 1);
+            break;
+        case OP_SKIP:
+            op->n = r % 200;
+            for (op->value = op->n; op->value > 0; op->value -= 16) {
+                unsigned v = av_lfg_get(prng) & 0xFFFF;
+                int n = FFMIN(op->value, 16);
+                put_bits(&pb, n, v >> (16 - n));
+                ref_put(ref, &pos, n, v >> (16 - n));
+            }
+            break;
+        case OP_REWIND:
+            /* read side only: go back up to 32 bits and read them again */
+            op->n = FFMIN(pos, r % 32 + 1);
+            break;
+        case OP_ALIGN:
+            op->n = -pos & 7;
+            align_put_bits(&pb);
+            pos += op->n;
+            break;
+        }
+        if (put_bits_count(&pb) != pos) {
+            printf("writer at %d bits after op %d of type %d, expected %d\n",
+                   put_bits_count(&pb), i, op->type, pos);
+            return -1;
+        }
+    }
+    flush_put_bits(&pb);
+    if (memcmp(buf, ref, (pos + 7) >> 3)) {
+        printf("writer output differs from the reference\n");
+        return -1;
+    }
+    return pos;
+}
+
+/**
+ * Read the ops back, checking the values and the bit position after each.
+ * @return 0 on success
+ */
+static int read_sequence(const Op *ops, int nb_ops, const uint8_t *buf, int size)
+{
+    GetBitContext gb;
+    int i, pos = 0;
+
+    init_get_bits(&gb, buf, size);
+    for (i = 0; i < nb_ops; i++) {
+        const Op *op = &ops[i];
+        int v = op->value, expected = op->value;
+
+        switch (op->type) {
+        case OP_BITS:  v = get_bits(&gb, op->n); break;
+        case OP_SHOW:  v = show_bits(&gb, op->n); skip_bits(&gb, op->n); break;
+        case OP_BIT1:  v = get_bits1(&gb); break;
+        case OP_LONG:
+            if (op->n & 1)
+                v = get_bits_long(&gb, op->n);
+            else {
+                v = show_bits_long(&gb, op->n);
+                skip_bits_long(&gb, op->n);
+            }
+            break;
+        case OP_SBITS: v = get_sbits(&gb, op->n); break;
+        case OP_XBITS:
+            v = get_xbits(&gb, op->n);
+            if (!(op->value >> (op->n - 1)))
+                expected = op->value - (1 << op->n) + 1;
+            break;
+        case OP_UE:    v = get_ue_golomb(&gb); break;
+        case OP_SE:    v = get_se_golomb(&gb); break;
+        case OP_VLC:   v = get_vlc2(&gb, vlc.table, 6, 3); break;
+        case OP_SKIP:
+            if (op->n < 25)
+                skip_bits(&gb, op->n);
+            else
+                skip_bits_long(&gb, op->n);
+            break;
+        case OP_REWIND:
+            skip_bits_long(&gb, -op->n);
+            expected = ref_get(buf, pos - op->n, op->n);
+            v = op->n ? get_bits_long(&gb, op->n) : 0;
+            break;
+        case OP_ALIGN: align_get_bits(&gb); break;
+        }
+        if (op->type != OP_REWIND)
+            pos += op->n;
+        if (v != expected || get_bits_count(&gb) != pos) {
+            printf("op %d of type %d, %d bits: read %d at %d, expected %d at %d\n",
+                   i, op->type, op->n, v, get_bits_count(&gb), expected, pos);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int main(void)
+{
+    static uint8_t buf[BUF_SIZE + FF_INPUT_BUFFER_PADDING_SIZE], ref[BUF_SIZE];
+    static Op ops[MAX_OPS];
+    AVLFG prng;
+    int i;
+
+    av_lfg_init(&prng, 1);
+    init_unary_vlc();
+
+    for (i = 0; i < NB_SEQUENCES; i++) {
+        int nb_ops = av_lfg_get(&prng) % MAX_OPS + 1;
+        int size   = write_sequence(&prng, ops, nb_ops, buf, ref);
+
+        if (size < 0 || read_sequence(ops, nb_ops, buf, size)) {
+            printf("sequence %d failed\n", i);
+            return 1;
+        }
+    }
+    free_vlc(&vlc);
+
+#if defined(CACHED_BITSTREAM_READER)
+    printf("cached reader: ");
+#elif defined(A32_BITSTREAM_READER)
+    printf("A32 reader: ");
+#else
+    printf("ALT reader: ");
+#endif
+    printf("%d sequences ok\n", NB_SEQUENCES);
+    return 0;
+}
+#endif
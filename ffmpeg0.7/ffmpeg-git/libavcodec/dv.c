@@ -37,6 +37,7 @@
  * @file
  * DV codec.
  */
+/* dv_decode_ac() uses re_index and re_cache directly */
 #define ALT_BITSTREAM_READER
 #include "avcodec.h"
 #include "dsputil.h"
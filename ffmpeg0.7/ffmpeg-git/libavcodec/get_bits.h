@@ -39,9 +39,15 @@
 #   define ALT_BITSTREAM_READER
 #endif
 
-#if !defined(A32_BITSTREAM_READER) && !defined(ALT_BITSTREAM_READER)
+/* Files that access the reader state directly (re_index, re_cache, as dv.c
+ * does) define the reader they are written for before including this file.
+ * A GetBitContext must only be passed between files using the same reader. */
+#if !defined(A32_BITSTREAM_READER) && !defined(ALT_BITSTREAM_READER) && \
+    !defined(CACHED_BITSTREAM_READER)
 #   if ARCH_ARM && !HAVE_FAST_UNALIGNED
 #       define A32_BITSTREAM_READER
+#   elif HAVE_FAST_64BIT
+#       define CACHED_BITSTREAM_READER
 #   else
 #       define ALT_BITSTREAM_READER
 //#define A32_BITSTREAM_READER
@@ -59,6 +65,10 @@ typedef struct GetBitContext {
     uint32_t cache0;
     uint32_t cache1;
     int bit_count;
+#elif defined CACHED_BITSTREAM_READER
+    int index;                  ///< bit position of the next 32 bits to load, a multiple of 8
+    int bits_left;              ///< valid bits in cache, negative if more were skipped
+    uint64_t cache;             ///< next bits of the stream, MSB first
 #endif
     int size_in_bits;
 } GetBitContext;
@@ -95,7 +105,7 @@ UPDATE_CACHE(name, gb)
     after this call at least MIN_CACHE_BITS will be available,
 
 GET_CACHE(name, gb)
-    will output the contents of the internal cache, next bit is MSB of 32 or 64 bit (FIXME 64bit)
+    will output the contents of the internal cache, next bit is MSB of 32 bit
 
 SHOW_UBITS(name, gb, num)
     will return the next num bits
@@ -119,6 +129,10 @@ LAST_SKIP_CACHE(name, gb, num)
 LAST_SKIP_BITS(name, gb, num)
     is equivalent to LAST_SKIP_CACHE; SKIP_COUNTER
 
+REFILL_CACHE(name, gb, num)
+    makes sure the next num bits (at most MIN_CACHE_BITS) are in the cache;
+    cheaper than UPDATE_CACHE for readers which know how full their cache is
+
 for examples see get_bits, show_bits, skip_bits, get_vlc
 */
 
@@ -246,6 +260,88 @@ static inline void skip_bits_long(GetBitContext *s, int n){
     CLOSE_READER(re, s);
 }
 
+#elif defined CACHED_BITSTREAM_READER
+
+/* The cache holds up to 63 bits and is refilled 32 bits at a time, so a
+ * refill only happens every few reads and the bit position is the count of
+ * loaded bits minus the cached ones. */
+#   define MIN_CACHE_BITS 32
+
+#   define OPEN_READER(name, gb)                        \
+    unsigned int name##_index     = (gb)->index;        \
+    int          name##_bits_left = (gb)->bits_left;    \
+    uint64_t     name##_cache     = (gb)->cache
+
+#   define CLOSE_READER(name, gb) do {          \
+        (gb)->index     = name##_index;         \
+        (gb)->bits_left = name##_bits_left;     \
+        (gb)->cache     = name##_cache;         \
+    } while (0)
+
+#   define REFILL_CACHE(name, gb, num) do {                             \
+        if (name##_bits_left < (num)) {                                 \
+            if (name##_bits_left >= 0) {                                \
+                name##_cache |= (uint64_t)AV_RB32((gb)->buffer + (name##_index >> 3)) \
+                                << (32 - name##_bits_left);             \
+                name##_index     += 32;                                 \
+                name##_bits_left += 32;                                 \
+            } else {                                                    \
+                /* damaged data made the caller skip past the cache */  \
+                name##_index    -= name##_bits_left;                    \
+                name##_cache     = (uint64_t)AV_RB32((gb)->buffer + (name##_index >> 3)) \
+                                   << 32 << (name##_index & 7);         \
+                name##_bits_left = 32 - (name##_index & 7);             \
+                name##_index     = (name##_index & ~7) + 32;            \
+            }                                                           \
+        }                                                               \
+    } while (0)
+
+#   define UPDATE_CACHE(name, gb) REFILL_CACHE(name, gb, 32)
+
+#   define SKIP_CACHE(name, gb, num) name##_cache <<= (num)
+
+#   define SKIP_COUNTER(name, gb, num) name##_bits_left -= (num)
+
+#   define SKIP_BITS(name, gb, num) do {        \
+        SKIP_CACHE(name, gb, num);              \
+        SKIP_COUNTER(name, gb, num);            \
+    } while (0)
+
+#   define LAST_SKIP_BITS(name, gb, num)  SKIP_BITS(name, gb, num)
+#   define LAST_SKIP_CACHE(name, gb, num) SKIP_CACHE(name, gb, num)
+
+#   define SHOW_UBITS(name, gb, num) ((unsigned int)(name##_cache >> (64 - (num))))
+
+#   define SHOW_SBITS(name, gb, num) ((int)((int64_t)name##_cache >> (64 - (num))))
+
+#   define GET_CACHE(name, gb) ((uint32_t)(name##_cache >> 32))
+
+static inline int get_bits_count(const GetBitContext *s){
+    return s->index - s->bits_left;
+}
+
+/**
+ * Skip n bits, n may be negative. Skipping 0 bits reloads the cache from
+ * the buffer, for callers which modify the data after the read position.
+ */
+static inline void skip_bits_long(GetBitContext *s, int n){
+    int pos = get_bits_count(s) + n;
+
+    if (n > 0 && n < s->bits_left) {
+        s->cache    <<= n;
+        s->bits_left -= n;
+        return;
+    }
+    s->index     = pos & ~7;
+    s->cache     = (uint64_t)AV_RB32(s->buffer + (s->index >> 3)) << 32 << (pos & 7);
+    s->index    += 32;
+    s->bits_left = 32 - (pos & 7);
+}
+
+#endif
+
+#ifndef REFILL_CACHE
+#   define REFILL_CACHE(name, gb, num) UPDATE_CACHE(name, gb)
 #endif
 
 /**
@@ -406,6 +502,10 @@ static inline void init_get_bits(GetBitContext *s,
     s->buffer_ptr   = (uint32_t*)((intptr_t)buffer & ~3);
     s->bit_count    = 32 +     8*((intptr_t)buffer &  3);
     skip_bits_long(s, 0);
+#elif defined CACHED_BITSTREAM_READER
+    s->index        = 0;
+    s->bits_left    = 0;
+    s->cache        = 0;
 #endif
 }
 
@@ -457,18 +557,17 @@ void free_vlc(VLC *vlc);
                                                                 \
         if (max_depth > 1 && n < 0) {                           \
             LAST_SKIP_BITS(name, gb, bits);                     \
-            UPDATE_CACHE(name, gb);                             \
-                                                                \
             nb_bits = -n;                                       \
+            REFILL_CACHE(name, gb, nb_bits);                    \
                                                                 \
             index = SHOW_UBITS(name, gb, nb_bits) + code;       \
             code  = table[index][0];                            \
             n     = table[index][1];                            \
             if (max_depth > 2 && n < 0) {                       \
                 LAST_SKIP_BITS(name, gb, nb_bits);              \
-                UPDATE_CACHE(name, gb);                         \
-                                                                \
                 nb_bits = -n;                                   \
+                REFILL_CACHE(name, gb, nb_bits);                \
+                                                                \
                                                                 \
                 index = SHOW_UBITS(name, gb, nb_bits) + code;   \
                 code  = table[index][0];                        \
@@ -488,11 +587,11 @@ void free_vlc(VLC *vlc);
                                                                         \
         if (max_depth > 1 && n < 0) {                                   \
             SKIP_BITS(name, gb, bits);                                  \
+            nb_bits = -n;                                               \
             if (need_update) {                                          \
-                UPDATE_CACHE(name, gb);                                 \
+                REFILL_CACHE(name, gb, nb_bits);                        \
             }                                                           \
                                                                         \
-            nb_bits = -n;                                               \
                                                                         \
             index = SHOW_UBITS(name, gb, nb_bits) + level;              \
             level = table[index].level;                                 \
@@ -36,6 +36,7 @@
 #include "golomb.h"
 #include "mathops.h"
 #include "rectangle.h"
+#include "startcode.h"
 #include "thread.h"
 #include "vdpau_internal.h"
 #include "libavutil/avassert.h"
@@ -144,7 +145,7 @@ int ff_h264_check_intra_pred_mode(H264Context *h, int mode){
 }
 
 const uint8_t *ff_h264_decode_nal(H264Context *h, const uint8_t *src, int *dst_length, int *consumed, int length){
-    int i, si, di;
+    int i, si, di, n;
     uint8_t *dst;
     int bufidx;
 
@@ -158,25 +159,8 @@ const uint8_t *ff_h264_decode_nal(H264Context *h, const uint8_t *src, int *dst_l
         printf("%2X ", src[i]);
 #endif
 
-#if HAVE_FAST_UNALIGNED
-# if HAVE_FAST_64BIT
-#   define RS 7
-    for(i=0; i+1<length; i+=9){
-        if(!((~AV_RN64A(src+i) & (AV_RN64A(src+i) - 0x0100010001000101ULL)) & 0x8000800080008080ULL))
-# else
-#   define RS 3
-    for(i=0; i+1<length; i+=5){
-        if(!((~AV_RN32A(src+i) & (AV_RN32A(src+i) - 0x01000101U)) & 0x80008080U))
-# endif
-            continue;
-        if(i>0 && !src[i]) i--;
-        while(src[i]) i++;
-#else
-#   define RS 0
-    for(i=0; i+1<length; i+=2){
-        if(src[i]) continue;
-        if(i>0 && src[i-1]==0) i--;
-#endif
+    for(i=0; i+2<length; i++){
+        i+= ff_startcode_find_candidate(src + i, length - i - 2);
         if(i+2<length && src[i+1]==0 && src[i+2]<=3){
             if(src[i+2]!=3){
                 /* startcode, so we must be past the end */
@@ -184,10 +168,9 @@ const uint8_t *ff_h264_decode_nal(H264Context *h, const uint8_t *src, int *dst_l
             }
             break;
         }
-        i-= RS;
     }
 
-    if(i>=length-1){ //no escaped 0
+    if(i+2>=length){ //no escaped 0
         *dst_length= length;
         *consumed= length+1; //+1 for the header
         return src;
@@ -206,10 +189,7 @@ const uint8_t *ff_h264_decode_nal(H264Context *h, const uint8_t *src, int *dst_l
     si=di=i;
     while(si+2<length){
         //remove escapes (very rare 1:2^22)
-        if(src[si+2]>3){
-            dst[di++]= src[si++];
-            dst[di++]= src[si++];
-        }else if(src[si]==0 && src[si+1]==0){
+        if(src[si]==0 && src[si+1]==0 && src[si+2]<=3){
             if(src[si+2]==3){ //escape
                 dst[di++]= 0;
                 dst[di++]= 0;
@@ -219,7 +199,11 @@ const uint8_t *ff_h264_decode_nal(H264Context *h, const uint8_t *src, int *dst_l
                 goto nsc;
         }
 
-        dst[di++]= src[si++];
+        /* copy up to the next pair of zero bytes */
+        n= ff_startcode_find_candidate(src + si + 1, length - si - 3) + 1;
+        memcpy(dst + di, src + si, n);
+        si+= n;
+        di+= n;
     }
     while(si<length)
         dst[di++]= src[si++];
@@ -331,8 +315,13 @@ static void free_tables(H264Context *h, int free_rbsp){
     h->slice_table= NULL;
     av_freep(&h->list_counts);
 
-    av_freep(&h->mb2b_xy);
-    av_freep(&h->mb2br_xy);
+    if(!h->s.avctx->is_copy){
+        av_freep(&h->mb2b_xy);
+        av_freep(&h->mb2br_xy);
+    }else{
+        h->mb2b_xy = NULL;
+        h->mb2br_xy= NULL;
+    }
 
     for(i = 0; i < MAX_THREADS; i++) {
         hx = h->thread_context[i];
@@ -415,10 +404,22 @@ static void init_dequant_tables(H264Context *h){
 }
 
 
+/**
+ * Number of macroblocks in the row based tables, two rows for each slice
+ * thread context. Frame threads each decode a single slice at a time.
+ */
+static int get_row_mb_num(H264Context *h){
+    MpegEncContext * const s = &h->s;
+
+    if(HAVE_THREADS && (s->avctx->active_thread_type&FF_THREAD_SLICE))
+        return 2*s->mb_stride*s->avctx->thread_count;
+    return 2*s->mb_stride;
+}
+
 int ff_h264_alloc_tables(H264Context *h){
     MpegEncContext * const s = &h->s;
     const int big_mb_num= s->mb_stride * (s->mb_height+1);
-    const int row_mb_num= 2*s->mb_stride*s->avctx->thread_count;
+    const int row_mb_num= get_row_mb_num(h);
     int x,y;
 
     FF_ALLOCZ_OR_GOTO(h->s.avctx, h->intra4x4_pred_mode, row_mb_num * 8  * sizeof(uint8_t), fail)
@@ -436,6 +437,9 @@ int ff_h264_alloc_tables(H264Context *h){
     memset(h->slice_table_base, -1, (big_mb_num+s->mb_stride)  * sizeof(*h->slice_table_base));
     h->slice_table= h->slice_table_base + s->mb_stride*2 + 1;
 
+    /* These only depend on the dimensions, frame thread copies use the
+     * ones of the first context, which frees them. */
+    if(!s->avctx->is_copy){
     FF_ALLOCZ_OR_GOTO(h->s.avctx, h->mb2b_xy  , big_mb_num * sizeof(uint32_t), fail);
     FF_ALLOCZ_OR_GOTO(h->s.avctx, h->mb2br_xy , big_mb_num * sizeof(uint32_t), fail);
     for(y=0; y<s->mb_height; y++){
@@ -447,6 +451,7 @@ int ff_h264_alloc_tables(H264Context *h){
             h->mb2br_xy[mb_xy]= 8*(FMO ? mb_xy : (mb_xy % (2*s->mb_stride)));
         }
     }
+    }
 
     s->obmc_scratchpad = NULL;
 
@@ -586,6 +591,11 @@ av_cold int ff_h264_decode_init(AVCodecContext *avctx){
 
     avctx->chroma_sample_location = AVCHROMA_LOC_LEFT;
 
+    /* allocate frames without the edges drawn around reference frames,
+     * motion compensation emulates them instead */
+    if(avctx->flags2 & CODEC_FLAG2_LOW_MEMORY)
+        avctx->flags |= CODEC_FLAG_EMU_EDGE;
+
     ff_h264_decode_init_vlc();
 
     h->sps.bit_depth_luma = avctx->bits_per_raw_sample = 8;
@@ -881,10 +891,29 @@ static void decode_postinit(H264Context *h){
         }
     }
 
+    if (s->avctx->skip_frame >= AVDISCARD_NONKEY) {
+        /* Only intra pictures are decoded; they are returned in coding order
+         * as soon as they are complete, so a seek yields a frame at once. */
+        h->next_output_pic   = cur;
+        h->next_outputed_poc  = cur->poc;
+        cur->owner2 = s;
+        ff_thread_finish_setup(s->avctx);
+        return;
+    }
+
     //FIXME do something with unavailable reference frames
 
     /* Sort B-frames into display order */
 
+    /* In low delay mode the stream's reorder depth overrides a larger delay
+     * set by the container or the user, as long as nothing is queued. */
+    if((s->flags & CODEC_FLAG_LOW_DELAY) && !h->delayed_pic[0]
+       && h->sps.bitstream_restriction_flag
+       && s->avctx->has_b_frames > h->sps.num_reorder_frames){
+        s->avctx->has_b_frames = h->sps.num_reorder_frames;
+        s->low_delay = !h->sps.num_reorder_frames;
+    }
+
     if(h->sps.bitstream_restriction_flag
        && s->avctx->has_b_frames < h->sps.num_reorder_frames){
         s->avctx->has_b_frames = h->sps.num_reorder_frames;
@@ -917,7 +946,9 @@ static void decode_postinit(H264Context *h){
         h->next_outputed_poc= INT_MIN;
     out_of_order = out->poc < h->next_outputed_poc;
 
-    if(h->sps.bitstream_restriction_flag && s->avctx->has_b_frames >= h->sps.num_reorder_frames)
+    /* POC type 2 pictures are output in decoding order, never delay them */
+    if((h->sps.bitstream_restriction_flag && s->avctx->has_b_frames >= h->sps.num_reorder_frames)
+       || h->sps.poc_type == 2)
         { }
     else if((out_of_order && pics-1 == s->avctx->has_b_frames && s->avctx->has_b_frames < MAX_DELAYED_PIC_COUNT)
        || (s->low_delay &&
@@ -1743,6 +1774,20 @@ static void clone_slice(H264Context *dst, H264Context *src)
     memcpy(dst->dequant8_coeff,   src->dequant8_coeff,   sizeof(src->dequant8_coeff));
 }
 
+/**
+ * Number of pictures the decoder may hold at once with the active SPS in low
+ * memory mode: the reference frames, one more while a frame over the limit
+ * is discarded, the pictures waiting for output, the current picture and
+ * the last output one.
+ */
+static int dpb_size(H264Context *h){
+    int delay = MAX_DELAYED_PIC_COUNT;
+
+    if(h->sps.bitstream_restriction_flag && h->s.avctx->strict_std_compliance < FF_COMPLIANCE_STRICT)
+        delay = FFMAX(h->sps.num_reorder_frames, h->s.avctx->has_b_frames);
+    return FFMIN(FFMAX(h->sps.ref_frame_count, 1) + FFMAX(delay, 1) + 3, MAX_PICTURE_COUNT);
+}
+
 /**
  * computes profile from profile_idc and constraint_set?_flags
  *
@@ -1871,9 +1916,12 @@ static int decode_slice_header(H264Context *h, H264Context *h0){
 
     if (s->context_initialized
         && (   s->width != s->avctx->width || s->height != s->avctx->height
-            || av_cmp_q(h->sps.sar, s->avctx->sample_aspect_ratio))) {
-        if(h != h0) {
-            av_log_missing_feature(s->avctx, "Width/height changing with threads is", 0);
+            || av_cmp_q(h->sps.sar, s->avctx->sample_aspect_ratio)
+            || ((s->avctx->flags2 & CODEC_FLAG2_LOW_MEMORY)
+                && dpb_size(h) > s->picture_range_end - s->picture_range_start))) {
+        /* frame threads share tables and pictures of the first context */
+        if(h != h0 || (s->avctx->active_thread_type&FF_THREAD_FRAME)) {
+            av_log_missing_feature(s->avctx, "Width/height or DPB size changing with threads is", 0);
             return -1;   // width / height changed during parallelized decoding
         }
         free_tables(h, 0);
@@ -1925,6 +1973,9 @@ static int decode_slice_header(H264Context *h, H264Context *h0){
 
         s->avctx->hwaccel = ff_find_hwaccel(s->avctx->codec->id, s->avctx->pix_fmt);
 
+        s->picture_range_end = s->picture_range_start +
+            (s->avctx->flags2 & CODEC_FLAG2_LOW_MEMORY ? dpb_size(h) : MAX_PICTURE_COUNT);
+
         if (MPV_common_init(s) < 0){
             av_log(h->s.avctx, AV_LOG_ERROR, "MPV_common_init() failed\n");
             return -1;
@@ -1979,6 +2030,10 @@ static int decode_slice_header(H264Context *h, H264Context *h0){
     h->mb_field_decoding_flag= s->picture_structure != PICT_FRAME;
 
     if(h0->current_slice == 0){
+        /* Skipped non-intra frames are not missing, do not conceal them. */
+        if(s->avctx->skip_frame >= AVDISCARD_NONKEY && h->frame_num != h->prev_frame_num)
+            h->prev_frame_num = (h->frame_num - 1) & ((1<<h->sps.log2_max_frame_num) - 1);
+
         if(h->frame_num != h->prev_frame_num &&
           (h->prev_frame_num+1)%(1<<h->sps.log2_max_frame_num) < (h->frame_num - h->sps.ref_frame_count))
             h->prev_frame_num = h->frame_num - h->sps.ref_frame_count - 1;
@@ -2886,6 +2941,21 @@ static void execute_decode_slices(H264Context *h, int context_count){
 }
 
 
+/**
+ * Peek at the slice header of a slice NAL unit.
+ * @return 1 if it is an I or SI slice, or if its type is invalid so that
+ *         decode_slice_header() reports it
+ */
+static int is_intra_slice(const uint8_t *buf, int bit_length){
+    GetBitContext gb;
+    unsigned int slice_type;
+
+    init_get_bits(&gb, buf, bit_length);
+    get_ue_golomb(&gb); // first_mb_in_slice
+    slice_type= get_ue_golomb_31(&gb);
+    return slice_type > 9 || (golomb_to_pict_type[slice_type % 5] & 3) == FF_I_TYPE;
+}
+
 static int decode_nal_units(H264Context *h, const uint8_t *buf, int buf_size){
     MpegEncContext * const s = &h->s;
     AVCodecContext * const avctx= s->avctx;
@@ -2975,6 +3045,12 @@ static int decode_nal_units(H264Context *h, const uint8_t *buf, int buf_size){
            (avctx->skip_frame >= AVDISCARD_NONREF && h->nal_ref_idc  == 0))
             continue;
 
+        /* Drop non-intra slices before their header is parsed and a frame
+         * is allocated for them. */
+        if(avctx->skip_frame >= AVDISCARD_NONKEY && hx->nal_unit_type == NAL_SLICE
+           && !is_intra_slice(ptr, bit_length))
+            continue;
+
       again:
         err = 0;
         switch(hx->nal_unit_type){
@@ -3149,6 +3225,9 @@ static int decode_frame(AVCodecContext *avctx,
     AVFrame *pict = data;
     int buf_index;
 
+    /* frame threads get the user flags again for every packet */
+    if(avctx->flags2 & CODEC_FLAG2_LOW_MEMORY)
+        avctx->flags |= CODEC_FLAG_EMU_EDGE;
     s->flags= avctx->flags;
     s->flags2= avctx->flags2;
 
@@ -3431,6 +3510,38 @@ av_cold void ff_h264_free_context(H264Context *h)
         av_freep(h->pps_buffers + i);
 }
 
+static int64_t decode_memory_usage(AVCodecContext *avctx)
+{
+    H264Context *h = avctx->priv_data;
+    MpegEncContext *s = &h->s;
+    const int big_mb_num = s->mb_stride * (s->mb_height+1);
+    int64_t size = sizeof(H264Context);
+    int i;
+
+    if (!s->context_initialized)
+        return size;
+
+    /* tables allocated by ff_h264_alloc_tables() */
+    size += (8 + 2*16) * get_row_mb_num(h)
+          + (big_mb_num + s->mb_stride) * sizeof(*h->slice_table_base)
+          + big_mb_num * (32 + sizeof(uint16_t) + 1 + 4 + 1);
+    if (!avctx->is_copy)
+        size += 2 * big_mb_num * sizeof(uint32_t);
+
+    for (i = 0; i < MAX_THREADS; i++) {
+        H264Context *hx = h->thread_context[i];
+        if (!hx)
+            continue;
+        if (i)
+            size += sizeof(H264Context);
+        if (hx->top_borders[0])
+            size += 2 * s->mb_width * (16+8+8) * 2;
+        size += hx->rbsp_buffer_size[0] + hx->rbsp_buffer_size[1];
+    }
+
+    return size + ff_picture_memory_usage(s);
+}
+
 av_cold int ff_h264_decode_end(AVCodecContext *avctx)
 {
     H264Context *h = avctx->priv_data;
@@ -3477,6 +3588,7 @@ AVCodec ff_h264_decoder = {
     .init_thread_copy      = ONLY_IF_THREADS_ENABLED(decode_init_thread_copy),
     .update_thread_context = ONLY_IF_THREADS_ENABLED(decode_update_thread_context),
     .profiles = NULL_IF_CONFIG_SMALL(profiles),
+    .memory_usage = decode_memory_usage,
 };
 
 #if CONFIG_H264_VDPAU_DECODER
@@ -50,4 +50,10 @@ FFMPEGLIB_API int ff_match_2uint16(const uint16_t (*tab)[2], int size, int a, in
 
 FFMPEGLIB_API unsigned int ff_toupper4(unsigned int x);
 
+/**
+ * Return the memory held by a single codec context, see
+ * avcodec_get_memory_usage().
+ */
+FFMPEGLIB_API int64_t ff_get_memory_usage(AVCodecContext *avctx);
+
 #endif /* AVCODEC_INTERNAL_H */
@@ -27,18 +27,17 @@
 
 
 int ff_mpeg4_find_frame_end(ParseContext *pc, const uint8_t *buf, int buf_size){
-    int vop_found, i;
+    const uint8_t *p= buf, *end= buf + buf_size;
+    int vop_found;
     uint32_t state;
 
     vop_found= pc->frame_start_found;
     state= pc->state;
 
-    i=0;
     if(!vop_found){
-        for(i=0; i<buf_size; i++){
-            state= (state<<8) | buf[i];
+        while(p < end){
+            p= ff_find_start_code(p, end, &state);
             if(state == 0x1B6){
-                i++;
                 vop_found=1;
                 break;
             }
@@ -49,12 +48,12 @@ int ff_mpeg4_find_frame_end(ParseContext *pc, const uint8_t *buf, int buf_size){
         /* EOF considered as end of frame */
         if (buf_size == 0)
             return 0;
-        for(; i<buf_size; i++){
-            state= (state<<8) | buf[i];
+        while(p < end){
+            p= ff_find_start_code(p, end, &state);
             if((state&0xFFFFFF00) == 0x100){
                 pc->frame_start_found=0;
                 pc->state=-1;
-                return i-3;
+                return p - buf - 4;
             }
         }
     }
@@ -122,36 +122,6 @@ const enum PixelFormat ff_hwaccel_pixfmt_list_420[] = {
     PIX_FMT_NONE
 };
 
-const uint8_t *ff_find_start_code(const uint8_t * restrict p, const uint8_t *end, uint32_t * restrict state){
-    int i;
-
-    assert(p<=end);
-    if(p>=end)
-        return end;
-
-    for(i=0; i<3; i++){
-        uint32_t tmp= *state << 8;
-        *state= tmp + *(p++);
-        if(tmp == 0x100 || p==end)
-            return p;
-    }
-
-    while(p<end){
-        if     (p[-1] > 1      ) p+= 3;
-        else if(p[-2]          ) p+= 2;
-        else if(p[-3]|(p[-1]-1)) p++;
-        else{
-            p++;
-            break;
-        }
-    }
-
-    p= FFMIN(p, end)-4;
-    *state= AV_RB32(p);
-
-    return p+4;
-}
-
 /* init common dct for both encoder and decoder */
 av_cold int ff_dct_common_init(MpegEncContext *s)
 {
@@ -325,6 +295,35 @@ fail: //for the FF_ALLOCZ_OR_GOTO macro
     return -1;
 }
 
+int64_t ff_picture_memory_usage(MpegEncContext *s){
+    const int big_mb_num= s->mb_stride*(s->mb_height+1) + 1;
+    const int mb_array_size= s->mb_stride*s->mb_height;
+    const int b8_array_size= s->b8_stride*s->mb_height*2;
+    const int b4_array_size= s->b4_stride*s->mb_height*4;
+    int64_t size;
+    int i;
+
+    if(!s->picture)
+        return 0;
+
+    size= s->picture_count * sizeof(Picture);
+    for(i=s->picture_range_start; i<s->picture_range_end; i++){
+        const Picture *pic= &s->picture[i];
+
+        if(!pic->qscale_table)
+            continue;
+        size += 2*mb_array_size + 2 + (big_mb_num + s->mb_stride) * sizeof(uint32_t) + sizeof(AVPanScan);
+        if(pic->mb_var)
+            size += 5*mb_array_size;
+        if(pic->motion_val_base[0])
+            size += 2 * (2 * ((pic->motion_subsample_log2 == 2 ? b4_array_size : b8_array_size) + 4) * sizeof(int16_t)
+                         + 4*mb_array_size);
+        if(pic->dct_coeff)
+            size += 64 * mb_array_size * sizeof(DCTELEM)*6;
+    }
+    return size;
+}
+
 /**
  * deallocates a picture
  */
@@ -468,11 +467,14 @@ int ff_mpeg_update_thread_context(AVCodecContext *dst, const AVCodecContext *src
 
     //FIXME can parameters change on I-frames? in that case dst may need a reinit
     if(!s->context_initialized){
+        int range;
+
         memcpy(s, s1, sizeof(MpegEncContext));
 
+        range                    = s->picture_range_end - s->picture_range_start;
         s->avctx                 = dst;
-        s->picture_range_start  += MAX_PICTURE_COUNT;
-        s->picture_range_end    += MAX_PICTURE_COUNT;
+        s->picture_range_start  += range;
+        s->picture_range_end    += range;
         s->bitstream_buffer      = NULL;
         s->bitstream_buffer_size = s->allocated_bitstream_buffer_size = 0;
 
@@ -680,7 +682,7 @@ av_cold int MPV_common_init(MpegEncContext *s)
             FF_ALLOCZ_OR_GOTO(s->avctx, s->dct_offset, 2 * 64 * sizeof(uint16_t), fail)
         }
     }
-    s->picture_count = MAX_PICTURE_COUNT * FFMAX(1, s->avctx->thread_count);
+    s->picture_count = (s->picture_range_end - s->picture_range_start) * FFMAX(1, s->avctx->thread_count);
     FF_ALLOCZ_OR_GOTO(s->avctx, s->picture, s->picture_count * sizeof(Picture), fail)
     for(i = 0; i < s->picture_count; i++) {
         avcodec_get_frame_defaults((AVFrame *)&s->picture[i]);
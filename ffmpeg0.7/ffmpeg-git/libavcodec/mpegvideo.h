@@ -294,8 +294,8 @@ typedef struct MpegEncContext {
     Picture *last_picture_ptr;     ///< pointer to the previous picture.
     Picture *next_picture_ptr;     ///< pointer to the next picture (for bidir pred)
     Picture *current_picture_ptr;  ///< pointer to the current picture
-    int picture_count;             ///< number of allocated pictures (MAX_PICTURE_COUNT * avctx->thread_count)
-    int picture_range_start, picture_range_end; ///< the part of picture that this context can allocate in
+    int picture_count;             ///< number of allocated pictures (range size * avctx->thread_count)
+    int picture_range_start, picture_range_end; ///< the part of picture that this context can allocate in, the same size for every frame thread
     uint8_t *visualization_buffer[3]; //< temporary buffer vor MV visualization
     int last_dc[3];                ///< last DC values for MPEG1
     int16_t *dc_val_base;
@@ -740,6 +740,13 @@ FFMPEGLIB_API void ff_copy_picture(Picture *dst, Picture *src);
  */
 FFMPEGLIB_API int ff_alloc_picture(MpegEncContext *s, Picture *pic, int shared);
 
+/**
+ * Return the bytes allocated for the Picture array and for the tables
+ * ff_alloc_picture() attached to the pictures in this context's range,
+ * not counting the frame buffers.
+ */
+FFMPEGLIB_API int64_t ff_picture_memory_usage(MpegEncContext *s);
+
 extern const enum PixelFormat ff_pixfmt_list_420[];
 extern const enum PixelFormat ff_hwaccel_pixfmt_list_420[];
 
@@ -32,6 +32,7 @@
 #include <pthread.h>
 
 #include "avcodec.h"
+#include "internal.h"
 #include "thread.h"
 #pragma check_stack(off)
 #pragma comment(lib, "pthreadVC2.lib")
@@ -761,6 +762,22 @@ void ff_thread_flush(AVCodecContext *avctx)
     fctx->prev_thread = NULL;
 }
 
+int64_t ff_thread_memory_usage(AVCodecContext *avctx)
+{
+    FrameThreadContext *fctx = avctx->thread_opaque;
+    int64_t size = 0;
+    int i;
+
+    if (!fctx) return ff_get_memory_usage(avctx);
+
+    pthread_mutex_lock(&fctx->buffer_mutex);
+    for (i = 0; i < avctx->thread_count; i++)
+        size += ff_get_memory_usage(fctx->threads[i].avctx);
+    pthread_mutex_unlock(&fctx->buffer_mutex);
+
+    return size;
+}
+
 static int *allocate_progress(PerThreadContext *p)
 {
     int i;
@@ -880,7 +897,9 @@ static void validate_thread_parameters(AVCodecContext *avctx)
         avctx->active_thread_type = 0;
     } else if (frame_threading_supported && (avctx->thread_type & FF_THREAD_FRAME)) {
         avctx->active_thread_type = FF_THREAD_FRAME;
-    } else if (avctx->thread_type & FF_THREAD_SLICE) {
+    } else if (avctx->thread_type & FF_THREAD_SLICE || avctx->flags & CODEC_FLAG_LOW_DELAY) {
+        /* low delay callers get slice threads instead of the frame threads
+         * they may have asked for, which would delay every frame */
         avctx->active_thread_type = FF_THREAD_SLICE;
     }
 }
@@ -38,13 +38,31 @@
 //#define ALT_BITSTREAM_WRITER
 //#define ALIGNED_BITSTREAM_WRITER
 
+/* The bit buffer is flushed a whole word at a time, 64 bits where 64-bit
+ * arithmetic is fast. It must not depend on BITSTREAM_WRITER_LE, which is
+ * defined per file while the context may be shared. */
+#if HAVE_FAST_64BIT
+typedef uint64_t BitBuf;
+#   define AV_WBBUF AV_WB64
+#   define AV_WLBUF AV_WL64
+#   define av_be2neBUF av_be2ne64
+#   define av_le2neBUF av_le2ne64
+#else
+typedef uint32_t BitBuf;
+#   define AV_WBBUF AV_WB32
+#   define AV_WLBUF AV_WL32
+#   define av_be2neBUF av_be2ne32
+#   define av_le2neBUF av_le2ne32
+#endif
+#define BUF_BITS (8 * (int)sizeof(BitBuf))
+
 /* buf and buf_end must be present and used by every alternative writer. */
 typedef struct PutBitContext {
 #ifdef ALT_BITSTREAM_WRITER
     uint8_t *buf, *buf_end;
     int index;
 #else
-    uint32_t bit_buf;
+    BitBuf bit_buf;
     int bit_left;
     uint8_t *buf, *buf_ptr, *buf_end;
 #endif
@@ -73,7 +91,7 @@ static inline void init_put_bits(PutBitContext *s, uint8_t *buffer, int buffer_s
 //    memset(buffer, 0, buffer_size);
 #else
     s->buf_ptr = s->buf;
-    s->bit_left=32;
+    s->bit_left=BUF_BITS;
     s->bit_buf=0;
 #endif
 }
@@ -86,7 +104,7 @@ static inline int put_bits_count(PutBitContext *s)
 #ifdef ALT_BITSTREAM_WRITER
     return s->index;
 #else
-    return (s->buf_ptr - s->buf) * 8 + 32 - s->bit_left;
+    return (s->buf_ptr - s->buf) * 8 + BUF_BITS - s->bit_left;
 #endif
 }
 
@@ -99,20 +117,21 @@ static inline void flush_put_bits(PutBitContext *s)
     align_put_bits(s);
 #else
 #ifndef BITSTREAM_WRITER_LE
-    s->bit_buf<<= s->bit_left;
+    if (s->bit_left < BUF_BITS)
+        s->bit_buf<<= s->bit_left;
 #endif
-    while (s->bit_left < 32) {
+    while (s->bit_left < BUF_BITS) {
         /* XXX: should test end of buffer */
 #ifdef BITSTREAM_WRITER_LE
         *s->buf_ptr++=s->bit_buf;
         s->bit_buf>>=8;
 #else
-        *s->buf_ptr++=s->bit_buf >> 24;
+        *s->buf_ptr++=s->bit_buf >> (BUF_BITS - 8);
         s->bit_buf<<=8;
 #endif
         s->bit_left+=8;
     }
-    s->bit_left=32;
+    s->bit_left=BUF_BITS;
     s->bit_buf=0;
 #endif
 }
@@ -149,7 +168,7 @@ void ff_copy_bits(PutBitContext *pb, const uint8_t *src, int length);
 static inline void put_bits(PutBitContext *s, int n, unsigned int value)
 #ifndef ALT_BITSTREAM_WRITER
 {
-    unsigned int bit_buf;
+    BitBuf bit_buf;
     int bit_left;
 
     //    printf("put_bits=%d %x\n", n, value);
@@ -161,17 +180,17 @@ static inline void put_bits(PutBitContext *s, int n, unsigned int value)
     //    printf("n=%d value=%x cnt=%d buf=%x\n", n, value, bit_cnt, bit_buf);
     /* XXX: optimize */
 #ifdef BITSTREAM_WRITER_LE
-    bit_buf |= value << (32 - bit_left);
+    bit_buf |= (BitBuf)value << (BUF_BITS - bit_left);
     if (n >= bit_left) {
 #if !HAVE_FAST_UNALIGNED
-        if (3 & (intptr_t) s->buf_ptr) {
-            AV_WL32(s->buf_ptr, bit_buf);
+        if ((sizeof(BitBuf) - 1) & (intptr_t) s->buf_ptr) {
+            AV_WLBUF(s->buf_ptr, bit_buf);
         } else
 #endif
-        *(uint32_t *)s->buf_ptr = av_le2ne32(bit_buf);
-        s->buf_ptr+=4;
-        bit_buf = (bit_left==32)?0:value >> bit_left;
-        bit_left+=32;
+        *(BitBuf *)s->buf_ptr = av_le2neBUF(bit_buf);
+        s->buf_ptr+=sizeof(BitBuf);
+        bit_buf = (bit_left==BUF_BITS)?0:value >> bit_left;
+        bit_left+=BUF_BITS;
     }
     bit_left-=n;
 #else
@@ -182,14 +201,14 @@ static inline void put_bits(PutBitContext *s, int n, unsigned int value)
         bit_buf<<=bit_left;
         bit_buf |= value >> (n - bit_left);
 #if !HAVE_FAST_UNALIGNED
-        if (3 & (intptr_t) s->buf_ptr) {
-            AV_WB32(s->buf_ptr, bit_buf);
+        if ((sizeof(BitBuf) - 1) & (intptr_t) s->buf_ptr) {
+            AV_WBBUF(s->buf_ptr, bit_buf);
         } else
 #endif
-        *(uint32_t *)s->buf_ptr = av_be2ne32(bit_buf);
+        *(BitBuf *)s->buf_ptr = av_be2neBUF(bit_buf);
         //printf("bitbuf = %08x\n", bit_buf);
-        s->buf_ptr+=4;
-        bit_left+=32 - n;
+        s->buf_ptr+=sizeof(BitBuf);
+        bit_left+=BUF_BITS - n;
         bit_buf = value;
     }
 #endif
@@ -309,7 +328,7 @@ static inline void skip_put_bytes(PutBitContext *s, int n)
         FIXME may need some cleaning of the buffer
         s->index += n<<3;
 #else
-        assert(s->bit_left==32);
+        assert(s->bit_left==BUF_BITS);
         s->buf_ptr += n;
 #endif
 }
@@ -325,8 +344,8 @@ static inline void skip_put_bits(PutBitContext *s, int n)
     s->index += n;
 #else
     s->bit_left -= n;
-    s->buf_ptr-= 4*(s->bit_left>>5);
-    s->bit_left &= 31;
+    s->buf_ptr-= (BUF_BITS >> 3)*(s->bit_left>>(BUF_BITS == 64 ? 6 : 5));
+    s->bit_left &= BUF_BITS - 1;
 #endif
 }
 
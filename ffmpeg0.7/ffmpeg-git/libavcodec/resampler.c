@@ -0,0 +1,298 @@
+/*
+ * planar float polyphase resampler
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * planar float polyphase resampler
+ *
+ * Output sample n is centered on input time n * in_rate / out_rate. The
+ * filter bank holds one filter per phase, i.e. fractional input position.
+ * When out_rate / gcd(in_rate, out_rate) phases fit in the requested phase
+ * count every output uses its exact phase, as for 44100 <-> 48000 Hz;
+ * otherwise the nearest of 2^log2_phase_count phases is used.
+ *
+ * Each channel keeps the input samples the next outputs still need, fewer
+ * than one filter length. Windows starting in this history are read from
+ * a buffer holding it followed by the start of the new input, all others
+ * directly from the caller's buffers.
+ */
+
+#include "libavutil/cpu.h"
+#include "libavutil/mathematics.h"
+#include "avcodec.h"
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define HAVE_SSE2_INTRINSICS 1
+#else
+#define HAVE_SSE2_INTRINSICS 0
+#endif
+
+#define KAISER_BETA 9
+
+typedef float (*DotFunc)(const float *src, const float *filter, int len);
+
+struct AVResampler {
+    int channels;
+    int filter_length;          ///< taps of each filter, a multiple of 8
+    int phase_count;
+    float *filter_bank;         ///< phase_count filters of filter_length taps
+
+    /* input advance per output sample, in samples, phases and 1/frac_den phase */
+    int step_samples, step_phase, step_frac, frac_den;
+    /* start of the next window, relative to the start of the history */
+    int pos, phase, frac;
+
+    int hist_len;
+    float **hist;               ///< per channel, history then start of the input
+    const float **silence;      ///< per channel, the padding used when flushing
+    float *silence_buf;         ///< zeroed buffer all the silence pointers share
+    DotFunc dot;
+};
+
+/**
+ * 0th order modified bessel function of the first kind.
+ */
+static double bessel(double x)
+{
+    double v = 1, lastv = 0, t = 1;
+    int i;
+
+    x = x * x / 4;
+    for (i = 1; v != lastv; i++) {
+        lastv = v;
+        t *= x / (i * i);
+        v += t;
+    }
+    return v;
+}
+
+/**
+ * Build the Kaiser windowed sinc filter bank, each filter normalized to
+ * unity gain.
+ */
+static void build_filter(float *filter, double factor, int tap_count, int phase_count)
+{
+    const int center = (tap_count - 1) / 2;
+    int ph, i;
+
+    for (ph = 0; ph < phase_count; ph++) {
+        double norm = 0;
+        for (i = 0; i < tap_count; i++) {
+            double x = M_PI * ((double)(i - center) - (double)ph / phase_count) * factor;
+            double w = 2.0 * x / (factor * tap_count * M_PI);
+            double y = x == 0 ? 1.0 : sin(x) / x;
+
+            y *= bessel(KAISER_BETA * sqrt(FFMAX(1 - w * w, 0)));
+            filter[ph * tap_count + i] = y;
+            norm += y;
+        }
+        for (i = 0; i < tap_count; i++)
+            filter[ph * tap_count + i] /= norm;
+    }
+}
+
+static float dot_c(const float *src, const float *filter, int len)
+{
+    float sum0 = 0, sum1 = 0;
+    int i;
+
+    for (i = 0; i < len; i += 2) {
+        sum0 += src[i    ] * filter[i    ];
+        sum1 += src[i + 1] * filter[i + 1];
+    }
+    return sum0 + sum1;
+}
+
+#if HAVE_SSE2_INTRINSICS
+static float dot_sse(const float *src, const float *filter, int len)
+{
+    __m128 a = _mm_setzero_ps(), b = _mm_setzero_ps();
+    int i;
+
+    for (i = 0; i < len; i += 8) {
+        a = _mm_add_ps(a, _mm_mul_ps(_mm_loadu_ps(src + i    ), _mm_load_ps(filter + i    )));
+        b = _mm_add_ps(b, _mm_mul_ps(_mm_loadu_ps(src + i + 4), _mm_load_ps(filter + i + 4)));
+    }
+    a = _mm_add_ps(a, b);
+    a = _mm_add_ps(a, _mm_movehl_ps(a, a));
+    a = _mm_add_ss(a, _mm_shuffle_ps(a, a, 1));
+    return _mm_cvtss_f32(a);
+}
+#endif
+
+AVResampler *av_resampler_init(int out_rate, int in_rate, int channels,
+                               int filter_length, int log2_phase_count,
+                               double cutoff, int cpu_flags)
+{
+    AVResampler *r;
+    double factor;
+    int g, in, out, center, ch;
+
+    if (out_rate <= 0 || in_rate <= 0 || channels <= 0 || filter_length <= 0 ||
+        log2_phase_count < 0 || log2_phase_count > 16 || cutoff <= 0)
+        return NULL;
+    if (!(r = av_mallocz(sizeof(*r))))
+        return NULL;
+    if (!(cpu_flags & AV_CPU_FLAG_FORCE)) {
+        cpu_flags |= av_get_cpu_flags();
+        /* the intrinsics are only compiled for targets where SSE2 is baseline */
+        if (HAVE_SSE2_INTRINSICS)
+            cpu_flags |= AV_CPU_FLAG_SSE;
+    }
+
+    g   = av_gcd(in_rate, out_rate);
+    in  = in_rate  / g;
+    out = out_rate / g;
+    if (out <= 1 << log2_phase_count) {
+        r->phase_count  = out;
+        r->frac_den     = 1;
+        r->step_frac    = 0;
+        r->step_phase   = in % out;
+        r->step_samples = in / out;
+    } else {
+        int64_t step = (int64_t)in << log2_phase_count;
+        r->phase_count  = 1 << log2_phase_count;
+        r->frac_den     = out;
+        r->step_frac    = step % out;
+        r->step_phase   = step / out % r->phase_count;
+        r->step_samples = step / out / r->phase_count;
+        r->frac         = out / 2;  /* round to the nearest phase */
+    }
+
+    factor           = FFMIN(out_rate * cutoff / in_rate, 1.0);
+    r->channels      = channels;
+    r->filter_length = FFALIGN((int)ceil(filter_length / factor), 8);
+    r->filter_bank   = av_malloc(r->filter_length * r->phase_count * sizeof(*r->filter_bank));
+    r->hist          = av_mallocz(channels * sizeof(*r->hist));
+    r->silence       = av_mallocz(channels * sizeof(*r->silence));
+    if (!r->filter_bank || !r->hist || !r->silence)
+        goto fail;
+    build_filter(r->filter_bank, factor, r->filter_length, r->phase_count);
+
+    /* center the first output on the first input sample */
+    center      = (r->filter_length - 1) / 2;
+    r->hist_len = center;
+    for (ch = 0; ch < channels; ch++) {
+        if (!(r->hist[ch] = av_mallocz(2 * r->filter_length * sizeof(**r->hist))))
+            goto fail;
+    }
+    if (!(r->silence_buf = av_mallocz(r->filter_length * sizeof(*r->silence_buf))))
+        goto fail;
+    for (ch = 0; ch < channels; ch++)
+        r->silence[ch] = r->silence_buf;
+
+    r->dot = dot_c;
+#if HAVE_SSE2_INTRINSICS
+    if (cpu_flags & AV_CPU_FLAG_SSE)
+        r->dot = dot_sse;
+#endif
+    return r;
+fail:
+    av_resampler_close(r);
+    return NULL;
+}
+
+void av_resampler_close(AVResampler *r)
+{
+    int ch;
+
+    if (!r)
+        return;
+    if (r->hist)
+        for (ch = 0; ch < r->channels; ch++)
+            av_free(r->hist[ch]);
+    av_free(r->hist);
+    av_free(r->silence);
+    av_free(r->silence_buf);
+    av_free(r->filter_bank);
+    av_free(r);
+}
+
+int av_resampler_get_out_samples(AVResampler *r, int in_samples)
+{
+    /* positions in units of 1/frac_den phase */
+    int64_t unit  = (int64_t)r->phase_count * r->frac_den;
+    int64_t start = ((int64_t)r->pos * r->phase_count + r->phase) * r->frac_den + r->frac;
+    int64_t step  = ((int64_t)r->step_samples * r->phase_count + r->step_phase) * r->frac_den + r->step_frac;
+    int64_t end   = (int64_t)(r->hist_len + in_samples - r->filter_length + 1) * unit;
+
+    return end > start ? (end - start + step - 1) / step : 0;
+}
+
+int av_resampler_process(AVResampler *r, float * const *dst, int dst_size,
+                         const float * const *src, int src_size)
+{
+    const int len = r->filter_length;
+    int total, head, nb_out, remaining, ch, n;
+    int pos = 0, phase = 0, frac = 0;
+
+    if (!src) {
+        src      = r->silence;
+        src_size = len - 1 - (len - 1) / 2;
+    }
+    nb_out = av_resampler_get_out_samples(r, src_size);
+    if (src_size < 0 || dst_size < nb_out)
+        return AVERROR(EINVAL);
+    total = r->hist_len + src_size;
+    head  = FFMIN(src_size, len - 1);
+
+    for (ch = 0; ch < r->channels; ch++) {
+        float *hist = r->hist[ch];
+        const float *in = src[ch];
+        float *out = dst[ch];
+
+        memcpy(hist + r->hist_len, in, head * sizeof(*hist));
+        pos   = r->pos;
+        phase = r->phase;
+        frac  = r->frac;
+        for (n = 0; n < nb_out; n++) {
+            const float *window = pos < r->hist_len ? hist + pos : in + pos - r->hist_len;
+
+            out[n] = r->dot(window, r->filter_bank + phase * len, len);
+            pos   += r->step_samples;
+            phase += r->step_phase;
+            frac  += r->step_frac;
+            if (frac >= r->frac_den) {
+                frac -= r->frac_den;
+                phase++;
+            }
+            if (phase >= r->phase_count) {
+                phase -= r->phase_count;
+                pos++;
+            }
+        }
+
+        /* keep the samples from the start of the next window on */
+        remaining = total - pos;
+        if (remaining > 0) {
+            if (pos < r->hist_len)
+                memmove(hist, hist + pos, remaining * sizeof(*hist));
+            else
+                memcpy(hist, in + pos - r->hist_len, remaining * sizeof(*hist));
+        }
+    }
+
+    remaining   = total - pos;
+    r->hist_len = FFMAX(remaining, 0);
+    r->pos      = FFMAX(-remaining, 0);
+    r->phase    = phase;
+    r->frac     = frac;
+    return nb_out;
+}
@@ -0,0 +1,223 @@
+/*
+ * start code and escape scanning
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * start code and escape scanning
+ *
+ * Start codes (00 00 01) and H.264 emulation prevention escapes (00 00 03)
+ * both begin with two zero bytes, which are rare in coded data. The parsers
+ * and the NAL decoder skip to the next such pair, then look at it bytewise.
+ */
+
+#include <assert.h>
+
+#include "libavutil/common.h"
+#include "libavutil/intreadwrite.h"
+#include "mpegvideo.h"
+#include "startcode.h"
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define HAVE_SSE2_INTRINSICS 1
+#else
+#define HAVE_SSE2_INTRINSICS 0
+#endif
+
+int ff_startcode_find_candidate(const uint8_t *buf, int size)
+{
+    int i = 0;
+
+#if HAVE_SSE2_INTRINSICS
+    const __m128i zero = _mm_setzero_si128();
+
+    /* compare each byte and the next one with zero, 16 pairs at a time */
+    for (; i + 17 <= size; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(buf + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(buf + i + 1));
+        int mask  = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, zero),
+                                                    _mm_cmpeq_epi8(b, zero)));
+        if (mask)
+            return i + av_log2(mask & -mask);
+    }
+#elif HAVE_FAST_UNALIGNED
+    /* skip the words without any zero byte */
+#   if HAVE_FAST_64BIT
+    for (; i + 8 <= size; i += 8) {
+        uint64_t x = AV_RN64(buf + i);
+        if ((x - 0x0101010101010101ULL) & ~x & 0x8080808080808080ULL)
+            break;
+    }
+#   else
+    for (; i + 4 <= size; i += 4) {
+        uint32_t x = AV_RN32(buf + i);
+        if ((x - 0x01010101U) & ~x & 0x80808080U)
+            break;
+    }
+#   endif
+#endif
+    for (; i < size; i++)
+        if (!buf[i] && (i + 1 == size || !buf[i + 1]))
+            return i;
+    return size;
+}
+
+const uint8_t *ff_find_start_code(const uint8_t * restrict p, const uint8_t *end, uint32_t * restrict state){
+    int i;
+
+    assert(p<=end);
+    if(p>=end)
+        return end;
+
+    for(i=0; i<3; i++){
+        uint32_t tmp= *state << 8;
+        *state= tmp + *(p++);
+        if(tmp == 0x100 || p==end)
+            return p;
+    }
+
+    /* look for 00 00 01 xx starting 3 bytes back, the state covers the rest */
+    for(p-= 3; end - p > 3; p++){
+        p+= ff_startcode_find_candidate(p, end - p - 2);
+        if(end - p <= 3)
+            break;
+        if(!p[1] && p[2] == 1){
+            *state= AV_RB32(p);
+            return p+4;
+        }
+    }
+
+    *state= AV_RB32(end-4);
+    return end;
+}
+
+#ifdef TEST
+#include <stdio.h>
+#include "libavutil/lfg.h"
+#undef printf
+#define BUF_SIZE 4096
+
+static int find_candidate_ref(const uint8_t *buf, int size)
+{
+    int i;
+
+    for (i = 0; i < size; i++)
+        if (!buf[i] && (i + 1 == size || !buf[i + 1]))
+            return i;
+    return size;
+}
+
+static const uint8_t *find_start_code_ref(const uint8_t *p, const uint8_t *end, uint32_t *state)
+{
+    while (p < end) {
+        uint32_t tmp = *state << 8;
+        *state = tmp + *p++;
+        if (tmp == 0x100)
+            return p;
+    }
+    return end;
+}
+
+/**
+ * Scan buf in chunks of random size, as a parser fed by packets does,
+ * and check that both scanners stop at the same places with the same state.
+ */
+static int check_start_codes(const uint8_t *buf, int size, AVLFG *prng)
+{
+    const uint8_t *end = buf + size, *p = buf, *q = buf;
+    uint32_t state = -1, ref_state = -1;
+
+    while (p < end) {
+        const uint8_t *chunk_end = p + FFMIN(av_lfg_get(prng) % 64 + 1, end - p);
+
+        while (p < chunk_end) {
+            p = ff_find_start_code(p, chunk_end, &state);
+            q = find_start_code_ref(q, chunk_end, &ref_state);
+            if (p != q || state != ref_state) {
+                printf("ff_find_start_code() mismatch at %d/%d: state %08X, expected %08X\n",
+                       (int)(p - buf), (int)(q - buf), state, ref_state);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+int main(void)
+{
+    static uint8_t buf[BUF_SIZE + 32];
+    static const uint8_t split[] = { 0x12, 0x00, 0x00, 0x01, 0xB3, 0x00, 0x00, 0x01, 0x00 };
+    AVLFG prng;
+    int i, size, run;
+
+    av_lfg_init(&prng, 1);
+
+    for (run = 0; run < 64; run++) {
+        /* mostly zeros and ones, so that start codes and escapes are common */
+        for (i = 0; i < BUF_SIZE; i++) {
+            unsigned r = av_lfg_get(&prng);
+            buf[i] = r % (run % 8 + 2) ? r >> 8 : r % 3 == 2 ? 3 : r % 3;
+        }
+
+        /* every alignment and every tail length */
+        for (i = 0; i < 32; i++)
+            for (size = 0; size <= 80; size++)
+                if (ff_startcode_find_candidate(buf + i, size) != find_candidate_ref(buf + i, size)) {
+                    printf("ff_startcode_find_candidate() mismatch at offset %d, size %d\n", i, size);
+                    return 1;
+                }
+        if (ff_startcode_find_candidate(buf, BUF_SIZE) != find_candidate_ref(buf, BUF_SIZE)) {
+            printf("ff_startcode_find_candidate() mismatch, size %d\n", BUF_SIZE);
+            return 1;
+        }
+
+        if (check_start_codes(buf, BUF_SIZE, &prng))
+            return 1;
+    }
+
+    /* a start code split across two calls at every position */
+    for (i = 0; i <= sizeof(split); i++) {
+        const uint8_t *p, *end = split + sizeof(split);
+        uint32_t state = -1;
+        int found = 0;
+
+        for (p = split; p < end; ) {
+            const uint8_t *chunk_end = p < split + i ? split + i : end;
+
+            while (p < chunk_end) {
+                p = ff_find_start_code(p, chunk_end, &state);
+                if ((state & 0xFFFFFF00) == 0x100 && p - split == (found ? 9 : 5)) {
+                    found++;
+                    if (state != (found == 1 ? 0x1B3 : 0x100)) {
+                        printf("wrong start code %08X split at %d\n", state, i);
+                        return 1;
+                    }
+                }
+            }
+        }
+        if (found != 2) {
+            printf("%d start codes found split at %d, expected 2\n", found, i);
+            return 1;
+        }
+    }
+
+    printf("start code scanning ok\n");
+    return 0;
+}
+#endif
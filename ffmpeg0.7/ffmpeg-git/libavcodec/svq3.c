@@ -729,6 +729,8 @@ static int svq3_decode_slice_header(H264Context *h)
         if (h->svq3_watermark_key) {
             uint32_t header = AV_RL32(&s->gb.buffer[(get_bits_count(&s->gb)>>3)+1]);
             AV_WL32(&s->gb.buffer[(get_bits_count(&s->gb)>>3)+1], header ^ h->svq3_watermark_key);
+            /* the reader may already have cached the scrambled bytes */
+            skip_bits_long(&s->gb, 0);
         }
         if (length > 0) {
             memcpy((uint8_t *) &s->gb.buffer[get_bits_count(&s->gb) >> 3],
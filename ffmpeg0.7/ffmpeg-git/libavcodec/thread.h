@@ -111,4 +111,10 @@ void ff_thread_release_buffer(AVCodecContext *avctx, AVFrame *f);
 int ff_thread_init(AVCodecContext *s);
 void ff_thread_free(AVCodecContext *s);
 
+/**
+ * Sum ff_get_memory_usage() over all frame thread contexts.
+ * Called by avcodec_get_memory_usage().
+ */
+int64_t ff_thread_memory_usage(AVCodecContext *avctx);
+
 #endif /* AVCODEC_THREAD_H */
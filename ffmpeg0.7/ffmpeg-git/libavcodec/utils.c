@@ -120,6 +120,7 @@ typedef struct InternalBuffer{
     int linesize[4];
     int width, height;
     enum PixelFormat pix_fmt;
+    int size;                   ///< bytes allocated for base[]
 }InternalBuffer;
 
 #define INTERNAL_BUFFER_SIZE 32
@@ -319,6 +320,7 @@ int avcodec_default_get_buffer(AVCodecContext *s, AVFrame *pic){
         size[i] = tmpsize - (picture.data[i] - picture.data[0]);
 
         buf->last_pic_num= -256*256*256*64;
+        buf->size= 0;
         memset(buf->base, 0, sizeof(buf->base));
         memset(buf->data, 0, sizeof(buf->data));
 
@@ -330,6 +332,7 @@ int avcodec_default_get_buffer(AVCodecContext *s, AVFrame *pic){
 
             buf->base[i]= av_malloc(size[i]+16); //FIXME 16
             if(buf->base[i]==NULL) return -1;
+            buf->size += size[i]+16;
             memset(buf->base[i], 128, size[i]);
 
             // no edge if EDGE EMU or not planar YUV
@@ -1121,6 +1124,34 @@ void avcodec_flush_buffers(AVCodecContext *avctx)
         avctx->codec->flush(avctx);
 }
 
+int64_t ff_get_memory_usage(AVCodecContext *avctx)
+{
+    InternalBuffer *buf = avctx->internal_buffer;
+    int64_t size = 0;
+    int i;
+
+    /* released buffers stay allocated for reuse, count them as well */
+    if (buf)
+        for (i = 0; i < INTERNAL_BUFFER_SIZE; i++)
+            size += buf[i].size;
+    if (avctx->codec && avctx->codec->memory_usage)
+        size += avctx->codec->memory_usage(avctx);
+    return size;
+}
+
+int64_t avcodec_get_memory_usage(AVCodecContext *avctx)
+{
+    if (HAVE_PTHREADS && avctx->active_thread_type&FF_THREAD_FRAME)
+        return ff_thread_memory_usage(avctx);
+    return ff_get_memory_usage(avctx);
+}
+
+int avcodec_get_latency(AVCodecContext *avctx)
+{
+    /* with frame threads has_b_frames already counts the extra threads */
+    return avctx->has_b_frames;
+}
+
 void avcodec_default_free_buffers(AVCodecContext *s){
     int i, j;
 
@@ -1134,6 +1165,7 @@ void avcodec_default_free_buffers(AVCodecContext *s){
             av_freep(&buf->base[j]);
             buf->data[j]= NULL;
         }
+        buf->size= 0;
     }
     av_freep(&s->internal_buffer);
 
@@ -338,7 +338,7 @@ static av_always_inline const uint8_t* find_next_marker(const uint8_t *src, cons
 
     if(end-src < 4) return end;
     while(src < end){
-        mrk = (mrk << 8) | *src++;
+        src = ff_find_start_code(src, end, &mrk);
         if(IS_MARKER(mrk))
             return src-4;
     }
@@ -86,18 +86,17 @@ static void vc1_extract_headers(AVCodecParserContext *s, AVCodecContext *avctx,
  */
 static int vc1_find_frame_end(ParseContext *pc, const uint8_t *buf,
                                int buf_size) {
-    int pic_found, i;
+    const uint8_t *p= buf, *end= buf + buf_size;
+    int pic_found;
     uint32_t state;
 
     pic_found= pc->frame_start_found;
     state= pc->state;
 
-    i=0;
     if(!pic_found){
-        for(i=0; i<buf_size; i++){
-            state= (state<<8) | buf[i];
+        while(p < end){
+            p= ff_find_start_code(p, end, &state);
             if(state == VC1_CODE_FRAME || state == VC1_CODE_FIELD){
-                i++;
                 pic_found=1;
                 break;
             }
@@ -108,12 +107,12 @@ static int vc1_find_frame_end(ParseContext *pc, const uint8_t *buf,
         /* EOF considered as end of frame */
         if (buf_size == 0)
             return 0;
-        for(; i<buf_size; i++){
-            state= (state<<8) | buf[i];
+        while(p < end){
+            p= ff_find_start_code(p, end, &state);
             if(IS_MARKER(state) && state != VC1_CODE_FIELD && state != VC1_CODE_SLICE){
                 pc->frame_start_found=0;
                 pc->state=-1;
-                return i-3;
+                return p - buf - 4;
             }
         }
     }
@@ -152,17 +151,17 @@ static int vc1_parse(AVCodecParserContext *s,
 static int vc1_split(AVCodecContext *avctx,
                            const uint8_t *buf, int buf_size)
 {
-    int i;
+    const uint8_t *p= buf, *end= buf + buf_size;
     uint32_t state= -1;
     int charged=0;
 
-    for(i=0; i<buf_size; i++){
-        state= (state<<8) | buf[i];
+    while(p < end){
+        p= ff_find_start_code(p, end, &state);
         if(IS_MARKER(state)){
             if(state == VC1_CODE_SEQHDR || state == VC1_CODE_ENTRYPOINT){
                 charged=1;
             }else if(charged){
-                return i-3;
+                return p - buf - 4;
             }
         }
     }
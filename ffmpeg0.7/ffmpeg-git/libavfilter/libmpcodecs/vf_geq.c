@@ -36,10 +36,15 @@
 #include "libavcodec/avcodec.h"
 #include "libavutil/eval.h"
 
+#define NB_CONSTS 10
+
 struct vf_priv_s {
     AVExpr * e[3];
     int framenum;
     mp_image_t *mpi;
+    double *const_values;   ///< NB_CONSTS values for each pixel of a row
+    double *res;
+    int row_size;
 };
 
 static int config(struct vf_instance *vf,
@@ -94,6 +99,14 @@ static int put_image(struct vf_instance *vf, mp_image_t *mpi, double pts){
 
     vf_clone_mpi_attributes(dmpi, mpi);
 
+    if(vf->priv->row_size < mpi->w){
+        av_free(vf->priv->const_values);
+        av_free(vf->priv->res);
+        vf->priv->const_values= av_malloc(mpi->w * NB_CONSTS * sizeof(double));
+        vf->priv->res         = av_malloc(mpi->w * sizeof(double));
+        vf->priv->row_size    = vf->priv->const_values && vf->priv->res ? mpi->w : 0;
+    }
+
     for(plane=0; plane<3; plane++){
         int w= mpi->w >> (plane ? mpi->chroma_x_shift : 0);
         int h= mpi->h >> (plane ? mpi->chroma_y_shift : 0);
@@ -111,14 +124,30 @@ static int put_image(struct vf_instance *vf, mp_image_t *mpi, double pts){
             h/(double)mpi->h,
             0
         };
+        double *row= vf->priv->const_values, *res= vf->priv->res;
         if (!vf->priv->e[plane]) continue;
-        for(y=0; y<h; y++){
-            const_values[3]=y;
-            for(x=0; x<w; x++){
-                const_values[2]=x;
-                dst[x + y * dst_stride] = av_eval_expr(vf->priv->e[plane],
-                                                       const_values, vf);
+        if (!vf->priv->row_size) {
+            for(y=0; y<h; y++){
+                const_values[3]=y;
+                for(x=0; x<w; x++){
+                    const_values[2]=x;
+                    dst[x + y * dst_stride] = av_eval_expr(vf->priv->e[plane],
+                                                           const_values, vf);
+                }
             }
+            continue;
+        }
+        /* evaluate a whole row at once, one set of constants per pixel */
+        for(x=0; x<w; x++){
+            const_values[2]=x;
+            memcpy(row + x*NB_CONSTS, const_values, sizeof(const_values));
+        }
+        for(y=0; y<h; y++){
+            for(x=0; x<w; x++)
+                row[x*NB_CONSTS + 3]= y;
+            av_expr_eval_array(vf->priv->e[plane], res, row, NB_CONSTS, w, vf);
+            for(x=0; x<w; x++)
+                dst[x + y * dst_stride] = res[x];
         }
     }
 
@@ -128,6 +157,8 @@ static int put_image(struct vf_instance *vf, mp_image_t *mpi, double pts){
 }
 
 static void uninit(struct vf_instance *vf){
+    av_free(vf->priv->const_values);
+    av_free(vf->priv->res);
     av_free(vf->priv);
     vf->priv=NULL;
 }
@@ -32,8 +32,12 @@
 #include <unistd.h>
 #include "avio_internal.h"
 #include "url.h"
+#if HAVE_PTHREADS
+#include <pthread.h>
+#endif
 
 #define INITIAL_BUFFER_SIZE 32768
+#define MAX_PREFETCH 16
 
 /*
  * An apple http stream consists of a playlist with media segment files,
@@ -45,6 +49,13 @@
  *
  * If the main playlist doesn't point at any variants, we still create
  * one anonymous toplevel variant for this, to maintain the structure.
+ *
+ * With AVFMT_FLAG_ADAPTIVE, the variants instead share one set of streams
+ * and only one of them is downloaded at a time, chosen at each segment
+ * boundary according to the measured download speed.
+ *
+ * Segments can be downloaded ahead into memory by a thread per variant,
+ * so that reading a segment rarely has to wait for the network.
  */
 
 struct segment {
@@ -52,6 +63,24 @@ struct segment {
     char url[MAX_URL_SIZE];
 };
 
+enum PrefetchState {
+    PREFETCH_EMPTY,
+    PREFETCH_LOADING,
+    PREFETCH_DONE,
+    PREFETCH_FAILED,
+};
+
+/*
+ * A segment downloaded ahead. Segment seq_no is kept in
+ * prefetch[seq_no % n_prefetch] of its variant.
+ */
+struct prefetch_buf {
+    int seq_no;
+    enum PrefetchState state;
+    uint8_t *data;
+    int size, allocated;
+};
+
 /*
  * Each variant has its own demuxer. If it currently is active,
  * it has an open AVIOContext too, and potentially an AVPacket
@@ -75,8 +104,25 @@ struct variant {
     int n_segments;
     struct segment **segments;
     int needed, cur_needed;
+    int draining;       /* switched away from, still returning buffered packets */
     int cur_seq_no;
     int64_t last_load_time;
+
+    int64_t measured_bandwidth; /* download speed in bits per second */
+    int64_t segment_start_time;
+    int64_t segment_bytes;
+
+    /* prefetching, enabled if n_prefetch > 0 */
+    int n_prefetch;
+    struct prefetch_buf prefetch[MAX_PREFETCH];
+    struct prefetch_buf *cur_buf; /* segment being read, instead of input */
+    int cur_buf_pos;
+#if HAVE_PTHREADS
+    pthread_t thread;
+    pthread_mutex_t lock;  /* protects the playlist, cur_seq_no and prefetch */
+    pthread_cond_t cond;
+    int abort;
+#endif
 };
 
 typedef struct AppleHTTPContext {
@@ -85,6 +131,7 @@ typedef struct AppleHTTPContext {
     int cur_seq_no;
     int end_of_segment;
     int first_packet;
+    int adaptive;
 } AppleHTTPContext;
 
 static int read_chomp_line(AVIOContext *s, char *buf, int maxlen)
@@ -104,11 +151,232 @@ static void free_segment_list(struct variant *var)
     var->n_segments = 0;
 }
 
+static void variant_lock(struct variant *v)
+{
+#if HAVE_PTHREADS
+    if (v->n_prefetch)
+        pthread_mutex_lock(&v->lock);
+#endif
+}
+
+static void variant_unlock(struct variant *v)
+{
+#if HAVE_PTHREADS
+    if (v->n_prefetch) {
+        pthread_cond_broadcast(&v->cond);
+        pthread_mutex_unlock(&v->lock);
+    }
+#endif
+}
+
+static void update_bandwidth(struct variant *v, int64_t bytes, int64_t elapsed)
+{
+    int64_t bandwidth;
+
+    if (bytes <= 0 || elapsed <= 0)
+        return;
+    bandwidth = av_rescale(bytes * 8, AV_TIME_BASE, elapsed);
+    /* smooth over the last few segments */
+    if (v->measured_bandwidth)
+        bandwidth = (3 * v->measured_bandwidth + bandwidth) / 4;
+    v->measured_bandwidth = bandwidth;
+}
+
+/*
+ * Make the variant continue at segment seq_no, dropping the segments read
+ * or downloaded so far that are not needed any longer.
+ */
+static void set_position(struct variant *v, int seq_no)
+{
+    int i;
+
+    if (v->input) {
+        ffurl_close(v->input);
+        v->input = NULL;
+    }
+    variant_lock(v);
+    v->cur_seq_no = seq_no;
+    v->cur_buf    = NULL;
+    for (i = 0; i < v->n_prefetch; i++) {
+        struct prefetch_buf *buf = &v->prefetch[i];
+        if (buf->seq_no >= seq_no && buf->seq_no < seq_no + v->n_prefetch)
+            continue;
+        if (buf->state == PREFETCH_LOADING)
+            buf->seq_no = -1; /* discarded by the thread once done */
+        else
+            buf->state = PREFETCH_EMPTY;
+    }
+    variant_unlock(v);
+}
+
+#if HAVE_PTHREADS
+static int fetch_segment(struct variant *v, const char *url,
+                         struct prefetch_buf *buf)
+{
+    URLContext *in;
+    int64_t size;
+    int ret = ffurl_open(&in, url, AVIO_RDONLY);
+
+    if (ret < 0)
+        return ret;
+    size = ffurl_size(in);
+    for (;;) {
+        if (buf->allocated - buf->size < INITIAL_BUFFER_SIZE) {
+            int new_size = FFMAX(2 * buf->allocated, buf->size + INITIAL_BUFFER_SIZE);
+            uint8_t *data;
+            if (size > 0 && size < INT_MAX - INITIAL_BUFFER_SIZE)
+                new_size = FFMAX(new_size, size + INITIAL_BUFFER_SIZE);
+            data = av_realloc(buf->data, new_size);
+            if (!data) {
+                ret = AVERROR(ENOMEM);
+                break;
+            }
+            buf->data      = data;
+            buf->allocated = new_size;
+        }
+        ret = ffurl_read(in, buf->data + buf->size, buf->allocated - buf->size);
+        if (ret <= 0)
+            break;
+        buf->size += ret;
+        if (v->abort) {
+            ret = AVERROR_EXIT;
+            break;
+        }
+    }
+    ffurl_close(in);
+    return ret == AVERROR_EOF ? 0 : ret;
+}
+
+static void *prefetch_thread(void *arg)
+{
+    struct variant *v = arg;
+    char url[MAX_URL_SIZE];
+
+    pthread_mutex_lock(&v->lock);
+    while (!v->abort) {
+        struct prefetch_buf *buf = NULL;
+        int64_t start;
+        int seq_no, ret;
+
+        /* Find the first segment of the window after the current one
+         * that is neither downloaded nor being downloaded */
+        for (seq_no = FFMAX(v->cur_seq_no, v->start_seq_no);
+             v->needed && seq_no < v->cur_seq_no + v->n_prefetch &&
+             seq_no < v->start_seq_no + v->n_segments; seq_no++) {
+            struct prefetch_buf *b = &v->prefetch[seq_no % v->n_prefetch];
+            if (b->seq_no == seq_no && b->state != PREFETCH_EMPTY)
+                continue;
+            if (b->state != PREFETCH_LOADING)
+                buf = b;
+            break;
+        }
+        if (!buf) {
+            pthread_cond_wait(&v->cond, &v->lock);
+            continue;
+        }
+        buf->seq_no = seq_no;
+        buf->state  = PREFETCH_LOADING;
+        buf->size   = 0;
+        av_strlcpy(url, v->segments[seq_no - v->start_seq_no]->url, sizeof(url));
+        pthread_mutex_unlock(&v->lock);
+
+        start = av_gettime();
+        ret   = fetch_segment(v, url, buf);
+
+        pthread_mutex_lock(&v->lock);
+        if (buf->seq_no != seq_no) {
+            buf->state = PREFETCH_EMPTY;
+        } else if (ret < 0) {
+            buf->state = PREFETCH_FAILED;
+        } else {
+            buf->state = PREFETCH_DONE;
+            update_bandwidth(v, buf->size, av_gettime() - start);
+        }
+        pthread_cond_broadcast(&v->cond);
+    }
+    pthread_mutex_unlock(&v->lock);
+    return NULL;
+}
+
+static void start_prefetch(struct variant *v, int n_prefetch)
+{
+    int i;
+
+    for (i = 0; i < n_prefetch; i++)
+        v->prefetch[i].seq_no = -1;
+    pthread_mutex_init(&v->lock, NULL);
+    pthread_cond_init(&v->cond, NULL);
+    v->n_prefetch = n_prefetch;
+    if (pthread_create(&v->thread, NULL, prefetch_thread, v)) {
+        av_log(v->parent, AV_LOG_WARNING,
+               "Cannot start prefetching for variant %d\n", v->index);
+        pthread_mutex_destroy(&v->lock);
+        pthread_cond_destroy(&v->cond);
+        v->n_prefetch = 0;
+    }
+}
+
+/*
+ * Wait until the current segment has been downloaded and start reading it.
+ */
+static int wait_segment(struct variant *v)
+{
+    struct prefetch_buf *buf = &v->prefetch[v->cur_seq_no % v->n_prefetch];
+    int ret = 0;
+
+    pthread_mutex_lock(&v->lock);
+    pthread_cond_broadcast(&v->cond);
+    while (buf->seq_no != v->cur_seq_no ||
+           (buf->state != PREFETCH_DONE && buf->state != PREFETCH_FAILED)) {
+        struct timespec ts;
+        int64_t t = av_gettime() + 100000;
+        if (url_interrupt_cb()) {
+            ret = AVERROR_EXIT;
+            break;
+        }
+        ts.tv_sec  = t / 1000000;
+        ts.tv_nsec = (t % 1000000) * 1000;
+        pthread_cond_timedwait(&v->cond, &v->lock, &ts);
+    }
+    if (!ret && buf->state == PREFETCH_FAILED) {
+        /* let the thread try again */
+        buf->state = PREFETCH_EMPTY;
+        ret = AVERROR(EIO);
+    } else if (!ret) {
+        v->cur_buf     = buf;
+        v->cur_buf_pos = 0;
+    }
+    pthread_mutex_unlock(&v->lock);
+    return ret;
+}
+
+static void stop_prefetch(struct variant *v)
+{
+    int i;
+
+    if (!v->n_prefetch)
+        return;
+    pthread_mutex_lock(&v->lock);
+    v->abort = 1;
+    pthread_cond_broadcast(&v->cond);
+    pthread_mutex_unlock(&v->lock);
+    pthread_join(v->thread, NULL);
+    pthread_mutex_destroy(&v->lock);
+    pthread_cond_destroy(&v->cond);
+    for (i = 0; i < v->n_prefetch; i++)
+        av_freep(&v->prefetch[i].data);
+    v->n_prefetch = 0;
+}
+#endif
+
 static void free_variant_list(AppleHTTPContext *c)
 {
     int i;
     for (i = 0; i < c->n_variants; i++) {
         struct variant *var = c->variants[i];
+#if HAVE_PTHREADS
+        stop_prefetch(var);
+#endif
         free_segment_list(var);
         av_free_packet(&var->pkt);
         av_free(var->pb.buffer);
@@ -257,6 +525,47 @@ fail:
     return ret;
 }
 
+/*
+ * Switch to the variant with the highest bandwidth that fits in the
+ * measured download speed, with some margin.
+ */
+static void select_variant(AppleHTTPContext *c, struct variant *cur)
+{
+    int64_t bandwidth = cur->measured_bandwidth;
+    struct variant *best = NULL, *lowest = NULL;
+    int i;
+
+    if (!bandwidth)
+        return;
+    for (i = 0; i < c->n_variants; i++) {
+        struct variant *v = c->variants[i];
+        if (!v->ctx)
+            continue;
+        if (!lowest || v->bandwidth < lowest->bandwidth)
+            lowest = v;
+        if (v->bandwidth <= bandwidth * 4 / 5 &&
+            (!best || v->bandwidth > best->bandwidth))
+            best = v;
+    }
+    if (!best)
+        best = lowest;
+    if (!best || best == cur)
+        return;
+
+    av_log(cur->parent, AV_LOG_INFO,
+           "Switching to variant %d (%d bit/s), measured %"PRId64" bit/s\n",
+           best->index, best->bandwidth, bandwidth);
+    cur->needed   = 0;
+    cur->draining = 1;
+    best->needed  = 1;
+    best->draining = 0;
+    best->measured_bandwidth = bandwidth;
+    /* drop what was buffered while probing or before the last switch */
+    best->pb.buf_ptr = best->pb.buf_end = best->pb.buffer;
+    best->pb.eof_reached = 0;
+    set_position(best, cur->cur_seq_no);
+}
+
 static int read_data(void *opaque, uint8_t *buf, int buf_size)
 {
     struct variant *v = opaque;
@@ -264,19 +573,23 @@ static int read_data(void *opaque, uint8_t *buf, int buf_size)
     int ret, i;
 
 restart:
-    if (!v->input) {
+    if (!v->input && !v->cur_buf) {
 reload:
         /* If this is a live stream and target_duration has elapsed since
          * the last playlist reload, reload the variant playlists now. */
         if (!v->finished &&
-            av_gettime() - v->last_load_time >= v->target_duration*1000000 &&
-            (ret = parse_playlist(c, v->url, v, NULL)) < 0)
+            av_gettime() - v->last_load_time >= v->target_duration*1000000) {
+            variant_lock(v);
+            ret = parse_playlist(c, v->url, v, NULL);
+            variant_unlock(v);
+            if (ret < 0)
                 return ret;
+        }
         if (v->cur_seq_no < v->start_seq_no) {
             av_log(NULL, AV_LOG_WARNING,
                    "skipping %d segments ahead, expired from playlists\n",
                    v->start_seq_no - v->cur_seq_no);
-            v->cur_seq_no = v->start_seq_no;
+            set_position(v, v->start_seq_no);
         }
         if (v->cur_seq_no >= v->start_seq_no + v->n_segments) {
             if (v->finished)
@@ -291,25 +604,55 @@ reload:
             goto reload;
         }
 
-        ret = ffurl_open(&v->input,
-                         v->segments[v->cur_seq_no - v->start_seq_no]->url,
-                         AVIO_RDONLY);
-        if (ret < 0)
+#if HAVE_PTHREADS
+        if (v->n_prefetch) {
+            if ((ret = wait_segment(v)) < 0)
+                return ret;
+        } else
+#endif
+        {
+            ret = ffurl_open(&v->input,
+                             v->segments[v->cur_seq_no - v->start_seq_no]->url,
+                             AVIO_RDONLY);
+            if (ret < 0)
+                return ret;
+            v->segment_start_time = av_gettime();
+            v->segment_bytes      = 0;
+        }
+    }
+    if (v->cur_buf) {
+        ret = FFMIN(buf_size, v->cur_buf->size - v->cur_buf_pos);
+        if (ret > 0) {
+            memcpy(buf, v->cur_buf->data + v->cur_buf_pos, ret);
+            v->cur_buf_pos += ret;
+            return ret;
+        }
+        variant_lock(v);
+        v->cur_buf->state = PREFETCH_EMPTY;
+        v->cur_buf = NULL;
+        v->cur_seq_no++;
+        variant_unlock(v);
+    } else {
+        ret = ffurl_read(v->input, buf, buf_size);
+        if (ret > 0) {
+            v->segment_bytes += ret;
             return ret;
+        }
+        if (ret < 0 && ret != AVERROR_EOF)
+            return ret;
+        update_bandwidth(v, v->segment_bytes,
+                         av_gettime() - v->segment_start_time);
+        ffurl_close(v->input);
+        v->input = NULL;
+        v->cur_seq_no++;
     }
-    ret = ffurl_read(v->input, buf, buf_size);
-    if (ret > 0)
-        return ret;
-    if (ret < 0 && ret != AVERROR_EOF)
-        return ret;
-    ffurl_close(v->input);
-    v->input = NULL;
-    v->cur_seq_no++;
 
     c->end_of_segment = 1;
     c->cur_seq_no = v->cur_seq_no;
 
-    if (v->ctx) {
+    if (c->adaptive) {
+        select_variant(c, v);
+    } else if (v->ctx) {
         v->needed = 0;
         for (i = v->stream_offset; i < v->stream_offset + v->ctx->nb_streams;
              i++) {
@@ -328,7 +671,8 @@ reload:
 static int applehttp_read_header(AVFormatContext *s, AVFormatParameters *ap)
 {
     AppleHTTPContext *c = s->priv_data;
-    int ret = 0, i, j, stream_offset = 0;
+    struct variant *first = NULL;
+    int ret = 0, i, j, stream_offset = 0, adaptive;
 
     if ((ret = parse_playlist(c, s->filename, NULL, s->pb)) < 0)
         goto fail;
@@ -354,6 +698,8 @@ static int applehttp_read_header(AVFormatContext *s, AVFormatParameters *ap)
         goto fail;
     }
 
+    adaptive = (s->flags & AVFMT_FLAG_ADAPTIVE) && c->n_variants > 1;
+
     /* If this isn't a live stream, calculate the total duration of the
      * stream. */
     if (c->variants[0]->finished) {
@@ -380,6 +726,11 @@ static int applehttp_read_header(AVFormatContext *s, AVFormatParameters *ap)
         if (!v->finished && v->n_segments > 3)
             v->cur_seq_no = v->start_seq_no + v->n_segments - 3;
 
+#if HAVE_PTHREADS
+        if (s->prefetch_segments > 0)
+            start_prefetch(v, FFMIN(s->prefetch_segments, MAX_PREFETCH));
+#endif
+
         v->read_buffer = av_malloc(INITIAL_BUFFER_SIZE);
         ffio_init_context(&v->pb, v->read_buffer, INITIAL_BUFFER_SIZE, 0, v,
                           read_data, NULL, NULL);
@@ -392,6 +743,26 @@ static int applehttp_read_header(AVFormatContext *s, AVFormatParameters *ap)
                                    in_fmt, NULL);
         if (ret < 0)
             goto fail;
+        if (adaptive && first) {
+            /* All variants deliver their packets to the streams of the
+             * first one, so they have to contain the same streams. */
+            int compatible = v->ctx->nb_streams == first->ctx->nb_streams;
+            for (j = 0; compatible && j < v->ctx->nb_streams; j++)
+                compatible = v->ctx->streams[j]->codec->codec_type ==
+                             first->ctx->streams[j]->codec->codec_type;
+            if (!compatible) {
+                av_log(s, AV_LOG_WARNING, "Variant %d has different streams, "
+                       "not using it\n", i);
+                v->ctx->pb = NULL;
+                av_close_input_file(v->ctx);
+                v->ctx = NULL;
+            }
+            set_position(v, first->cur_seq_no);
+            v->needed = 0;
+            continue;
+        }
+        if (!first)
+            first = v;
         v->stream_offset = stream_offset;
         /* Create new AVStreams for each stream in this variant */
         for (j = 0; j < v->ctx->nb_streams; j++) {
@@ -405,6 +776,7 @@ static int applehttp_read_header(AVFormatContext *s, AVFormatParameters *ap)
         stream_offset += v->ctx->nb_streams;
     }
 
+    c->adaptive     = adaptive;
     c->first_packet = 1;
 
     return 0;
@@ -433,14 +805,12 @@ static int recheck_discard_flags(AVFormatContext *s, int first)
         if (v->cur_needed && !v->needed) {
             v->needed = 1;
             changed = 1;
-            v->cur_seq_no = c->cur_seq_no;
+            set_position(v, c->cur_seq_no);
             v->pb.eof_reached = 0;
             av_log(s, AV_LOG_INFO, "Now receiving variant %d\n", i);
         } else if (first && !v->cur_needed && v->needed) {
-            if (v->input)
-                ffurl_close(v->input);
-            v->input = NULL;
             v->needed = 0;
+            set_position(v, v->cur_seq_no);
             changed = 1;
             av_log(s, AV_LOG_INFO, "No longer receiving variant %d\n", i);
         }
@@ -454,7 +824,8 @@ static int applehttp_read_packet(AVFormatContext *s, AVPacket *pkt)
     int ret, i, minvariant = -1;
 
     if (c->first_packet) {
-        recheck_discard_flags(s, 1);
+        if (!c->adaptive)
+            recheck_discard_flags(s, 1);
         c->first_packet = 0;
     }
 
@@ -464,12 +835,13 @@ start:
         struct variant *var = c->variants[i];
         /* Make sure we've got one buffered packet from each open variant
          * stream */
-        if (var->needed && !var->pkt.data) {
+        if ((var->needed || var->draining) && !var->pkt.data) {
             ret = av_read_frame(var->ctx, &var->pkt);
             if (ret < 0) {
                 if (!url_feof(&var->pb))
                     return ret;
                 reset_packet(&var->pkt);
+                var->draining = 0;
             }
         }
         /* Check if this stream has the packet with the lowest dts */
@@ -479,7 +851,7 @@ start:
                 minvariant = i;
         }
     }
-    if (c->end_of_segment) {
+    if (c->end_of_segment && !c->adaptive) {
         if (recheck_discard_flags(s, 0))
             goto start;
     }
@@ -519,24 +891,22 @@ static int applehttp_read_seek(AVFormatContext *s, int stream_index,
         /* Reset reading */
         struct variant *var = c->variants[i];
         int64_t pos = 0;
-        if (var->input) {
-            ffurl_close(var->input);
-            var->input = NULL;
-        }
         av_free_packet(&var->pkt);
         reset_packet(&var->pkt);
         var->pb.eof_reached = 0;
+        var->draining = 0;
 
         /* Locate the segment that contains the target timestamp */
         for (j = 0; j < var->n_segments; j++) {
             if (timestamp >= pos &&
                 timestamp < pos + var->segments[j]->duration) {
-                var->cur_seq_no = var->start_seq_no + j;
                 ret = 0;
                 break;
             }
             pos += var->segments[j]->duration;
         }
+        set_position(var, j < var->n_segments ? var->start_seq_no + j
+                                               : var->cur_seq_no);
     }
     return ret;
 }
@@ -793,6 +793,8 @@ typedef struct AVFormatContext {
 #define AVFMT_FLAG_NOFILLIN     0x0010 ///< Do not infer any values from other values, just return what is stored in the container
 #define AVFMT_FLAG_NOPARSE      0x0020 ///< Do not use AVParsers, you also must set AVFMT_FLAG_NOFILLIN as the fillin code works on frames and no parsing -> no frames. Also seeking to frames can not work if parsing to find frame boundaries has been disabled
 #define AVFMT_FLAG_RTP_HINT     0x0040 ///< Add RTP hinting to the output file
+#define AVFMT_FLAG_ADAPTIVE     0x0080 ///< Switch between variants of an adaptive stream (Apple HTTP Live Streaming) by measured bandwidth, instead of exposing all of them
+#define AVFMT_FLAG_CLOCK_RECOVERY 0x0100 ///< Recover the sender clock of a live input from packet arrival times, see av_get_input_wallclock()
 
     int loop_input;
 
@@ -886,6 +888,22 @@ typedef struct AVFormatContext {
      * - decoding: Unused.
      */
     int64_t start_time_realtime;
+
+    /**
+     * Number of segments to download ahead in the background, for demuxers
+     * of segmented network streams. 0 disables prefetching.
+     * - encoding: Unused.
+     * - decoding: Set by user.
+     */
+    int prefetch_segments;
+
+    /**
+     * Sender clock recovered from packet arrival times, used when
+     * AVFMT_FLAG_CLOCK_RECOVERY is set.
+     * - encoding: Unused.
+     * - decoding: Set by libavformat.
+     */
+    struct InputClock *input_clock;
 } AVFormatContext;
 
 typedef struct AVPacketList {
@@ -1222,6 +1240,32 @@ FFMPEGLIB_API int av_read_packet(AVFormatContext *s, AVPacket *pkt);
  */
 FFMPEGLIB_API int av_read_frame(AVFormatContext *s, AVPacket *pkt);
 
+/**
+ * Return the local wallclock time at which a timestamp of a live input was
+ * received, with the network and scheduling jitter of the packet arrival
+ * times filtered out.
+ *
+ * The arrival times of the packets are filtered against their timestamps
+ * with a delay locked loop, which also tracks the drift between the clock
+ * of the sender and the local clock. A jump of the timestamps restarts the
+ * recovery. AVFMT_FLAG_CLOCK_RECOVERY must be set before the input is read.
+ *
+ * @param stream_index stream the timestamp belongs to
+ * @param ts timestamp in the time base of the stream
+ * @return time in microseconds on the av_gettime() clock, or AV_NOPTS_VALUE
+ *         if the clock has not been recovered yet
+ */
+FFMPEGLIB_API int64_t av_get_input_wallclock(AVFormatContext *s, int stream_index, int64_t ts);
+
+/**
+ * Return the drift of the sender clock of a live input relative to the
+ * local clock, in parts per million, as estimated by the clock recovery.
+ * Positive values mean that the sender clock runs slow.
+ *
+ * @return the drift, or 0 if it is not known yet
+ */
+FFMPEGLIB_API double av_get_input_clock_drift(AVFormatContext *s);
+
 /**
  * Seek to the keyframe at timestamp.
  * 'timestamp' in 'stream_index'.
@@ -1277,6 +1321,62 @@ FFMPEGLIB_API int av_read_play(AVFormatContext *s);
  */
 FFMPEGLIB_API int av_read_pause(AVFormatContext *s);
 
+/**
+ * Event loop receiving packets of many network inputs (RTSP, SDP and RTP)
+ * from a single thread. A reactor must only be used from one thread at a
+ * time; use one reactor per thread to spread inputs over several threads.
+ */
+typedef struct AVReactor AVReactor;
+
+/**
+ * Called by av_reactor_run() for each packet read from a registered input.
+ *
+ * @param pkt packet read, which the callback has to free with
+ *            av_free_packet(), or NULL if reading failed or the input
+ *            ended, in which case the input has been unregistered
+ * @return a negative value to unregister the input
+ */
+typedef int (*AVReactorCallback)(void *opaque, AVFormatContext *s, AVPacket *pkt);
+
+/**
+ * Allocate a reactor.
+ *
+ * @return the reactor, or NULL on failure
+ */
+FFMPEGLIB_API AVReactor *av_reactor_alloc(void);
+
+/**
+ * Register an opened input with the reactor. From then on, packets of
+ * the input are delivered to cb from av_reactor_run(), and the input is
+ * read in non-blocking mode (AVFMT_FLAG_NONBLOCK) until it is removed.
+ *
+ * @return 0 on success, AVERROR(ENOSYS) if the input format does not
+ *         support it, another negative error code on other failures
+ */
+FFMPEGLIB_API int av_reactor_add(AVReactor *r, AVFormatContext *s,
+                                 AVReactorCallback cb, void *opaque);
+
+/**
+ * Unregister an input. May be called from the callback.
+ */
+FFMPEGLIB_API void av_reactor_remove(AVReactor *r, AVFormatContext *s);
+
+/**
+ * Wait until registered inputs have data and deliver all the packets
+ * that can be read from them without blocking.
+ *
+ * @param timeout maximum time to wait, in milliseconds, or -1 to wait
+ *                until any input has data
+ * @return number of packets delivered, or a negative error code
+ */
+FFMPEGLIB_API int av_reactor_run(AVReactor *r, int timeout);
+
+/**
+ * Unregister all inputs, free the reactor and set *r to NULL.
+ * The inputs themselves are not closed.
+ */
+FFMPEGLIB_API void av_reactor_free(AVReactor **r);
+
 /**
  * Free a AVFormatContext allocated by av_open_input_stream.
  * @param s context to free
@@ -337,6 +337,62 @@ int ffurl_write(URLContext *h, const unsigned char *buf, int size)
     return retry_transfer_wrapper(h, buf, size, size, h->prot->url_write);
 }
 
+int ffurl_write_packets(URLContext *h, const URLPacket *pkts, int nb_pkts)
+{
+    uint8_t *buf;
+    int i, ret = 0, max_size = 0;
+    int fast_retries = 5;
+
+    if (!(h->flags & (AVIO_WRONLY | AVIO_RDWR)))
+        return AVERROR(EIO);
+    if (nb_pkts <= 0)
+        return 0;
+    for (i = 0; i < nb_pkts; i++)
+        max_size = FFMAX(max_size, pkts[i].hdr_size + pkts[i].size);
+    /* avoid sending too big packets */
+    if (h->max_packet_size && max_size > h->max_packet_size)
+        return AVERROR(EIO);
+
+    if (!h->prot->url_write_packets) {
+        buf = av_malloc(max_size);
+        if (!buf)
+            return AVERROR(ENOMEM);
+        for (i = 0; i < nb_pkts; i++) {
+            memcpy(buf, pkts[i].hdr, pkts[i].hdr_size);
+            memcpy(buf + pkts[i].hdr_size, pkts[i].data, pkts[i].size);
+            ret = ffurl_write(h, buf, pkts[i].hdr_size + pkts[i].size);
+            if (ret < 0)
+                break;
+        }
+        av_free(buf);
+        return ret < 0 ? ret : 0;
+    }
+
+    /* the protocol returns the number of packets it has sent */
+    while (nb_pkts > 0) {
+        ret = h->prot->url_write_packets(h, pkts, nb_pkts);
+        if (ret == AVERROR(EINTR))
+            continue;
+        if (h->flags & AVIO_FLAG_NONBLOCK && ret < 0)
+            return ret;
+        if (ret == AVERROR(EAGAIN)) {
+            if (fast_retries)
+                fast_retries--;
+            else
+                usleep(1000);
+        } else if (ret < 0) {
+            return ret;
+        } else {
+            fast_retries = FFMAX(fast_retries, 2);
+            pkts    += ret;
+            nb_pkts -= ret;
+        }
+        if (nb_pkts > 0 && url_interrupt_cb())
+            return AVERROR_EXIT;
+    }
+    return 0;
+}
+
 int64_t ffurl_seek(URLContext *h, int64_t pos, int whence)
 {
     int64_t ret;
@@ -115,6 +115,8 @@ typedef struct URLContext {
 
 #define URL_PROTOCOL_FLAG_NESTED_SCHEME 1 /*< The protocol name can be the first part of a nested protocol scheme */
 
+struct URLPacket;
+
 /**
  * @deprecated This struct is to be made private. Use the higher-level
  *             AVIOContext-based API instead.
@@ -135,6 +137,7 @@ typedef struct URLProtocol {
     const AVClass *priv_data_class;
     int flags;
     int (*url_check)(URLContext *h, int mask);
+    int (*url_write_packets)(URLContext *h, const struct URLPacket *pkts, int nb_pkts);
 } URLProtocol;
 
 typedef struct URLPollEntry {
@@ -98,4 +98,10 @@ int ffio_open_dyn_packet_buf(AVIOContext **s, int max_packet_size);
  */
 int ffio_fdopen(AVIOContext **s, URLContext *h);
 
+/**
+ * Return the URLContext an AVIOContext created by ffio_fdopen() accesses,
+ * or NULL if it was created otherwise.
+ */
+URLContext *ffio_geturlcontext(AVIOContext *s);
+
 #endif // AVFORMAT_AVIO_INTERNAL_H
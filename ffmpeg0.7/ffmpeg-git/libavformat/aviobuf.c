@@ -542,9 +542,14 @@ void put_tag(AVIOContext *s, const char *tag)
 
 static void fill_buffer(AVIOContext *s)
 {
-    uint8_t *dst= !s->max_packet_size && s->buf_end - s->buffer < s->buffer_size ? s->buf_end : s->buffer;
-    int len= s->buffer_size - (dst - s->buffer);
     int max_buffer_size = s->max_packet_size ? s->max_packet_size : IO_BUFFER_SIZE;
+    /* Keep the data already in the buffer for seeking back, unless this
+     * would leave too little room for a read to be efficient: reads from
+     * fast streams should be as large as the buffer. */
+    int min_len = FFMAX(FFMIN(s->buffer_size, max_buffer_size) / 4, 1);
+    uint8_t *dst= !s->max_packet_size && s->buffer_size - (s->buf_end - s->buffer) >= min_len ?
+                  s->buf_end : s->buffer;
+    int len= s->buffer_size - (dst - s->buffer);
 
     /* no need to do anything if EOF already reached */
     if (s->eof_reached)
@@ -832,6 +837,14 @@ uint64_t ffio_read_varlen(AVIOContext *bc){
     return val;
 }
 
+URLContext *ffio_geturlcontext(AVIOContext *s)
+{
+    if (s->write_packet == (int (*)(void *, uint8_t *, int))ffurl_write &&
+        s->read_packet  == (int (*)(void *, uint8_t *, int))ffurl_read)
+        return s->opaque;
+    return NULL;
+}
+
 int ffio_fdopen(AVIOContext **s, URLContext *h)
 {
     uint8_t *buffer;
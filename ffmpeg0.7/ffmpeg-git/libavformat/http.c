@@ -31,6 +31,9 @@
 #include "url.h"
 #include "libavutil/opt.h"
 #include "stdlib.h"
+#if HAVE_PTHREADS
+#include <pthread.h>
+#endif
 
 #define atoll(str) atoi(str)
 #define strtoll strtol
@@ -41,6 +44,10 @@
 /* used for protocol handling */
 #define BUFFER_SIZE 1024
 #define MAX_REDIRECTS 8
+/* connection pool */
+#define POOL_SIZE 8
+#define POOL_TIMEOUT 15000000  ///< close connections idle for longer (in microseconds)
+#define DRAIN_SIZE 65536       ///< read up to this many bytes on seek to keep a connection
 
 typedef struct {
     const AVClass *class;
@@ -54,11 +61,19 @@ typedef struct {
     HTTPAuthState auth_state;
     unsigned char headers[BUFFER_SIZE];
     int willclose;          /**< Set if the server correctly handles Connection: close and will close the connection after feeding us the content. */
+    int keep_alive;         /**< Keep connections open and reuse them for later requests to the same server. */
+    int64_t request_size;   /**< If > 0, request seekable resources in ranges of this size, asking for the next one ahead. */
+    int64_t content_length; /**< Content-Length of the current response, -1 if not sent. */
+    int64_t end_off;        /**< Offset at which the current response ends, -1 if it ends when the connection is closed. */
+    int64_t pipelined_off;  /**< Offset of the range already requested on this connection after the current one, -1 if none. */
+    char hd_addr[1024];     /**< Address of hd, used to look up and return connections in the pool. */
 } HTTPContext;
 
 #define OFFSET(x) offsetof(HTTPContext, x)
 static const AVOption options[] = {
 {"chunksize", "use chunked transfer-encoding for posts, -1 disables it, 0 enables it", OFFSET(chunksize), FF_OPT_TYPE_INT64, 0, -1, 0 }, /* Default to 0, for chunked POSTs */
+{"keep_alive", "reuse connections to the same server across requests", OFFSET(keep_alive), FF_OPT_TYPE_INT, 1, 0, 1 },
+{"request_size", "request seekable resources in ranges of this many bytes and pipeline the requests, 0 disables it", OFFSET(request_size), FF_OPT_TYPE_INT64, 0, 0, INT64_MAX },
 {NULL}
 };
 static const AVClass httpcontext_class = {
@@ -68,6 +83,98 @@ static const AVClass httpcontext_class = {
 static int http_connect(URLContext *h, const char *path, const char *hoststr,
                         const char *auth, int *new_location);
 
+/**
+ * Idle connections, shared by all HTTP contexts. A connection is only put
+ * here once the response to its last request has been read completely.
+ */
+typedef struct HTTPPoolEntry {
+    char addr[1024];
+    URLContext *hd;
+    int64_t idle_since;
+} HTTPPoolEntry;
+
+static HTTPPoolEntry pool[POOL_SIZE];
+
+#if HAVE_PTHREADS
+static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+#define pool_lock()   pthread_mutex_lock(&pool_mutex)
+#define pool_unlock() pthread_mutex_unlock(&pool_mutex)
+#else
+#define pool_lock()
+#define pool_unlock()
+#endif
+
+/**
+ * Take an idle connection to addr out of the pool, closing the connections
+ * that have been idle for too long on the way.
+ * @return the connection, or NULL if there is none
+ */
+static URLContext *pool_get(const char *addr)
+{
+    URLContext *hd = NULL;
+    int64_t now = av_gettime();
+    int i;
+
+    pool_lock();
+    for (i = 0; i < POOL_SIZE; i++) {
+        if (!pool[i].hd)
+            continue;
+        if (now - pool[i].idle_since > POOL_TIMEOUT) {
+            ffurl_close(pool[i].hd);
+            pool[i].hd = NULL;
+        } else if (!hd && !strcmp(pool[i].addr, addr)) {
+            hd = pool[i].hd;
+            pool[i].hd = NULL;
+        }
+    }
+    pool_unlock();
+    return hd;
+}
+
+/**
+ * Put an idle connection into the pool, replacing the one that has been
+ * idle the longest if the pool is full.
+ */
+static void pool_put(const char *addr, URLContext *hd)
+{
+    int i, slot = 0;
+
+    pool_lock();
+    for (i = 0; i < POOL_SIZE; i++) {
+        if (!pool[i].hd) {
+            slot = i;
+            break;
+        }
+        if (pool[i].idle_since < pool[slot].idle_since)
+            slot = i;
+    }
+    if (pool[slot].hd)
+        ffurl_close(pool[slot].hd);
+    av_strlcpy(pool[slot].addr, addr, sizeof(pool[slot].addr));
+    pool[slot].hd         = hd;
+    pool[slot].idle_since = av_gettime();
+    pool_unlock();
+}
+
+/**
+ * Detach the connection from the context. It is returned to the pool if
+ * it is between two responses, and closed otherwise.
+ */
+static void http_release_cnx(URLContext *h)
+{
+    HTTPContext *s = h->priv_data;
+
+    if (!s->hd)
+        return;
+    if (s->keep_alive && !(h->flags & AVIO_WRONLY) && !s->willclose &&
+        s->end_off >= 0 && s->off == s->end_off && s->pipelined_off < 0 &&
+        s->buf_ptr == s->buf_end)
+        pool_put(s->hd_addr, s->hd);
+    else
+        ffurl_close(s->hd);
+    s->hd = NULL;
+}
+
 void ff_http_set_headers(URLContext *h, const char *headers)
 {
     HTTPContext *s = h->priv_data;
@@ -90,32 +197,32 @@ void ff_http_init_auth_state(URLContext *dest, const URLContext *src)
            &((HTTPContext*)src->priv_data)->auth_state, sizeof(HTTPAuthState));
 }
 
-/* return non zero if error */
-static int http_open_cnx(URLContext *h)
+/**
+ * Split the current location into what is needed to send a request.
+ * @param addr filled with the URL of the tcp connection to use
+ * @param path1 scratch space for path, of size path_size
+ * @return the path to request
+ */
+static const char *http_split_location(HTTPContext *s, char *addr, int addr_size,
+                                       char *hoststr, int hoststr_size,
+                                       char *auth, int auth_size,
+                                       char *path1, int path_size)
 {
     const char *path, *proxy_path;
-    char hostname[1024], hoststr[1024];
-    char auth[1024];
-    char path1[1024];
-    char buf[1024];
-    int port, use_proxy, err, location_changed = 0, redirects = 0;
-    HTTPAuthType cur_auth_type;
-    HTTPContext *s = h->priv_data;
-    URLContext *hd = NULL;
+    char hostname[1024];
+    int port, use_proxy;
 
     proxy_path = getenv("http_proxy");
     use_proxy = (proxy_path != NULL) && !getenv("no_proxy") &&
         av_strstart(proxy_path, "http://", NULL);
 
-    /* fill the dest addr */
- redo:
     /* needed in any case to build the host string */
-    av_url_split(NULL, 0, auth, sizeof(auth), hostname, sizeof(hostname), &port,
-                 path1, sizeof(path1), s->location);
-    ff_url_join(hoststr, sizeof(hoststr), NULL, NULL, hostname, port, NULL);
+    av_url_split(NULL, 0, auth, auth_size, hostname, sizeof(hostname), &port,
+                 path1, path_size, s->location);
+    ff_url_join(hoststr, hoststr_size, NULL, NULL, hostname, port, NULL);
 
     if (use_proxy) {
-        av_url_split(NULL, 0, auth, sizeof(auth), hostname, sizeof(hostname), &port,
+        av_url_split(NULL, 0, auth, auth_size, hostname, sizeof(hostname), &port,
                      NULL, 0, proxy_path);
         path = s->location;
     } else {
@@ -127,18 +234,51 @@ static int http_open_cnx(URLContext *h)
     if (port < 0)
         port = 80;
 
-    ff_url_join(buf, sizeof(buf), "tcp", NULL, hostname, port, NULL);
-    err = ffurl_open(&hd, buf, AVIO_RDWR);
-    if (err < 0)
-        goto fail;
+    ff_url_join(addr, addr_size, "tcp", NULL, hostname, port, NULL);
+    return path;
+}
+
+/* return non zero if error */
+static int http_open_cnx(URLContext *h)
+{
+    const char *path;
+    char hoststr[1024];
+    char auth[1024];
+    char path1[1024];
+    int err, reused, location_changed = 0, redirects = 0;
+    HTTPAuthType cur_auth_type;
+    HTTPContext *s = h->priv_data;
+    URLContext *hd = NULL;
+
+    /* fill the dest addr */
+ redo:
+    path = http_split_location(s, s->hd_addr, sizeof(s->hd_addr),
+                               hoststr, sizeof(hoststr), auth, sizeof(auth),
+                               path1, sizeof(path1));
+
+    hd = NULL;
+    if (s->keep_alive && !(h->flags & AVIO_WRONLY))
+        hd = pool_get(s->hd_addr);
+    reused = hd != NULL;
+    if (!hd) {
+        err = ffurl_open(&hd, s->hd_addr, AVIO_RDWR);
+        if (err < 0)
+            goto fail;
+    }
 
     s->hd = hd;
     cur_auth_type = s->auth_state.auth_type;
-    if (http_connect(h, path, hoststr, auth, &location_changed) < 0)
+    if (http_connect(h, path, hoststr, auth, &location_changed) < 0) {
+        /* the server may have closed an idle connection in the meantime */
+        if (reused && !s->http_code) {
+            ffurl_close(hd);
+            goto redo;
+        }
         goto fail;
+    }
     if (s->http_code == 401) {
         if (cur_auth_type == HTTP_AUTH_NONE && s->auth_state.auth_type != HTTP_AUTH_NONE) {
-            ffurl_close(hd);
+            http_release_cnx(h);
             goto redo;
         } else
             goto fail;
@@ -146,7 +286,7 @@ static int http_open_cnx(URLContext *h)
     if ((s->http_code == 301 || s->http_code == 302 || s->http_code == 303 || s->http_code == 307)
         && location_changed == 1) {
         /* url moved, get next */
-        ffurl_close(hd);
+        http_release_cnx(h);
         if (redirects++ >= MAX_REDIRECTS)
             return AVERROR(EIO);
         location_changed = 0;
@@ -167,6 +307,8 @@ static int http_open(URLContext *h, const char *uri, int flags)
     h->is_streamed = 1;
 
     s->filesize = -1;
+    s->end_off = -1;
+    s->pipelined_off = -1;
     av_strlcpy(s->location, uri, sizeof(s->location));
 
     return http_open_cnx(h);
@@ -224,6 +366,9 @@ static int process_line(URLContext *h, char *line, int line_count,
 
     p = line;
     if (line_count == 0) {
+        /* HTTP/1.0 servers close the connection unless told otherwise */
+        if (!strncmp(p, "HTTP/1.0", 8))
+            s->willclose = 1;
         while (!isspace(*p) && *p != '\0')
             p++;
         while (isspace(*p))
@@ -254,8 +399,10 @@ static int process_line(URLContext *h, char *line, int line_count,
         if (!strcasecmp(tag, "Location")) {
             strcpy(s->location, p);
             *new_location = 1;
-        } else if (!strcasecmp (tag, "Content-Length") && s->filesize == -1) {
-            s->filesize = atoll(p);
+        } else if (!strcasecmp (tag, "Content-Length")) {
+            s->content_length = atoll(p);
+            if (s->filesize == -1)
+                s->filesize = s->content_length;
         } else if (!strcasecmp (tag, "Content-Range")) {
             /* "bytes $from-$to/$document_size" */
             const char *slash;
@@ -276,6 +423,8 @@ static int process_line(URLContext *h, char *line, int line_count,
         } else if (!strcasecmp (tag, "Connection")) {
             if (!strcmp(p, "close"))
                 s->willclose = 1;
+            else if (!strcasecmp(p, "keep-alive"))
+                s->willclose = 0;
         }
     }
     return 1;
@@ -287,18 +436,16 @@ static inline int has_header(const char *str, const char *header)
     return av_stristart(str, header + 2, NULL) || av_stristr(str, header);
 }
 
-static int http_connect(URLContext *h, const char *path, const char *hoststr,
-                        const char *auth, int *new_location)
+static int http_send_request(URLContext *h, const char *path,
+                             const char *hoststr, const char *auth, int64_t off)
 {
     HTTPContext *s = h->priv_data;
-    int post, err;
-    char line[1024];
+    int post;
+    char request[BUFFER_SIZE];
     char headers[1024] = "";
     char *authstr = NULL;
-    int64_t off = s->off;
     int len = 0;
 
-
     /* send http header */
     post = h->flags & AVIO_WRONLY;
     authstr = ff_http_auth_create_response(&s->auth_state, auth, path,
@@ -311,11 +458,19 @@ static int http_connect(URLContext *h, const char *path, const char *hoststr,
     if (!has_header(s->headers, "\r\nAccept: "))
         len += av_strlcpy(headers + len, "Accept: */*\r\n",
                           sizeof(headers) - len);
-    if (!has_header(s->headers, "\r\nRange: "))
-        len += av_strlcatf(headers + len, sizeof(headers) - len,
-                           "Range: bytes=%"PRId64"-\r\n", s->off);
+    if (!has_header(s->headers, "\r\nRange: ")) {
+        if (s->request_size > 0 && !post)
+            len += av_strlcatf(headers + len, sizeof(headers) - len,
+                               "Range: bytes=%"PRId64"-%"PRId64"\r\n",
+                               off, off + s->request_size - 1);
+        else
+            len += av_strlcatf(headers + len, sizeof(headers) - len,
+                               "Range: bytes=%"PRId64"-\r\n", off);
+    }
     if (!has_header(s->headers, "\r\nConnection: "))
-        len += av_strlcpy(headers + len, "Connection: close\r\n",
+        len += av_strlcpy(headers + len,
+                          s->keep_alive && !post ? "Connection: keep-alive\r\n"
+                                                 : "Connection: close\r\n",
                           sizeof(headers)-len);
     if (!has_header(s->headers, "\r\nHost: "))
         len += av_strlcatf(headers + len, sizeof(headers) - len,
@@ -324,7 +479,7 @@ static int http_connect(URLContext *h, const char *path, const char *hoststr,
     /* now add in custom headers */
     av_strlcpy(headers+len, s->headers, sizeof(headers)-len);
 
-    snprintf(s->buffer, sizeof(s->buffer),
+    snprintf(request, sizeof(request),
              "%s %s HTTP/1.1\r\n"
              "%s"
              "%s"
@@ -337,23 +492,23 @@ static int http_connect(URLContext *h, const char *path, const char *hoststr,
              authstr ? authstr : "");
 
     av_freep(&authstr);
-    if (ffurl_write(s->hd, s->buffer, strlen(s->buffer)) < 0)
+    if (ffurl_write(s->hd, request, strlen(request)) < 0)
         return AVERROR(EIO);
+    return 0;
+}
+
+static int http_read_header(URLContext *h, int *new_location)
+{
+    HTTPContext *s = h->priv_data;
+    char line[1024];
+    int err;
 
-    /* init input buffer */
-    s->buf_ptr = s->buffer;
-    s->buf_end = s->buffer;
     s->line_count = 0;
+    s->http_code = 0;
     s->off = 0;
     s->filesize = -1;
+    s->content_length = -1;
     s->willclose = 0;
-    if (post) {
-        /* Pretend that it did work. We didn't read any header yet, since
-         * we've still to send the POST data, but the code calling this
-         * function will check http_code after we return. */
-        s->http_code = 200;
-        return 0;
-    }
     s->chunksize = -1;
 
     /* wait for header */
@@ -371,15 +526,108 @@ static int http_connect(URLContext *h, const char *path, const char *hoststr,
         s->line_count++;
     }
 
-    return (off == s->off) ? 0 : -1;
+    if (s->chunksize < 0 && s->content_length >= 0)
+        s->end_off = s->off + s->content_length;
+    else
+        s->end_off = -1;
+    return 0;
+}
+
+/**
+ * Ask for the range following the current response on the same
+ * connection, so that it is on its way while the current one is read.
+ */
+static void http_pipeline_next(URLContext *h)
+{
+    HTTPContext *s = h->priv_data;
+    const char *path;
+    char addr[1024], hoststr[1024], auth[1024], path1[1024];
+
+    if (s->request_size <= 0 || !s->keep_alive || s->willclose ||
+        h->is_streamed || s->http_code / 100 != 2 || s->end_off < 0 ||
+        s->filesize < 0 || s->end_off >= s->filesize)
+        return;
+
+    path = http_split_location(s, addr, sizeof(addr), hoststr, sizeof(hoststr),
+                               auth, sizeof(auth), path1, sizeof(path1));
+    if (http_send_request(h, path, hoststr, auth, s->end_off) >= 0)
+        s->pipelined_off = s->end_off;
+}
+
+static int http_connect(URLContext *h, const char *path, const char *hoststr,
+                        const char *auth, int *new_location)
+{
+    HTTPContext *s = h->priv_data;
+    int64_t off = s->off;
+    int err;
+
+    s->http_code = 0;
+    s->pipelined_off = -1;
+    if ((err = http_send_request(h, path, hoststr, auth, off)) < 0)
+        return err;
+
+    /* init input buffer */
+    s->buf_ptr = s->buffer;
+    s->buf_end = s->buffer;
+    if (h->flags & AVIO_WRONLY) {
+        /* Pretend that it did work. We didn't read any header yet, since
+         * we've still to send the POST data, but the code calling this
+         * function will check http_code after we return. */
+        s->line_count = 0;
+        s->off = 0;
+        s->filesize = -1;
+        s->willclose = 0;
+        s->http_code = 200;
+        return 0;
+    }
+
+    if ((err = http_read_header(h, new_location)) < 0)
+        return err;
+    if (off != s->off)
+        return -1;
+    http_pipeline_next(h);
+    return 0;
 }
 
+/**
+ * Move on to the response for the range starting at the current offset,
+ * once the previous response has been read completely.
+ */
+static int http_next_range(URLContext *h)
+{
+    HTTPContext *s = h->priv_data;
+    int64_t off = s->off;
+    int new_location = 0;
+
+    if (s->pipelined_off < 0) {
+        http_release_cnx(h);
+        return http_open_cnx(h);
+    }
+    s->pipelined_off = -1;
+    if (http_read_header(h, &new_location) < 0 || s->off != off) {
+        /* start over on a new connection */
+        s->off = off;
+        http_release_cnx(h);
+        return http_open_cnx(h);
+    }
+    http_pipeline_next(h);
+    return 0;
+}
 
 static int http_read(URLContext *h, uint8_t *buf, int size)
 {
     HTTPContext *s = h->priv_data;
     int len;
 
+    if (!s->hd)
+        return AVERROR(EIO);
+    if (s->end_off >= 0 && s->off >= s->end_off &&
+        s->filesize >= 0 && s->off < s->filesize) {
+        /* more data follows in another range */
+        if ((len = http_next_range(h)) < 0)
+            return len;
+    }
+
     if (s->chunksize >= 0) {
         if (!s->chunksize) {
             char line[32];
@@ -401,6 +649,9 @@ static int http_read(URLContext *h, uint8_t *buf, int size)
         }
         size = FFMIN(size, s->chunksize);
     }
+    /* never read into the next response */
+    if (s->end_off >= 0)
+        size = FFMIN(size, s->end_off - s->off);
     /* read bytes from input buffer first */
     len = s->buf_end - s->buf_ptr;
     if (len > 0) {
@@ -429,6 +680,8 @@ static int http_write(URLContext *h, const uint8_t *buf, int size)
     char crlf[] = "\r\n";
     HTTPContext *s = h->priv_data;
 
+    if (!s->hd)
+        return AVERROR(EIO);
     if (s->chunksize == -1) {
         /* non-chunked data is sent without any special encoding */
         return ffurl_write(s->hd, buf, size);
@@ -455,13 +708,12 @@ static int http_close(URLContext *h)
     HTTPContext *s = h->priv_data;
 
     /* signal end of chunked encoding if used */
-    if ((h->flags & AVIO_WRONLY) && s->chunksize != -1) {
+    if ((h->flags & AVIO_WRONLY) && s->chunksize != -1 && s->hd) {
         ret = ffurl_write(s->hd, footer, sizeof(footer) - 1);
         ret = ret > 0 ? 0 : ret;
     }
 
-    if (s->hd)
-        ffurl_close(s->hd);
+    http_release_cnx(h);
     return ret;
 }
 
@@ -469,7 +721,9 @@ static int64_t http_seek(URLContext *h, int64_t off, int whence)
 {
     HTTPContext *s = h->priv_data;
     URLContext *old_hd = s->hd;
-    int64_t old_off = s->off;
+    int64_t old_off = s->off, old_filesize = s->filesize;
+    int64_t old_end_off = s->end_off, old_pipelined_off = s->pipelined_off;
+    int old_willclose = s->willclose;
     uint8_t old_buf[BUFFER_SIZE];
     int old_buf_size;
 
@@ -478,14 +732,41 @@ static int64_t http_seek(URLContext *h, int64_t off, int whence)
     else if ((s->filesize == -1 && whence == SEEK_END) || h->is_streamed)
         return -1;
 
-    /* we save the old context in case the seek fails */
-    old_buf_size = s->buf_end - s->buf_ptr;
-    memcpy(old_buf, s->buf_ptr, old_buf_size);
-    s->hd = NULL;
     if (whence == SEEK_CUR)
         off += s->off;
     else if (whence == SEEK_END)
         off += s->filesize;
+
+    /* If only a little is left of the current response, reading it is
+     * cheaper than a new connection: the next request reuses this one. */
+    if (s->keep_alive && !s->willclose && s->pipelined_off < 0 &&
+        s->end_off >= 0 && s->end_off - s->off <= DRAIN_SIZE) {
+        uint8_t tmp[BUFFER_SIZE];
+        int len = 0;
+        while (s->off < s->end_off &&
+               (len = http_read(h, tmp, FFMIN(sizeof(tmp), s->end_off - s->off))) > 0)
+            ;
+        if (len >= 0) {
+            http_release_cnx(h);
+            s->off = off;
+            if (http_open_cnx(h) >= 0)
+                return off;
+            /* the drained response is gone, resume the old position on a
+             * new connection; if even that fails s->hd stays NULL and
+             * further reads fail instead of using a released connection */
+            s->off = old_off;
+            if (http_open_cnx(h) < 0) {
+                s->hd  = NULL;
+                s->off = old_off;
+            }
+            return -1;
+        }
+    }
+
+    /* we save the old context in case the seek fails */
+    old_buf_size = s->buf_end - s->buf_ptr;
+    memcpy(old_buf, s->buf_ptr, old_buf_size);
+    s->hd = NULL;
     s->off = off;
 
     /* if it fails, continue on old connection */
@@ -495,6 +776,10 @@ static int64_t http_seek(URLContext *h, int64_t off, int whence)
         s->buf_end = s->buffer + old_buf_size;
         s->hd = old_hd;
         s->off = old_off;
+        s->filesize = old_filesize;
+        s->end_off = old_end_off;
+        s->pipelined_off = old_pipelined_off;
+        s->willclose = old_willclose;
         return -1;
     }
     ffurl_close(old_hd);
@@ -505,6 +790,8 @@ static int
 http_get_file_handle(URLContext *h)
 {
     HTTPContext *s = h->priv_data;
+    if (!s->hd)
+        return AVERROR(EIO);
     return ffurl_get_file_handle(s->hd);
 }
 
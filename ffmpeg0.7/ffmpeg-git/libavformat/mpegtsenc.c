@@ -30,6 +30,11 @@
 
 #define PCR_TIME_BASE 27000000
 
+/* we retransmit the SI info at this rate */
+#define SDT_RETRANS_TIME 500
+#define PAT_RETRANS_TIME 100
+#define PCR_RETRANS_TIME 20
+
 /* write DVB SI sections */
 
 /*********************************************/
@@ -50,6 +55,8 @@ typedef struct MpegTSService {
     int pcr_pid;
     int pcr_packet_count;
     int pcr_packet_period;
+    AVStream *pcr_st;
+    int64_t last_pcr_pos; ///< position of the last packet with a PCR, in CBR mode
 } MpegTSService;
 
 typedef struct MpegTSWrite {
@@ -72,6 +79,9 @@ typedef struct MpegTSWrite {
 
     int pmt_start_pid;
     int start_pid;
+
+    int pcr_period; ///< maximum interval between PCRs in CBR mode, in milliseconds
+    int pcr_warned; ///< av_log_once() state of the invalid PCR warning
 } MpegTSWrite;
 
 static const AVOption options[] = {
@@ -85,6 +95,8 @@ static const AVOption options[] = {
       offsetof(MpegTSWrite, pmt_start_pid), FF_OPT_TYPE_INT, 0x1000, 0x1000, 0x1f00, AV_OPT_FLAG_ENCODING_PARAM},
     { "mpegts_start_pid", "Set the first pid.",
       offsetof(MpegTSWrite, start_pid), FF_OPT_TYPE_INT, 0x0100, 0x0100, 0x0f00, AV_OPT_FLAG_ENCODING_PARAM},
+    { "mpegts_pcr_period", "Set the PCR interval in milliseconds when muxrate is set.",
+      offsetof(MpegTSWrite, pcr_period), FF_OPT_TYPE_INT, PCR_RETRANS_TIME, 1, 100, AV_OPT_FLAG_ENCODING_PARAM},
     { NULL },
 };
 
@@ -188,10 +200,6 @@ static int mpegts_write_section1(MpegTSSection *s, int tid, int id,
 #define DEFAULT_PES_HEADER_FREQ 16
 #define DEFAULT_PES_PAYLOAD_SIZE ((DEFAULT_PES_HEADER_FREQ - 1) * 184 + 170)
 
-/* we retransmit the SI info at this rate */
-#define SDT_RETRANS_TIME 500
-#define PAT_RETRANS_TIME 100
-#define PCR_RETRANS_TIME 20
 
 typedef struct MpegTSWriteStream {
     struct MpegTSService *service;
@@ -537,9 +545,13 @@ static int mpegts_write_header(AVFormatContext *s)
 
     ts->mux_rate = s->mux_rate ? s->mux_rate : 1;
 
+    service->pcr_st = pcr_st;
     if (ts->mux_rate > 1) {
-        service->pcr_packet_period = (ts->mux_rate * PCR_RETRANS_TIME) /
-            (TS_PACKET_SIZE * 8 * 1000);
+        /* in CBR mode, the byte position in the stream is the clock: the
+         * PCR is due every pcr_packet_period packets of the multiplex */
+        service->pcr_packet_period = FFMAX((int64_t)ts->mux_rate * ts->pcr_period /
+                                           (TS_PACKET_SIZE * 8 * 1000), 1);
+        service->last_pcr_pos      = INT64_MIN / 2;
         ts->sdt_packet_period      = (ts->mux_rate * SDT_RETRANS_TIME) /
             (TS_PACKET_SIZE * 8 * 1000);
         ts->pat_packet_period      = (ts->mux_rate * PAT_RETRANS_TIME) /
@@ -666,6 +678,7 @@ static void mpegts_insert_pcr_only(AVFormatContext *s, AVStream *st)
 
     /* PCR coded into 6 bytes */
     q = write_pcr_bits(q, get_pcr(ts, s->pb));
+    ts_st->service->last_pcr_pos = avio_tell(s->pb);
 
     /* stuffing bytes */
     memset(q, 0xFF, TS_PACKET_SIZE - (q - buf));
@@ -709,8 +722,19 @@ static void mpegts_write_pes(AVFormatContext *s, AVStream *st,
         retransmit_si_info(s);
 
         write_pcr = 0;
-        if (ts_st->pid == ts_st->service->pcr_pid) {
-            if (ts->mux_rate > 1 || is_start) // VBR pcr period is based on frames
+        if (ts->mux_rate > 1) {
+            MpegTSService *service = ts_st->service;
+            if (avio_tell(s->pb) - service->last_pcr_pos >=
+                (int64_t)service->pcr_packet_period * TS_PACKET_SIZE) {
+                if (ts_st->pid != service->pcr_pid) {
+                    /* the PCR stream has no packet to carry it right now */
+                    mpegts_insert_pcr_only(s, service->pcr_st);
+                    continue;
+                }
+                write_pcr = 1;
+            }
+        } else if (ts_st->pid == ts_st->service->pcr_pid) {
+            if (is_start) // VBR pcr period is based on frames
                 ts_st->service->pcr_packet_count++;
             if (ts_st->service->pcr_packet_count >=
                 ts_st->service->pcr_packet_period) {
@@ -741,12 +765,14 @@ static void mpegts_write_pes(AVFormatContext *s, AVStream *st,
         *q++ = 0x10 | ts_st->cc | (write_pcr ? 0x20 : 0);
         if (write_pcr) {
             // add 11, pcr references the last byte of program clock reference base
-            if (ts->mux_rate > 1)
+            if (ts->mux_rate > 1) {
                 pcr = get_pcr(ts, s->pb);
-            else
+                ts_st->service->last_pcr_pos = avio_tell(s->pb);
+            } else
                 pcr = (dts - delay)*300;
             if (dts != AV_NOPTS_VALUE && dts < pcr / 300)
-                av_log(s, AV_LOG_WARNING, "dts < pcr, TS is invalid\n");
+                av_log_once(s, AV_LOG_WARNING, AV_LOG_DEBUG, &ts->pcr_warned,
+                            "dts < pcr, TS is invalid\n");
             *q++ = 7; /* AFC length */
             *q++ = 0x10; /* flags: PCR present */
             q = write_pcr_bits(q, pcr);
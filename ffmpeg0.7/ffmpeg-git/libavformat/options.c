@@ -50,6 +50,8 @@ static const AVOption options[]={
 {"noparse", "disable AVParsers, this needs nofillin too", 0, FF_OPT_TYPE_CONST, AVFMT_FLAG_NOPARSE, INT_MIN, INT_MAX, D, "fflags"},
 {"igndts", "ignore dts", 0, FF_OPT_TYPE_CONST, AVFMT_FLAG_IGNDTS, INT_MIN, INT_MAX, D, "fflags"},
 {"rtphint", "add rtp hinting", 0, FF_OPT_TYPE_CONST, AVFMT_FLAG_RTP_HINT, INT_MIN, INT_MAX, E, "fflags"},
+{"adaptive", "select variants of adaptive streams by bandwidth", 0, FF_OPT_TYPE_CONST, AVFMT_FLAG_ADAPTIVE, INT_MIN, INT_MAX, D, "fflags"},
+{"clockrecovery", "recover the sender clock of live inputs from packet arrival times", 0, FF_OPT_TYPE_CONST, AVFMT_FLAG_CLOCK_RECOVERY, INT_MIN, INT_MAX, D, "fflags"},
 #if FF_API_OLD_METADATA
 {"track", " set the track number", OFFSET(track), FF_OPT_TYPE_INT, DEFAULT, 0, INT_MAX, E},
 {"year", "set the year", OFFSET(year), FF_OPT_TYPE_INT, DEFAULT, INT_MIN, INT_MAX, E},
@@ -61,6 +63,7 @@ static const AVOption options[]={
 {"fdebug", "print specific debug info", OFFSET(debug), FF_OPT_TYPE_FLAGS, DEFAULT, 0, INT_MAX, E|D, "fdebug"},
 {"ts", NULL, 0, FF_OPT_TYPE_CONST, FF_FDEBUG_TS, INT_MIN, INT_MAX, E|D, "fdebug"},
 {"max_delay", "maximum muxing or demuxing delay in microseconds", OFFSET(max_delay), FF_OPT_TYPE_INT, DEFAULT, 0, INT_MAX, E|D},
+{"prefetch_segments", "number of segments to download ahead", OFFSET(prefetch_segments), FF_OPT_TYPE_INT, 2, 0, 16, D},
 {NULL},
 };
 
@@ -68,7 +71,7 @@ static const AVOption options[]={
 #undef D
 #undef DEFAULT
 
-static const AVClass av_format_context_class = { "AVFormatContext", format_to_name, options, LIBAVUTIL_VERSION_INT };
+static const AVClass av_format_context_class = { "AVFormatContext", format_to_name, options, LIBAVUTIL_VERSION_INT, .flags = AV_CLASS_FLAG_STATIC };
 
 static void avformat_get_context_defaults(AVFormatContext *s)
 {
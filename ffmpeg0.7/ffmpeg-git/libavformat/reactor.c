@@ -0,0 +1,312 @@
+/*
+ * Event loop for receiving many network streams from one thread
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Event loop for receiving many network streams from one thread.
+ *
+ * The sockets of all registered inputs are watched together, with epoll
+ * where available and poll otherwise. An input is only read from once one
+ * of its sockets is readable, or once the RTP reordering delay of a queued
+ * packet has elapsed, and it is read in non-blocking mode until it has no
+ * more packets to return.
+ */
+
+#include "avformat.h"
+#include "internal.h"
+#include "network.h"
+#include "os_support.h"
+#include "rtsp.h"
+#if HAVE_EPOLL_CREATE
+#include <sys/epoll.h>
+#include <unistd.h>
+#endif
+
+/* RTSP control connection, plus RTP and RTCP sockets for each stream */
+#define MAX_SOURCE_FDS 33
+
+typedef struct ReactorSource {
+    AVFormatContext *s;
+    AVReactorCallback cb;
+    void *opaque;
+    int fds[MAX_SOURCE_FDS];
+    int nb_fds;
+    int ready;
+    int removed;
+} ReactorSource;
+
+struct AVReactor {
+    ReactorSource **sources;
+    int nb_sources;
+    int running;
+#if HAVE_EPOLL_CREATE
+    int epfd;
+    struct epoll_event events[64];
+#else
+    struct pollfd *p;
+    ReactorSource **p_source;
+    int nb_p;
+#endif
+};
+
+static int is_rtp_input(AVFormatContext *s)
+{
+    return s->iformat && (!strcmp(s->iformat->name, "rtsp") ||
+                          !strcmp(s->iformat->name, "sdp")  ||
+                          !strcmp(s->iformat->name, "rtp"));
+}
+
+AVReactor *av_reactor_alloc(void)
+{
+    AVReactor *r;
+
+    if (!ff_network_init())
+        return NULL;
+    r = av_mallocz(sizeof(*r));
+    if (!r)
+        return NULL;
+#if HAVE_EPOLL_CREATE
+    r->epfd = epoll_create(64);
+    if (r->epfd < 0) {
+        av_free(r);
+        return NULL;
+    }
+#endif
+    return r;
+}
+
+static void unwatch_source(AVReactor *r, ReactorSource *src)
+{
+#if HAVE_EPOLL_CREATE
+    int i;
+    for (i = 0; i < src->nb_fds; i++)
+        epoll_ctl(r->epfd, EPOLL_CTL_DEL, src->fds[i], NULL);
+#else
+    int i, j = 0;
+    for (i = 0; i < r->nb_p; i++) {
+        if (r->p_source[i] == src)
+            continue;
+        r->p[j]        = r->p[i];
+        r->p_source[j] = r->p_source[i];
+        j++;
+    }
+    r->nb_p = j;
+#endif
+}
+
+static int watch_source(AVReactor *r, ReactorSource *src)
+{
+    int i;
+#if HAVE_EPOLL_CREATE
+    for (i = 0; i < src->nb_fds; i++) {
+        struct epoll_event ev = { 0 };
+        ev.events   = EPOLLIN;
+        ev.data.ptr = src;
+        if (epoll_ctl(r->epfd, EPOLL_CTL_ADD, src->fds[i], &ev) < 0) {
+            int err = AVERROR(errno);
+            src->nb_fds = i;
+            unwatch_source(r, src);
+            return err;
+        }
+    }
+#else
+    struct pollfd *p;
+    ReactorSource **p_source;
+
+    p = av_realloc(r->p, (r->nb_p + src->nb_fds) * sizeof(*r->p));
+    if (!p)
+        return AVERROR(ENOMEM);
+    r->p = p;
+    p_source = av_realloc(r->p_source,
+                          (r->nb_p + src->nb_fds) * sizeof(*r->p_source));
+    if (!p_source)
+        return AVERROR(ENOMEM);
+    r->p_source = p_source;
+    for (i = 0; i < src->nb_fds; i++) {
+        r->p[r->nb_p].fd          = src->fds[i];
+        r->p[r->nb_p].events      = POLLIN;
+        r->p[r->nb_p].revents     = 0;
+        r->p_source[r->nb_p++]    = src;
+    }
+#endif
+    return 0;
+}
+
+int av_reactor_add(AVReactor *r, AVFormatContext *s,
+                   AVReactorCallback cb, void *opaque)
+{
+    ReactorSource *src;
+    int ret;
+
+    if (!is_rtp_input(s))
+        return AVERROR(ENOSYS);
+    src = av_mallocz(sizeof(*src));
+    if (!src)
+        return AVERROR(ENOMEM);
+    src->s      = s;
+    src->cb     = cb;
+    src->opaque = opaque;
+    src->nb_fds = ff_rtsp_get_file_handles(s, src->fds, MAX_SOURCE_FDS);
+    if (src->nb_fds <= 0) {
+        av_free(src);
+        return AVERROR(EINVAL);
+    }
+    if ((ret = watch_source(r, src)) < 0) {
+        av_free(src);
+        return ret;
+    }
+    /* data may have arrived before the input was registered */
+    src->ready = 1;
+    s->flags |= AVFMT_FLAG_NONBLOCK;
+    dynarray_add(&r->sources, &r->nb_sources, src);
+    return 0;
+}
+
+static void free_removed_sources(AVReactor *r)
+{
+    int i, j = 0;
+
+    for (i = 0; i < r->nb_sources; i++) {
+        if (r->sources[i]->removed)
+            av_free(r->sources[i]);
+        else
+            r->sources[j++] = r->sources[i];
+    }
+    r->nb_sources = j;
+}
+
+static void remove_source(AVReactor *r, ReactorSource *src)
+{
+    if (src->removed)
+        return;
+    unwatch_source(r, src);
+    src->s->flags &= ~AVFMT_FLAG_NONBLOCK;
+    src->removed = 1;
+    /* sources still referenced by pending events are freed after them */
+    if (!r->running)
+        free_removed_sources(r);
+}
+
+void av_reactor_remove(AVReactor *r, AVFormatContext *s)
+{
+    int i;
+
+    for (i = 0; i < r->nb_sources; i++) {
+        if (r->sources[i]->s == s) {
+            remove_source(r, r->sources[i]);
+            break;
+        }
+    }
+}
+
+/**
+ * Read all packets that the input can return without blocking.
+ * @return number of packets delivered
+ */
+static int service_source(AVReactor *r, ReactorSource *src)
+{
+    int n = 0;
+
+    src->ready = 0;
+    while (!src->removed) {
+        AVPacket pkt;
+        int ret = av_read_frame(src->s, &pkt);
+        if (ret == AVERROR(EAGAIN))
+            break;
+        if (ret < 0) {
+            src->cb(src->opaque, src->s, NULL);
+            remove_source(r, src);
+            break;
+        }
+        n++;
+        if (src->cb(src->opaque, src->s, &pkt) < 0)
+            remove_source(r, src);
+    }
+    return n;
+}
+
+int av_reactor_run(AVReactor *r, int timeout)
+{
+    int64_t now = av_gettime();
+    int i, n, ret = 0;
+
+    /* don't sleep past the release of any packet held for reordering */
+    for (i = 0; i < r->nb_sources; i++) {
+        int64_t wakeup = ff_rtsp_get_wakeup_time(r->sources[i]->s);
+        if (r->sources[i]->ready) {
+            timeout = 0;
+        } else if (wakeup) {
+            int delay = FFMAX(wakeup - now + 999, 0) / 1000;
+            timeout = timeout < 0 ? delay : FFMIN(timeout, delay);
+        }
+    }
+
+#if HAVE_EPOLL_CREATE
+    n = epoll_wait(r->epfd, r->events, FF_ARRAY_ELEMS(r->events), timeout);
+    if (n < 0 && errno != EINTR)
+        return AVERROR(errno);
+    for (i = 0; i < n; i++) {
+        ReactorSource *src = r->events[i].data.ptr;
+        src->ready = 1;
+    }
+#else
+    n = poll(r->p, r->nb_p, timeout);
+    if (n < 0 && errno != EINTR)
+        return AVERROR(errno);
+    for (i = 0; i < r->nb_p && n > 0; i++) {
+        if (r->p[i].revents & (POLLIN | POLLERR | POLLHUP))
+            r->p_source[i]->ready = 1;
+    }
+#endif
+
+    now = av_gettime();
+    r->running = 1;
+    for (i = 0; i < r->nb_sources; i++) {
+        ReactorSource *src = r->sources[i];
+        int64_t wakeup = ff_rtsp_get_wakeup_time(src->s);
+        if (src->ready || (wakeup && now - wakeup >= 0))
+            ret += service_source(r, src);
+    }
+    r->running = 0;
+    free_removed_sources(r);
+    return ret;
+}
+
+void av_reactor_free(AVReactor **pr)
+{
+    AVReactor *r = *pr;
+    int i;
+
+    if (!r)
+        return;
+    r->running = 1;
+    for (i = 0; i < r->nb_sources; i++)
+        remove_source(r, r->sources[i]);
+    free_removed_sources(r);
+    av_freep(&r->sources);
+#if HAVE_EPOLL_CREATE
+    close(r->epfd);
+#else
+    av_freep(&r->p);
+    av_freep(&r->p_source);
+#endif
+    av_freep(pr);
+    ff_network_close();
+}
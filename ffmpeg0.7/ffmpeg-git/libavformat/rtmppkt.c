@@ -157,13 +157,37 @@ int ff_rtmp_packet_read(URLContext *h, RTMPPacket *p,
     return size;
 }
 
+/**
+ * Write the basic header of a chunk, which carries the chunk stream ID.
+ */
+static void put_basic_header(uint8_t **p, int channel_id, int mode)
+{
+    if (channel_id < 64) {
+        bytestream_put_byte(p, channel_id | (mode << 6));
+    } else if (channel_id < 64 + 256) {
+        bytestream_put_byte(p, 0          | (mode << 6));
+        bytestream_put_byte(p, channel_id - 64);
+    } else {
+        bytestream_put_byte(p, 1          | (mode << 6));
+        bytestream_put_le16(p, channel_id - 64);
+    }
+}
+
 int ff_rtmp_packet_write(URLContext *h, RTMPPacket *pkt,
                          int chunk_size, RTMPPacket *prev_pkt)
 {
-    uint8_t pkt_hdr[16], *p = pkt_hdr;
+    uint8_t *buf, *p;
     int mode = RTMP_PS_TWELVEBYTES;
     int off = 0;
-    int size = 0;
+    int size, ret;
+
+    /* the whole message is sent with one write: the full header, then
+     * the chunks, each one after the first preceded by a basic header */
+    buf = av_malloc(RTMP_MAX_HEADER_SIZE +
+                    pkt->data_size + 3 * (pkt->data_size / chunk_size));
+    if (!buf)
+        return AVERROR(ENOMEM);
+    p = buf;
 
     pkt->ts_delta = pkt->timestamp - prev_pkt[pkt->channel_id].timestamp;
 
@@ -180,15 +204,7 @@ int ff_rtmp_packet_write(URLContext *h, RTMPPacket *pkt,
         }
     }
 
-    if (pkt->channel_id < 64) {
-        bytestream_put_byte(&p, pkt->channel_id | (mode << 6));
-    } else if (pkt->channel_id < 64 + 256) {
-        bytestream_put_byte(&p, 0               | (mode << 6));
-        bytestream_put_byte(&p, pkt->channel_id - 64);
-    } else {
-        bytestream_put_byte(&p, 1               | (mode << 6));
-        bytestream_put_le16(&p, pkt->channel_id - 64);
-    }
+    put_basic_header(&p, pkt->channel_id, mode);
     if (mode != RTMP_PS_ONEBYTE) {
         uint32_t timestamp = pkt->timestamp;
         if (mode != RTMP_PS_TWELVEBYTES)
@@ -215,19 +231,17 @@ int ff_rtmp_packet_write(URLContext *h, RTMPPacket *pkt,
     }
     prev_pkt[pkt->channel_id].extra      = pkt->extra;
 
-    ffurl_write(h, pkt_hdr, p-pkt_hdr);
-    size = p - pkt_hdr + pkt->data_size;
     while (off < pkt->data_size) {
         int towrite = FFMIN(chunk_size, pkt->data_size - off);
-        ffurl_write(h, pkt->data + off, towrite);
+        bytestream_put_buffer(&p, pkt->data + off, towrite);
         off += towrite;
-        if (off < pkt->data_size) {
-            uint8_t marker = 0xC0 | pkt->channel_id;
-            ffurl_write(h, &marker, 1);
-            size++;
-        }
+        if (off < pkt->data_size)
+            put_basic_header(&p, pkt->channel_id, RTMP_PS_ONEBYTE);
     }
-    return size;
+    size = p - buf;
+    ret  = ffurl_write(h, buf, size);
+    av_free(buf);
+    return ret < 0 ? ret : size;
 }
 
 int ff_rtmp_packet_create(RTMPPacket *pkt, int channel_id, RTMPPacketType type,
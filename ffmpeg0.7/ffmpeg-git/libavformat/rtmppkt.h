@@ -28,6 +28,10 @@
 /** maximum possible number of different RTMP channels */
 #define RTMP_CHANNELS 65599
 
+/** maximum size of a chunk header: 3-byte basic header, 11-byte message
+ *  header and extended timestamp */
+#define RTMP_MAX_HEADER_SIZE 18
+
 /**
  * channels used to for RTMP packets with different purposes (i.e. data, network
  * control, remote procedure calls, etc.)
@@ -117,7 +121,8 @@ int ff_rtmp_packet_read(URLContext *h, RTMPPacket *p,
                         int chunk_size, RTMPPacket *prev_pkt);
 
 /**
- * Send RTMP packet to the server.
+ * Send RTMP packet to the server. All the chunks of the packet are sent
+ * with a single write.
  *
  * @param h          reader context
  * @param p          packet to send
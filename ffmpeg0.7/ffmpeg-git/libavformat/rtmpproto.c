@@ -27,6 +27,7 @@
 #include "libavcodec/bytestream.h"
 #include "libavutil/avstring.h"
 #include "libavutil/lfg.h"
+#include "libavutil/opt.h"
 #include "libavutil/sha.h"
 #include "avformat.h"
 #include "internal.h"
@@ -64,9 +65,11 @@ typedef enum {
 
 /** protocol handler context */
 typedef struct RTMPContext {
+    const AVClass *class;
     URLContext*   stream;                     ///< TCP stream used in interactions with RTMP server
     RTMPPacket    prev_pkt[2][RTMP_CHANNELS]; ///< packet history used when reading and sending packets
-    int           chunk_size;                 ///< size of the chunks RTMP packets are divided into
+    int           in_chunk_size;              ///< size of the chunks received RTMP packets are divided into
+    int           out_chunk_size;             ///< size of the chunks sent RTMP packets are divided into
     int           is_input;                   ///< input/output flag
     char          playpath[256];              ///< path to filename to play (with possible "mp4:" prefix)
     char          app[128];                   ///< application
@@ -79,8 +82,21 @@ typedef struct RTMPContext {
     uint32_t      client_report_size;         ///< number of bytes after which client should report to server
     uint32_t      bytes_read;                 ///< number of bytes read from server
     uint32_t      last_bytes_read;            ///< number of bytes read last reported to server
+    int64_t       write_time;                 ///< total time spent sending media packets, in microseconds
+    int64_t       max_write_time;             ///< longest time spent sending one media packet
+    int           nb_writes;                  ///< number of media packets sent
 } RTMPContext;
 
+#define OFFSET(x) offsetof(RTMPContext, x)
+static const AVOption options[] = {
+{"chunk_size", "size of the chunks published packets are divided into", OFFSET(out_chunk_size), FF_OPT_TYPE_INT, 4096, 128, 0xFFFFFF },
+{NULL}
+};
+
+static const AVClass rtmp_class = {
+    "RTMP", av_default_item_name, options, LIBAVUTIL_VERSION_INT
+};
+
 #define PLAYER_KEY_OPEN_PART_LEN 30   ///< length of partial key used for first client digest signing
 /** Client key used for digest signing */
 static const uint8_t rtmp_player_key[] = {
@@ -152,7 +168,7 @@ static void gen_connect(URLContext *s, RTMPContext *rt, const char *proto,
 
     pkt.data_size = p - pkt.data;
 
-    ff_rtmp_packet_write(rt->stream, &pkt, rt->chunk_size, rt->prev_pkt[1]);
+    ff_rtmp_packet_write(rt->stream, &pkt, rt->out_chunk_size, rt->prev_pkt[1]);
     ff_rtmp_packet_destroy(&pkt);
 }
 
@@ -175,7 +191,7 @@ static void gen_release_stream(URLContext *s, RTMPContext *rt)
     ff_amf_write_null(&p);
     ff_amf_write_string(&p, rt->playpath);
 
-    ff_rtmp_packet_write(rt->stream, &pkt, rt->chunk_size, rt->prev_pkt[1]);
+    ff_rtmp_packet_write(rt->stream, &pkt, rt->out_chunk_size, rt->prev_pkt[1]);
     ff_rtmp_packet_destroy(&pkt);
 }
 
@@ -198,7 +214,7 @@ static void gen_fcpublish_stream(URLContext *s, RTMPContext *rt)
     ff_amf_write_null(&p);
     ff_amf_write_string(&p, rt->playpath);
 
-    ff_rtmp_packet_write(rt->stream, &pkt, rt->chunk_size, rt->prev_pkt[1]);
+    ff_rtmp_packet_write(rt->stream, &pkt, rt->out_chunk_size, rt->prev_pkt[1]);
     ff_rtmp_packet_destroy(&pkt);
 }
 
@@ -221,7 +237,7 @@ static void gen_fcunpublish_stream(URLContext *s, RTMPContext *rt)
     ff_amf_write_null(&p);
     ff_amf_write_string(&p, rt->playpath);
 
-    ff_rtmp_packet_write(rt->stream, &pkt, rt->chunk_size, rt->prev_pkt[1]);
+    ff_rtmp_packet_write(rt->stream, &pkt, rt->out_chunk_size, rt->prev_pkt[1]);
     ff_rtmp_packet_destroy(&pkt);
 }
 
@@ -242,7 +258,7 @@ static void gen_create_stream(URLContext *s, RTMPContext *rt)
     ff_amf_write_number(&p, rt->is_input ? 3.0 : 4.0);
     ff_amf_write_null(&p);
 
-    ff_rtmp_packet_write(rt->stream, &pkt, rt->chunk_size, rt->prev_pkt[1]);
+    ff_rtmp_packet_write(rt->stream, &pkt, rt->out_chunk_size, rt->prev_pkt[1]);
     ff_rtmp_packet_destroy(&pkt);
 }
 
@@ -265,8 +281,27 @@ static void gen_delete_stream(URLContext *s, RTMPContext *rt)
     ff_amf_write_null(&p);
     ff_amf_write_number(&p, rt->main_channel_id);
 
-    ff_rtmp_packet_write(rt->stream, &pkt, rt->chunk_size, rt->prev_pkt[1]);
+    ff_rtmp_packet_write(rt->stream, &pkt, rt->out_chunk_size, rt->prev_pkt[1]);
+    ff_rtmp_packet_destroy(&pkt);
+}
+
+/**
+ * Generate chunk size change message and send it to the server, then use
+ * the new size for the following packets.
+ */
+static void gen_chunk_size(URLContext *s, RTMPContext *rt, int chunk_size)
+{
+    RTMPPacket pkt;
+    uint8_t *p;
+
+    av_log(LOG_CONTEXT, AV_LOG_DEBUG, "Setting chunk size to %d\n", chunk_size);
+    ff_rtmp_packet_create(&pkt, RTMP_NETWORK_CHANNEL, RTMP_PT_CHUNK_SIZE, 0, 4);
+
+    p = pkt.data;
+    bytestream_put_be32(&p, chunk_size);
+    ff_rtmp_packet_write(rt->stream, &pkt, rt->out_chunk_size, rt->prev_pkt[1]);
     ff_rtmp_packet_destroy(&pkt);
+    rt->out_chunk_size = chunk_size;
 }
 
 /**
@@ -289,7 +324,7 @@ static void gen_play(URLContext *s, RTMPContext *rt)
     ff_amf_write_null(&p);
     ff_amf_write_string(&p, rt->playpath);
 
-    ff_rtmp_packet_write(rt->stream, &pkt, rt->chunk_size, rt->prev_pkt[1]);
+    ff_rtmp_packet_write(rt->stream, &pkt, rt->out_chunk_size, rt->prev_pkt[1]);
     ff_rtmp_packet_destroy(&pkt);
 
     // set client buffer time disguised in ping packet
@@ -300,7 +335,7 @@ static void gen_play(URLContext *s, RTMPContext *rt)
     bytestream_put_be32(&p, 1);
     bytestream_put_be32(&p, 256); //TODO: what is a good value here?
 
-    ff_rtmp_packet_write(rt->stream, &pkt, rt->chunk_size, rt->prev_pkt[1]);
+    ff_rtmp_packet_write(rt->stream, &pkt, rt->out_chunk_size, rt->prev_pkt[1]);
     ff_rtmp_packet_destroy(&pkt);
 }
 
@@ -324,7 +359,7 @@ static void gen_publish(URLContext *s, RTMPContext *rt)
     ff_amf_write_string(&p, rt->playpath);
     ff_amf_write_string(&p, "live");
 
-    ff_rtmp_packet_write(rt->stream, &pkt, rt->chunk_size, rt->prev_pkt[1]);
+    ff_rtmp_packet_write(rt->stream, &pkt, rt->out_chunk_size, rt->prev_pkt[1]);
     ff_rtmp_packet_destroy(&pkt);
 }
 
@@ -340,7 +375,7 @@ static void gen_pong(URLContext *s, RTMPContext *rt, RTMPPacket *ppkt)
     p = pkt.data;
     bytestream_put_be16(&p, 7);
     bytestream_put_be32(&p, AV_RB32(ppkt->data+2));
-    ff_rtmp_packet_write(rt->stream, &pkt, rt->chunk_size, rt->prev_pkt[1]);
+    ff_rtmp_packet_write(rt->stream, &pkt, rt->out_chunk_size, rt->prev_pkt[1]);
     ff_rtmp_packet_destroy(&pkt);
 }
 
@@ -355,7 +390,7 @@ static void gen_bytes_read(URLContext *s, RTMPContext *rt, uint32_t ts)
     ff_rtmp_packet_create(&pkt, RTMP_NETWORK_CHANNEL, RTMP_PT_BYTES_READ, ts, 4);
     p = pkt.data;
     bytestream_put_be32(&p, rt->bytes_read);
-    ff_rtmp_packet_write(rt->stream, &pkt, rt->chunk_size, rt->prev_pkt[1]);
+    ff_rtmp_packet_write(rt->stream, &pkt, rt->out_chunk_size, rt->prev_pkt[1]);
     ff_rtmp_packet_destroy(&pkt);
 }
 
@@ -564,14 +599,12 @@ static int rtmp_parse_result(URLContext *s, RTMPContext *rt, RTMPPacket *pkt)
                    "Chunk size change packet is not 4 bytes long (%d)\n", pkt->data_size);
             return -1;
         }
-        if (!rt->is_input)
-            ff_rtmp_packet_write(rt->stream, pkt, rt->chunk_size, rt->prev_pkt[1]);
-        rt->chunk_size = AV_RB32(pkt->data);
-        if (rt->chunk_size <= 0) {
-            av_log(LOG_CONTEXT, AV_LOG_ERROR, "Incorrect chunk size %d\n", rt->chunk_size);
+        rt->in_chunk_size = AV_RB32(pkt->data);
+        if (rt->in_chunk_size <= 0) {
+            av_log(LOG_CONTEXT, AV_LOG_ERROR, "Incorrect chunk size %d\n", rt->in_chunk_size);
             return -1;
         }
-        av_log(LOG_CONTEXT, AV_LOG_DEBUG, "New chunk size = %d\n", rt->chunk_size);
+        av_log(LOG_CONTEXT, AV_LOG_DEBUG, "New chunk size = %d\n", rt->in_chunk_size);
         break;
     case RTMP_PT_PING:
         t = AV_RB16(pkt->data);
@@ -694,7 +727,7 @@ static int get_packet(URLContext *s, int for_header)
     for (;;) {
         RTMPPacket rpkt;
         if ((ret = ff_rtmp_packet_read(rt->stream, &rpkt,
-                                       rt->chunk_size, rt->prev_pkt[0])) <= 0) {
+                                       rt->in_chunk_size, rt->prev_pkt[0])) <= 0) {
             if (ret == 0) {
                 return AVERROR(EAGAIN);
             } else {
@@ -787,9 +820,13 @@ static int rtmp_close(URLContext *h)
     if (rt->state > STATE_HANDSHAKED)
         gen_delete_stream(h, rt);
 
+    if (rt->nb_writes)
+        av_log(LOG_CONTEXT, AV_LOG_VERBOSE,
+               "Sent %d packets, write time average %"PRId64" us, max %"PRId64" us\n",
+               rt->nb_writes, rt->write_time / rt->nb_writes, rt->max_write_time);
+
     av_freep(&rt->flv_data);
     ffurl_close(rt->stream);
-    av_free(rt);
     return 0;
 }
 
@@ -810,10 +847,7 @@ static int rtmp_open(URLContext *s, const char *uri, int flags)
     int port;
     int ret;
 
-    rt = av_mallocz(sizeof(RTMPContext));
-    if (!rt)
-        return AVERROR(ENOMEM);
-    s->priv_data = rt;
+    rt = s->priv_data;
     rt->is_input = !(flags & AVIO_WRONLY);
 
     av_url_split(proto, sizeof(proto), NULL, 0, hostname, sizeof(hostname), &port,
@@ -832,8 +866,17 @@ static int rtmp_open(URLContext *s, const char *uri, int flags)
     if (rtmp_handshake(s, rt))
         return -1;
 
-    rt->chunk_size = 128;
+    rt->in_chunk_size = 128;
     rt->state = STATE_HANDSHAKED;
+    if (!rt->is_input) {
+        /* larger chunks mean fewer chunk headers per media packet */
+        int chunk_size = rt->out_chunk_size;
+        rt->out_chunk_size = 128;
+        gen_chunk_size(s, rt, chunk_size);
+    } else {
+        /* only commands are sent, keep the default size the server assumes */
+        rt->out_chunk_size = 128;
+    }
     //extract "app" part from path
     if (!strncmp(path, "/ondemand/", 10)) {
         fname = path + 10;
@@ -930,7 +973,7 @@ static int rtmp_write(URLContext *s, const uint8_t *buf, int size)
 {
     RTMPContext *rt = s->priv_data;
     int size_temp = size;
-    int pktsize, pkttype;
+    int pktsize, pkttype, ret;
     uint32_t ts;
     const uint8_t *buf_temp = buf;
 
@@ -981,10 +1024,24 @@ static int rtmp_write(URLContext *s, const uint8_t *buf, int size)
         }
 
         if (rt->flv_off == rt->flv_size) {
+            int64_t start, elapsed;
+
             bytestream_get_be32(&buf_temp);
 
-            ff_rtmp_packet_write(rt->stream, &rt->out_pkt, rt->chunk_size, rt->prev_pkt[1]);
+            start = av_gettime();
+            ret = ff_rtmp_packet_write(rt->stream, &rt->out_pkt,
+                                       rt->out_chunk_size, rt->prev_pkt[1]);
+            elapsed = av_gettime() - start;
+            if (ret >= 0)
+                av_log(LOG_CONTEXT, AV_LOG_DEBUG,
+                       "Sent packet type %d, %d bytes in %"PRId64" us\n",
+                       rt->out_pkt.type, ret, elapsed);
             ff_rtmp_packet_destroy(&rt->out_pkt);
+            if (ret < 0)
+                return ret;
+            rt->write_time    += elapsed;
+            rt->max_write_time = FFMAX(rt->max_write_time, elapsed);
+            rt->nb_writes++;
             rt->flv_size = 0;
             rt->flv_off = 0;
         }
@@ -998,4 +1055,6 @@ URLProtocol ff_rtmp_protocol = {
     .url_read  = rtmp_read,
     .url_write = rtmp_write,
     .url_close = rtmp_close,
+    .priv_data_size  = sizeof(RTMPContext),
+    .priv_data_class = &rtmp_class,
 };
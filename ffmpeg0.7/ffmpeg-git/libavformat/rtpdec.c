@@ -220,21 +220,22 @@ static int rtp_valid_packet_in_sequence(RTPStatistics *s, uint16_t seq)
     return 1;
 }
 
-#if 0
 /**
-* This function is currently unused; without a valid local ntp time, I don't see how we could calculate the
-* difference between the arrival and sent timestamp.  As a result, the jitter and transit statistics values
-* never change.  I left this in in case someone else can see a way. (rdm)
+* Update the interarrival jitter estimate (RFC 3550 section 6.4.1). The
+* arrival time only needs to be in RTP timestamp units, not synchronized
+* with the sender, since only differences of the transit time are used.
 */
 static void rtcp_update_jitter(RTPStatistics *s, uint32_t sent_timestamp, uint32_t arrival_timestamp)
 {
     uint32_t transit= arrival_timestamp - sent_timestamp;
-    int d;
+    uint32_t prev_transit= s->transit;
+    int32_t d;
     s->transit= transit;
-    d= FFABS(transit - s->transit);
+    if (!prev_transit)
+        return;
+    d= FFABS((int32_t)(transit - prev_transit));
     s->jitter += d - ((s->jitter + 8)>>4);
 }
-#endif
 
 int rtp_check_and_send_back_rr(RTPDemuxContext *s, int count)
 {
@@ -390,10 +391,22 @@ RTPDemuxContext *rtp_parse_open(AVFormatContext *s1, AVStream *st, URLContext *r
     s->ic = s1;
     s->st = st;
     s->queue_size = queue_size;
+    if (queue_size > 1) {
+        int slots = 1;
+        while (slots < queue_size)
+            slots <<= 1;
+        s->queue = av_mallocz(slots * sizeof(*s->queue));
+        if (!s->queue) {
+            av_free(s);
+            return NULL;
+        }
+        s->queue_mask = slots - 1;
+    }
     rtp_init_statistics(&s->statistics, 0); // do we know the initial sequence from sdp?
     if (!strcmp(ff_rtp_enc_name(payload_type), "MP2T")) {
         s->ts = ff_mpegts_parse_open(s->ic);
         if (s->ts == NULL) {
+            av_free(s->queue);
             av_free(s);
             return NULL;
         }
@@ -679,75 +692,117 @@ static int rtp_parse_packet_internal(RTPDemuxContext *s, AVPacket *pkt,
 
 void ff_rtp_reset_packet_queue(RTPDemuxContext *s)
 {
-    while (s->queue) {
-        RTPPacket *next = s->queue->next;
-        av_free(s->queue->buf);
-        av_free(s->queue);
-        s->queue = next;
-    }
+    int i;
+
+    if (s->queue)
+        for (i = 0; i <= s->queue_mask; i++)
+            s->queue[i].len = 0;
+    s->overflow.len = 0;
     s->seq       = 0;
     s->queue_len = 0;
     s->prev_ret  = 0;
 }
 
-static void enqueue_packet(RTPDemuxContext *s, uint8_t *buf, int len)
+static int store_packet(RTPPacket *packet, const uint8_t *buf, int len,
+                        int64_t recvtime)
 {
-    uint16_t seq = AV_RB16(buf + 2);
-    RTPPacket *cur = s->queue, *prev = NULL, *packet;
+    av_fast_malloc(&packet->buf, &packet->buf_size, len);
+    if (!packet->buf)
+        return AVERROR(ENOMEM);
+    memcpy(packet->buf, buf, len);
+    packet->seq      = AV_RB16(buf + 2);
+    packet->len      = len;
+    packet->recvtime = recvtime;
+    return 0;
+}
 
-    /* Find the correct place in the queue to insert the packet */
-    while (cur) {
-        int16_t diff = seq - cur->seq;
-        if (diff < 0)
-            break;
-        prev = cur;
-        cur = cur->next;
-    }
+static void enqueue_packet(RTPDemuxContext *s, uint8_t *buf, int len,
+                           int64_t recvtime)
+{
+    uint16_t seq = AV_RB16(buf + 2);
+    RTPPacket *packet = &s->queue[seq & s->queue_mask];
 
-    packet = av_mallocz(sizeof(*packet));
-    if (!packet)
+    /* The caller made sure seq is within queue_mask + 1 of s->seq, so
+     * every queued packet has a slot of its own. */
+    if (packet->len)
+        return; /* duplicate */
+    if (store_packet(packet, buf, len, recvtime) < 0)
         return;
-    packet->recvtime = av_gettime();
-    packet->seq = seq;
-    packet->len = len;
-    packet->buf = buf;
-    packet->next = cur;
-    if (prev)
-        prev->next = packet;
-    else
-        s->queue = packet;
+
+    if (!s->queue_len) {
+        s->queue_head = s->queue_tail = seq;
+    } else {
+        if ((int16_t)(seq - s->queue_head) < 0)
+            s->queue_head = seq;
+        if ((int16_t)(seq - s->queue_tail) > 0)
+            s->queue_tail = seq;
+        else
+            s->packets_reordered++;
+    }
     s->queue_len++;
 }
 
 static int has_next_packet(RTPDemuxContext *s)
 {
-    return s->queue && s->queue->seq == (uint16_t) (s->seq + 1);
+    /* A pending overflow packet forces the queue to be drained */
+    if (s->overflow.len)
+        return 1;
+    return s->queue_len && s->queue_head == (uint16_t) (s->seq + 1);
+}
+
+static RTPPacket *first_queued_packet(RTPDemuxContext *s)
+{
+    if (s->queue_len > 0)
+        return &s->queue[s->queue_head & s->queue_mask];
+    if (s->overflow.len)
+        return &s->overflow;
+    return NULL;
 }
 
 int64_t ff_rtp_queued_packet_time(RTPDemuxContext *s)
 {
-    return s->queue ? s->queue->recvtime : 0;
+    RTPPacket *packet = first_queued_packet(s);
+    return packet ? packet->recvtime : 0;
+}
+
+int64_t ff_rtp_playout_delay(RTPDemuxContext *s, int64_t max_delay)
+{
+    int64_t delay;
+
+    /* Wait for the full delay until the jitter estimate has settled */
+    if (!s->st || !s->st->time_base.num || s->statistics.received < 16)
+        return max_delay;
+    delay = av_rescale(RTP_PLAYOUT_JITTER_FACTOR * (s->statistics.jitter >> 4),
+                       (int64_t)s->st->time_base.num * AV_TIME_BASE,
+                       s->st->time_base.den);
+    return FFMIN(FFMAX(delay, RTP_MIN_PLAYOUT_DELAY), max_delay);
 }
 
 static int rtp_parse_queued_packet(RTPDemuxContext *s, AVPacket *pkt)
 {
-    int rv;
-    RTPPacket *next;
+    int rv, missed;
+    RTPPacket *packet = first_queued_packet(s);
 
-    if (s->queue_len <= 0)
+    if (!packet)
         return -1;
 
-    if (!has_next_packet(s))
+    missed = (uint16_t)(packet->seq - s->seq - 1);
+    if (missed) {
         av_log(s->st ? s->st->codec : NULL, AV_LOG_WARNING,
-               "RTP: missed %d packets\n", s->queue->seq - s->seq - 1);
+               "RTP: missed %d packets\n", missed);
+        s->packets_lost += missed;
+    }
 
     /* Parse the first packet in the queue, and dequeue it */
-    rv = rtp_parse_packet_internal(s, pkt, s->queue->buf, s->queue->len);
-    next = s->queue->next;
-    av_free(s->queue->buf);
-    av_free(s->queue);
-    s->queue = next;
-    s->queue_len--;
+    rv = rtp_parse_packet_internal(s, pkt, packet->buf, packet->len);
+    packet->len = 0;
+    if (packet != &s->overflow && --s->queue_len > 0) {
+        /* All queued packets lie within queue_mask + 1 sequence numbers
+         * after the one just returned, so this finds the next one. */
+        do {
+            s->queue_head++;
+        } while (!s->queue[s->queue_head & s->queue_mask].len);
+    }
     return rv;
 }
 
@@ -757,6 +812,7 @@ static int rtp_parse_one_packet(RTPDemuxContext *s, AVPacket *pkt,
     uint8_t* buf = bufptr ? *bufptr : NULL;
     int ret, flags = 0;
     uint32_t timestamp;
+    int64_t recvtime;
     int rv= 0;
 
     if (!buf) {
@@ -799,7 +855,13 @@ static int rtp_parse_one_packet(RTPDemuxContext *s, AVPacket *pkt,
         return rtcp_parse_packet(s, buf, len);
     }
 
-    if ((s->seq == 0 && !s->queue) || s->queue_size <= 1) {
+    recvtime = av_gettime();
+    if (s->st && s->st->time_base.num)
+        rtcp_update_jitter(&s->statistics, AV_RB32(buf + 4),
+                           av_rescale(recvtime, s->st->time_base.den,
+                                      (int64_t)s->st->time_base.num * AV_TIME_BASE));
+
+    if ((s->seq == 0 && !s->queue_len) || s->queue_size <= 1) {
         /* First packet, or no reordering */
         return rtp_parse_packet_internal(s, pkt, buf, len);
     } else {
@@ -809,15 +871,32 @@ static int rtp_parse_one_packet(RTPDemuxContext *s, AVPacket *pkt,
             /* Packet older than the previously emitted one, drop */
             av_log(s->st ? s->st->codec : NULL, AV_LOG_WARNING,
                    "RTP: dropping old packet received too late\n");
+            s->packets_late++;
             return -1;
         } else if (diff <= 1) {
             /* Correct packet */
+            if (s->queue_len)
+                s->packets_reordered++;
             rv = rtp_parse_packet_internal(s, pkt, buf, len);
             return rv;
+        } else if (diff > s->queue_mask + 1) {
+            /* Too far ahead to be reordered with what is queued; the gap
+             * is loss. Return it after everything queued before it. */
+            if (!s->queue_len) {
+                s->packets_lost += diff - 1;
+                return rtp_parse_packet_internal(s, pkt, buf, len);
+            }
+            if (s->overflow.len) {
+                av_log(s->st ? s->st->codec : NULL, AV_LOG_WARNING,
+                       "RTP: dropping packet, reordering queue not drained\n");
+                return -1;
+            }
+            if (store_packet(&s->overflow, buf, len, recvtime) < 0)
+                return AVERROR(ENOMEM);
+            return rtp_parse_queued_packet(s, pkt);
         } else {
             /* Still missing some packet, enqueue this one. */
-            enqueue_packet(s, buf, len);
-            *bufptr = NULL;
+            enqueue_packet(s, buf, len, recvtime);
             /* Return the first enqueued packet if the queue is full,
              * even if we're missing something */
             if (s->queue_len >= s->queue_size)
@@ -848,7 +927,17 @@ int rtp_parse_packet(RTPDemuxContext *s, AVPacket *pkt,
 
 void rtp_parse_close(RTPDemuxContext *s)
 {
-    ff_rtp_reset_packet_queue(s);
+    int i;
+
+    if (s->queue) {
+        av_log(s->st ? s->st->codec : NULL, AV_LOG_VERBOSE,
+               "RTP: %d packets lost, %d reordered, %d dropped late\n",
+               s->packets_lost, s->packets_reordered, s->packets_late);
+        for (i = 0; i <= s->queue_mask; i++)
+            av_free(s->queue[i].buf);
+        av_free(s->queue);
+    }
+    av_free(s->overflow.buf);
     if (!strcmp(ff_rtp_enc_name(s->payload_type), "MP2T")) {
         ff_mpegts_parse_close(s->ts);
     }
@@ -35,6 +35,11 @@ typedef struct RTPDynamicProtocolHandler_s RTPDynamicProtocolHandler;
 
 #define RTP_REORDER_QUEUE_DEFAULT_SIZE 10
 
+/** The playout delay is this many times the estimated interarrival jitter */
+#define RTP_PLAYOUT_JITTER_FACTOR 4
+/** Lower bound of the adaptive playout delay, in microseconds */
+#define RTP_MIN_PLAYOUT_DELAY 10000
+
 #define RTP_NOTS_VALUE ((uint32_t)-1)
 
 typedef struct RTPDemuxContext RTPDemuxContext;
@@ -45,6 +50,14 @@ int rtp_parse_packet(RTPDemuxContext *s, AVPacket *pkt,
                      uint8_t **buf, int len);
 void rtp_parse_close(RTPDemuxContext *s);
 int64_t ff_rtp_queued_packet_time(RTPDemuxContext *s);
+
+/**
+ * Return how long packets may wait in the reordering queue before being
+ * returned in spite of missing predecessors, in microseconds. The delay
+ * follows the measured interarrival jitter of the stream and is capped
+ * at max_delay.
+ */
+int64_t ff_rtp_playout_delay(RTPDemuxContext *s, int64_t max_delay);
 void ff_rtp_reset_packet_queue(RTPDemuxContext *s);
 int rtp_get_local_rtp_port(URLContext *h);
 int rtp_get_local_rtcp_port(URLContext *h);
@@ -133,12 +146,17 @@ struct RTPDynamicProtocolHandler_s {
     struct RTPDynamicProtocolHandler_s *next;
 };
 
+/**
+ * A slot of the reordering queue. Slots are indexed by sequence number
+ * and keep their buffer across uses, so that queueing a packet normally
+ * does not allocate.
+ */
 typedef struct RTPPacket {
     uint16_t seq;
     uint8_t *buf;
-    int len;
+    int len;                ///< length of the queued packet, 0 if the slot is free
+    unsigned int buf_size;  ///< allocated size of buf
     int64_t recvtime;
-    struct RTPPacket *next;
 } RTPPacket;
 
 // moved out of rtp.c, because the h264 decoder needs to know about this structure..
@@ -164,9 +182,19 @@ struct RTPDemuxContext {
 
     /** Fields for packet reordering @{ */
     int prev_ret;     ///< The return value of the actual parsing of the previous packet
-    RTPPacket* queue; ///< A sorted queue of buffered packets not yet returned
+    RTPPacket* queue; ///< Ring of queue_mask + 1 packet slots, indexed by sequence number
+    int queue_mask;   ///< The number of slots in queue minus one
     int queue_len;    ///< The number of packets in queue
     int queue_size;   ///< The size of queue, or 0 if reordering is disabled
+    uint16_t queue_head;  ///< Sequence number of the oldest queued packet
+    uint16_t queue_tail;  ///< Sequence number of the newest queued packet
+    RTPPacket overflow;   ///< Packet too far ahead to fit in queue, returned once queue is drained
+    /*@}*/
+
+    /** Reception counters @{ */
+    int packets_lost;      ///< Sequence numbers skipped when returning queued packets
+    int packets_reordered; ///< Packets received after a packet with a higher sequence number
+    int packets_late;      ///< Packets dropped because they arrived after their successor was returned
     /*@}*/
 
     /* rtcp sender statistics receive */
@@ -20,9 +20,11 @@
  */
 
 #include "avformat.h"
+#include "avio_internal.h"
 #include "mpegts.h"
 #include "internal.h"
 #include "libavutil/random_seed.h"
+#include "libavcodec/bytestream.h"
 
 #include "rtpenc.h"
 
@@ -100,6 +102,7 @@ static int rtp_write_header(AVFormatContext *s1)
         return AVERROR(ENOMEM);
     }
     s->max_payload_size = max_packet_size - 12;
+    s->sg_url = ffio_geturlcontext(s1->pb);
 
     s->max_frames_per_packet = 0;
     if (s1->max_delay) {
@@ -208,6 +211,71 @@ static void rtcp_send_sr(AVFormatContext *s1, int64_t ntp_time)
     avio_flush(s1->pb);
 }
 
+/* send the packets batched for the current frame */
+static void rtp_flush_packets(AVFormatContext *s1)
+{
+    RTPMuxContext *s = s1->priv_data;
+    int i;
+
+    if (!s->sg_nb_pkts)
+        return;
+    for (i = 0; i < s->sg_nb_pkts; i++)
+        s->sg_pkts[i].hdr = s->sg_hdrs + i * RTP_SG_HDR_SIZE;
+    if (ffurl_write_packets(s->sg_url, s->sg_pkts, s->sg_nb_pkts) < 0)
+        av_log(s1, AV_LOG_ERROR, "Failed to send %d RTP packets\n", s->sg_nb_pkts);
+    s->sg_nb_pkts = 0;
+}
+
+void ff_rtp_send_data_sg(AVFormatContext *s1, const uint8_t *phdr, int phdr_len,
+                         const uint8_t *buf1, int len, int m)
+{
+    RTPMuxContext *s = s1->priv_data;
+    uint8_t hdr[RTP_SG_HDR_SIZE], *p;
+
+    av_dlog(s1, "rtp_send_data_sg size=%d+%d\n", phdr_len, len);
+
+    if (s->sg_url && s->sg_nb_pkts == s->sg_max_pkts) {
+        int max_pkts = FFMAX(2 * s->sg_max_pkts, 16);
+        URLPacket *pkts = av_realloc(s->sg_pkts, max_pkts * sizeof(*pkts));
+        uint8_t *hdrs;
+        if (pkts)
+            s->sg_pkts = pkts;
+        hdrs = pkts ? av_realloc(s->sg_hdrs, max_pkts * RTP_SG_HDR_SIZE) : NULL;
+        if (hdrs) {
+            s->sg_hdrs     = hdrs;
+            s->sg_max_pkts = max_pkts;
+        } else {
+            /* out of memory, send the frame packet by packet from now on */
+            rtp_flush_packets(s1);
+            s->sg_url = NULL;
+        }
+    }
+    p = s->sg_url ? s->sg_hdrs + s->sg_nb_pkts * RTP_SG_HDR_SIZE : hdr;
+
+    /* build the RTP header */
+    bytestream_put_byte(&p, RTP_VERSION << 6);
+    bytestream_put_byte(&p, (s->payload_type & 0x7f) | ((m & 0x01) << 7));
+    bytestream_put_be16(&p, s->seq);
+    bytestream_put_be32(&p, s->timestamp);
+    bytestream_put_be32(&p, s->ssrc);
+    bytestream_put_buffer(&p, phdr, phdr_len);
+
+    if (s->sg_url) {
+        URLPacket *pkt = &s->sg_pkts[s->sg_nb_pkts++];
+        pkt->hdr_size = 12 + phdr_len;
+        pkt->data     = buf1;
+        pkt->size     = len;
+    } else {
+        avio_write(s1->pb, hdr, 12 + phdr_len);
+        avio_write(s1->pb, buf1, len);
+        avio_flush(s1->pb);
+    }
+
+    s->seq++;
+    s->octet_count += phdr_len + len;
+    s->packet_count++;
+}
+
 /* send an rtp packet. sequence number is incremented, but the caller
    must update the timestamp itself */
 void ff_rtp_send_data(AVFormatContext *s1, const uint8_t *buf1, int len, int m)
@@ -216,6 +284,9 @@ void ff_rtp_send_data(AVFormatContext *s1, const uint8_t *buf1, int len, int m)
 
     av_dlog(s1, "rtp_send_data size=%d\n", len);
 
+    /* buf1 may be reused by the caller, so it cannot be batched */
+    rtp_flush_packets(s1);
+
     /* build the RTP header */
     avio_w8(s1->pb, (RTP_VERSION << 6));
     avio_w8(s1->pb, (s->payload_type & 0x7f) | ((m & 0x01) << 7));
@@ -431,6 +502,7 @@ static int rtp_write_packet(AVFormatContext *s1, AVPacket *pkt)
         rtp_send_raw(s1, pkt->data, size);
         break;
     }
+    rtp_flush_packets(s1);
     return 0;
 }
 
@@ -439,6 +511,8 @@ static int rtp_write_trailer(AVFormatContext *s1)
     RTPMuxContext *s = s1->priv_data;
 
     av_freep(&s->buf);
+    av_freep(&s->sg_pkts);
+    av_freep(&s->sg_hdrs);
 
     return 0;
 }
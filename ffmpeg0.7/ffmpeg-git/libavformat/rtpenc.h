@@ -23,6 +23,10 @@
 
 #include "avformat.h"
 #include "rtp.h"
+#include "url.h"
+
+/** room for the RTP header and a payload header in batched packets */
+#define RTP_SG_HDR_SIZE 32
 
 struct RTPMuxContext {
     AVFormatContext *ic;
@@ -56,12 +60,31 @@ struct RTPMuxContext {
      * (1, 2 or 4)
      */
     int nal_length_size;
+
+    /**
+     * Packets of the current frame, with headers stored in sg_hdrs and
+     * payloads pointing into the frame, sent together at the end of it.
+     * Only used if the output is a packetized URLContext.
+     */
+    URLContext *sg_url;
+    URLPacket *sg_pkts;
+    uint8_t *sg_hdrs;
+    int sg_nb_pkts, sg_max_pkts;
 };
 
 typedef struct RTPMuxContext RTPMuxContext;
 
 void ff_rtp_send_data(AVFormatContext *s1, const uint8_t *buf1, int len, int m);
 
+/**
+ * Send an RTP packet made of a payload header and a part of the frame,
+ * like ff_rtp_send_data(). The payload is not copied when the output
+ * supports it, and has to stay valid until the end of the frame.
+ * phdr_len must not exceed RTP_SG_HDR_SIZE - 12.
+ */
+void ff_rtp_send_data_sg(AVFormatContext *s1, const uint8_t *phdr, int phdr_len,
+                         const uint8_t *buf1, int len, int m);
+
 void ff_rtp_send_h264(AVFormatContext *s1, const uint8_t *buf1, int size);
 void ff_rtp_send_h263(AVFormatContext *s1, const uint8_t *buf1, int size);
 void ff_rtp_send_aac(AVFormatContext *s1, const uint8_t *buff, int size);
@@ -311,6 +311,14 @@ static int rtp_write(URLContext *h, const uint8_t *buf, int size)
     return ret;
 }
 
+/* only used for RTP packets, RTCP packets are sent one by one */
+static int rtp_write_packets(URLContext *h, const URLPacket *pkts, int nb_pkts)
+{
+    RTPContext *s = h->priv_data;
+    int ret = ffurl_write_packets(s->rtp_hd, pkts, nb_pkts);
+    return ret < 0 ? ret : nb_pkts;
+}
+
 static int rtp_close(URLContext *h)
 {
     RTPContext *s = h->priv_data;
@@ -363,4 +371,5 @@ URLProtocol ff_rtp_protocol = {
     .url_write           = rtp_write,
     .url_close           = rtp_close,
     .url_get_file_handle = rtp_get_file_handle,
+    .url_write_packets   = rtp_write_packets,
 };
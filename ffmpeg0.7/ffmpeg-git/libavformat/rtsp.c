@@ -1590,6 +1590,8 @@ static int udp_read_packet(AVFormatContext *s, RTSPStream **prtsp_st,
         }
         //n = poll(p, max_p, POLL_TIMEOUT_MS);
         n = poll(p, max_p, 0);
+        if (n == 0 && s->flags & AVFMT_FLAG_NONBLOCK)
+            return AVERROR(EAGAIN);
         if (n > 0) {
             int j = 1 - (tcp_fd == -1);
             timeout_cnt = 0;
@@ -1625,6 +1627,46 @@ static int udp_read_packet(AVFormatContext *s, RTSPStream **prtsp_st,
     }
 }
 
+int ff_rtsp_get_file_handles(AVFormatContext *s, int *fds, int max_fds)
+{
+    RTSPState *rt = s->priv_data;
+    int i, n = 0;
+
+    if (rt->rtsp_hd && n < max_fds)
+        fds[n++] = ffurl_get_file_handle(rt->rtsp_hd);
+    for (i = 0; i < rt->nb_rtsp_streams; i++) {
+        RTSPStream *rtsp_st = rt->rtsp_streams[i];
+        if (rtsp_st->rtp_handle && n + 2 <= max_fds) {
+            fds[n++] = ffurl_get_file_handle(rtsp_st->rtp_handle);
+            fds[n++] = rtp_get_rtcp_file_handle(rtsp_st->rtp_handle);
+        }
+    }
+    return n;
+}
+
+int64_t ff_rtsp_get_wakeup_time(AVFormatContext *s)
+{
+    RTSPState *rt = s->priv_data;
+    return rt->wakeup_time;
+}
+
+#if CONFIG_RTSP_DEMUXER
+/**
+ * Check whether a non-blocking read of the interleaved TCP stream would
+ * block. Data buffered by the HTTP tunnel cannot be seen by poll, so the
+ * tunnel is always read.
+ */
+static int tcp_would_block(RTSPState *rt)
+{
+    struct pollfd p = { 0, POLLIN, 0 };
+
+    if (rt->control_transport == RTSP_MODE_TUNNEL)
+        return 0;
+    p.fd = ffurl_get_file_handle(rt->rtsp_hd);
+    return poll(&p, 1, 0) == 0;
+}
+#endif
+
 int ff_rtsp_fetch_packet(AVFormatContext *s, AVPacket *pkt)
 {
     RTSPState *rt = s->priv_data;
@@ -1632,6 +1674,7 @@ int ff_rtsp_fetch_packet(AVFormatContext *s, AVPacket *pkt)
     RTSPStream *rtsp_st, *first_queue_st = NULL;
     int64_t wait_end = 0;
 
+    rt->wakeup_time = 0;
     if (rt->nb_byes == rt->nb_rtsp_streams)
         return AVERROR_EOF;
 
@@ -1652,21 +1695,22 @@ int ff_rtsp_fetch_packet(AVFormatContext *s, AVPacket *pkt)
 
     if (rt->transport == RTSP_TRANSPORT_RTP) {
         int i;
-        int64_t first_queue_time = 0;
         for (i = 0; i < rt->nb_rtsp_streams; i++) {
             RTPDemuxContext *rtpctx = rt->rtsp_streams[i]->transport_priv;
             int64_t queue_time;
             if (!rtpctx)
                 continue;
             queue_time = ff_rtp_queued_packet_time(rtpctx);
-            if (queue_time && (queue_time - first_queue_time < 0 ||
-                               !first_queue_time)) {
-                first_queue_time = queue_time;
-                first_queue_st   = rt->rtsp_streams[i];
+            if (!queue_time)
+                continue;
+            /* each stream waits for missing packets as long as its own
+             * jitter requires */
+            queue_time += ff_rtp_playout_delay(rtpctx, s->max_delay);
+            if (queue_time - wait_end < 0 || !wait_end) {
+                wait_end       = queue_time;
+                first_queue_st = rt->rtsp_streams[i];
             }
         }
-        if (first_queue_time)
-            wait_end = first_queue_time + s->max_delay;
     }
 
     /* read next RTP packet */
@@ -1681,6 +1725,10 @@ int ff_rtsp_fetch_packet(AVFormatContext *s, AVPacket *pkt)
     default:
 #if CONFIG_RTSP_DEMUXER
     case RTSP_LOWER_TRANSPORT_TCP:
+        if (s->flags & AVFMT_FLAG_NONBLOCK && tcp_would_block(rt)) {
+            len = AVERROR(EAGAIN);
+            break;
+        }
         len = ff_rtsp_tcp_read_packet(s, &rtsp_st, rt->recvbuf, RECVBUF_SIZE);
         break;
 #endif
@@ -1693,6 +1741,12 @@ int ff_rtsp_fetch_packet(AVFormatContext *s, AVPacket *pkt)
     }
     if (len == AVERROR(EAGAIN) && first_queue_st &&
         rt->transport == RTSP_TRANSPORT_RTP) {
+        /* without blocking, keep waiting for the missing packets until
+         * the playout delay has elapsed */
+        if (s->flags & AVFMT_FLAG_NONBLOCK && av_gettime() - wait_end < 0) {
+            rt->wakeup_time = wait_end;
+            return len;
+        }
         rtsp_st = first_queue_st;
         ret = rtp_parse_packet(rtsp_st->transport_priv, pkt, NULL, 0);
         goto end;
@@ -331,6 +331,13 @@ typedef struct RTSPState {
      * Polling array for udp
      */
     struct pollfd *p;
+
+    /**
+     * In non-blocking mode, the time at which a packet held in an RTP
+     * reordering queue has to be returned even if the missing packets
+     * before it have not arrived, or 0.
+     */
+    int64_t wakeup_time;
 } RTSPState;
 
 /**
@@ -504,6 +511,20 @@ int ff_rtsp_tcp_read_packet(AVFormatContext *s, RTSPStream **prtsp_st,
  */
 int ff_rtsp_fetch_packet(AVFormatContext *s, AVPacket *pkt);
 
+/**
+ * Get the sockets that packets of the RTSPStreams arrive on, and the
+ * RTSP control connection if any.
+ *
+ * @return number of handles stored in fds
+ */
+int ff_rtsp_get_file_handles(AVFormatContext *s, int *fds, int max_fds);
+
+/**
+ * Get the time at which ff_rtsp_fetch_packet() in non-blocking mode will
+ * return a queued packet without further input, or 0.
+ */
+int64_t ff_rtsp_get_wakeup_time(AVFormatContext *s);
+
 /**
  * Do the SETUP requests for each stream for the chosen
  * lower transport mode.
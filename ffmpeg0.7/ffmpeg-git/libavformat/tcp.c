@@ -28,6 +28,9 @@
 #if HAVE_POLL_H
 #include <poll.h>
 #endif
+#if !HAVE_WINSOCK2_H
+#include <netinet/tcp.h>
+#endif
 #if HAVE_TERMIOS_H
 #include <sys/time.h>
 #endif
@@ -36,12 +39,64 @@ typedef struct TCPContext {
     int fd;
 } TCPContext;
 
+/* socket options given in the URL, -1 if unset */
+typedef struct TCPOptions {
+    int send_buffer_size;
+    int recv_buffer_size;
+    int nodelay;
+    int cork;
+} TCPOptions;
+
+static void parse_options(TCPOptions *o, const char *p)
+{
+    char buf[256];
+
+    o->send_buffer_size = o->recv_buffer_size = o->nodelay = o->cork = -1;
+    if (!p)
+        return;
+    if (av_find_info_tag(buf, sizeof(buf), "send_buffer_size", p))
+        o->send_buffer_size = strtol(buf, NULL, 10);
+    if (av_find_info_tag(buf, sizeof(buf), "recv_buffer_size", p))
+        o->recv_buffer_size = strtol(buf, NULL, 10);
+    if (av_find_info_tag(buf, sizeof(buf), "tcp_nodelay", p))
+        o->nodelay = strtol(buf, NULL, 10);
+    if (av_find_info_tag(buf, sizeof(buf), "tcp_cork", p))
+        o->cork = strtol(buf, NULL, 10);
+}
+
+/* buffer sizes have to be set before connecting for the TCP window
+ * scale to take them into account */
+static void set_options(int fd, const TCPOptions *o)
+{
+    if (o->send_buffer_size > 0 &&
+        setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &o->send_buffer_size,
+                   sizeof(o->send_buffer_size)) < 0)
+        av_log(NULL, AV_LOG_WARNING, "setsockopt(SO_SNDBUF) failed\n");
+    if (o->recv_buffer_size > 0 &&
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &o->recv_buffer_size,
+                   sizeof(o->recv_buffer_size)) < 0)
+        av_log(NULL, AV_LOG_WARNING, "setsockopt(SO_RCVBUF) failed\n");
+    if (o->nodelay >= 0 &&
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &o->nodelay,
+                   sizeof(o->nodelay)) < 0)
+        av_log(NULL, AV_LOG_WARNING, "setsockopt(TCP_NODELAY) failed\n");
+    if (o->cork >= 0) {
+#ifdef TCP_CORK
+        if (setsockopt(fd, IPPROTO_TCP, TCP_CORK, &o->cork, sizeof(o->cork)) < 0)
+            av_log(NULL, AV_LOG_WARNING, "setsockopt(TCP_CORK) failed\n");
+#else
+        av_log(NULL, AV_LOG_WARNING, "TCP_CORK is not supported\n");
+#endif
+    }
+}
+
 /* return non zero if error */
 static int tcp_open(URLContext *h, const char *uri, int flags)
 {
     struct addrinfo hints, *ai, *cur_ai;
     int port, fd = -1;
     TCPContext *s = NULL;
+    TCPOptions opts;
     int listen_socket = 0;
     const char *p;
     char buf[256];
@@ -60,6 +115,7 @@ static int tcp_open(URLContext *h, const char *uri, int flags)
         if (av_find_info_tag(buf, sizeof(buf), "listen", p))
             listen_socket = 1;
     }
+    parse_options(&opts, p);
     memset(&hints, 0, sizeof(hints));
     hints.ai_family = AF_UNSPEC;
     hints.ai_socktype = SOCK_STREAM;
@@ -78,6 +134,7 @@ static int tcp_open(URLContext *h, const char *uri, int flags)
     fd = socket(cur_ai->ai_family, cur_ai->ai_socktype, cur_ai->ai_protocol);
     if (fd < 0)
         goto fail;
+    set_options(fd, &opts);
 
     if (listen_socket) {
         int fd1;
@@ -86,6 +143,8 @@ static int tcp_open(URLContext *h, const char *uri, int flags)
         fd1 = accept(fd, NULL, NULL);
         closesocket(fd);
         fd = fd1;
+        if (fd >= 0)
+            set_options(fd, &opts);
     } else {
  redo:
         ret = connect(fd, cur_ai->ai_addr, cur_ai->ai_addrlen);
@@ -161,16 +220,22 @@ static int tcp_open(URLContext *h, const char *uri, int flags)
     return ret;
 }
 
+/* The socket is non-blocking, so data is read or written right away when
+ * possible, and the socket is only polled when it would block. */
 static int tcp_read(URLContext *h, uint8_t *buf, int size)
 {
     TCPContext *s = h->priv_data;
     int ret;
 
-    if (!(h->flags & AVIO_FLAG_NONBLOCK)) {
-        ret = ff_network_wait_fd(s->fd, 0);
-        if (ret < 0)
-            return ret;
-    }
+    ret = recv(s->fd, buf, size, 0);
+    if (ret >= 0)
+        return ret;
+    ret = ff_neterrno();
+    if (ret != AVERROR(EAGAIN) || h->flags & AVIO_FLAG_NONBLOCK)
+        return ret;
+    ret = ff_network_wait_fd(s->fd, 0);
+    if (ret < 0)
+        return ret;
     ret = recv(s->fd, buf, size, 0);
     return ret < 0 ? ff_neterrno() : ret;
 }
@@ -180,11 +245,15 @@ static int tcp_write(URLContext *h, const uint8_t *buf, int size)
     TCPContext *s = h->priv_data;
     int ret;
 
-    if (!(h->flags & AVIO_FLAG_NONBLOCK)) {
-        ret = ff_network_wait_fd(s->fd, 1);
-        if (ret < 0)
-            return ret;
-    }
+    ret = send(s->fd, buf, size, 0);
+    if (ret >= 0)
+        return ret;
+    ret = ff_neterrno();
+    if (ret != AVERROR(EAGAIN) || h->flags & AVIO_FLAG_NONBLOCK)
+        return ret;
+    ret = ff_network_wait_fd(s->fd, 1);
+    if (ret < 0)
+        return ret;
     ret = send(s->fd, buf, size, 0);
     return ret < 0 ? ff_neterrno() : ret;
 }
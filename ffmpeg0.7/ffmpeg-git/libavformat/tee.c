@@ -0,0 +1,558 @@
+/*
+ * Tee pseudo-muxer
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Tee pseudo-muxer, writing the same streams to several outputs.
+ *
+ * The filename is a list of outputs separated by '|'. Each output may be
+ * prefixed with options in brackets, e.g.
+ * "[f=mpegts]udp://10.0.0.1:1234|[f=flv]rtmp://host/app/live|rec.mkv".
+ * The "f" option selects the muxer, any other option is set on the private
+ * context of that muxer.
+ *
+ * Every output is muxed and written by its own thread from a bounded
+ * queue. An output that falls behind does not block the caller: once its
+ * queue is full it drops packets until the next video keyframe, so that
+ * it resumes with a decodable picture, and logs the gap. An output that
+ * fails is closed without affecting the others. The packet data is copied
+ * once and shared by all queues.
+ */
+
+#include "libavutil/avstring.h"
+#include "libavutil/opt.h"
+#include "avformat.h"
+#include "internal.h"
+#if HAVE_PTHREADS
+#include <pthread.h>
+#endif
+
+#define MAX_SLAVES 16
+
+typedef struct TeeBuffer {
+    uint8_t *data;
+    int refs;
+} TeeBuffer;
+
+typedef struct TeePacket {
+    AVPacket pkt;
+    TeeBuffer *buf;
+    struct TeePacket *next;
+} TeePacket;
+
+typedef struct TeeSlave {
+    AVFormatContext *avf;
+    TeePacket *queue, *queue_end;
+    int nb_queued;
+    int nb_dropped;
+    int has_video;      ///< resynchronize on video keyframes after drops
+    int dropping;       ///< dropping packets until the next keyframe
+    int64_t gap_start;  ///< time of the first dropped packet, in AV_TIME_BASE
+    int eof;
+    int error;          ///< protected by lock, written by the output thread
+#if HAVE_PTHREADS
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int thread_started;
+#endif
+} TeeSlave;
+
+typedef struct TeeContext {
+    const AVClass *class;
+    TeeSlave slaves[MAX_SLAVES];
+    int nb_slaves;
+    int queue_size;
+#if HAVE_PTHREADS
+    pthread_mutex_t buf_lock;   /* protects the reference counts of TeeBuffer */
+#endif
+} TeeContext;
+
+static const AVOption options[] = {
+    { "tee_queue_size", "maximum number of packets queued for each output",
+      offsetof(TeeContext, queue_size), FF_OPT_TYPE_INT, 256, 1, 65536,
+      AV_OPT_FLAG_ENCODING_PARAM },
+    { NULL },
+};
+
+static const AVClass tee_muxer_class = {
+    "tee muxer",
+    av_default_item_name,
+    options,
+    LIBAVUTIL_VERSION_INT,
+};
+
+static void release_buffer(TeeContext *tee, TeeBuffer *buf)
+{
+    int refs;
+
+#if HAVE_PTHREADS
+    pthread_mutex_lock(&tee->buf_lock);
+#endif
+    refs = --buf->refs;
+#if HAVE_PTHREADS
+    pthread_mutex_unlock(&tee->buf_lock);
+#endif
+    if (!refs) {
+        av_free(buf->data);
+        av_free(buf);
+    }
+}
+
+/**
+ * Write one packet to an output unless the output has already failed.
+ * @param error current error state of the output
+ * @return the new error state of the output
+ */
+static int write_slave_packet(TeeContext *tee, TeeSlave *slave, TeePacket *tp,
+                              int error)
+{
+    if (!error) {
+        int ret = av_write_frame(slave->avf, &tp->pkt);
+        if (ret < 0) {
+            av_log(slave->avf, AV_LOG_ERROR,
+                   "Error writing to %s, closing this output\n",
+                   slave->avf->filename);
+            error = ret;
+        }
+    }
+    release_buffer(tee, tp->buf);
+    av_free(tp);
+    return error;
+}
+
+#if HAVE_PTHREADS
+typedef struct SlaveThreadArg {
+    TeeContext *tee;
+    TeeSlave *slave;
+} SlaveThreadArg;
+
+static void *slave_thread(void *opaque)
+{
+    TeeContext *tee  = ((SlaveThreadArg *)opaque)->tee;
+    TeeSlave *slave  = ((SlaveThreadArg *)opaque)->slave;
+
+    av_free(opaque);
+    pthread_mutex_lock(&slave->lock);
+    for (;;) {
+        TeePacket *tp;
+        int error;
+
+        while (!slave->queue && !slave->eof)
+            pthread_cond_wait(&slave->cond, &slave->lock);
+        if (!slave->queue)
+            break;
+        tp = slave->queue;
+        slave->queue = tp->next;
+        if (!slave->queue)
+            slave->queue_end = NULL;
+        slave->nb_queued--;
+        error = slave->error;
+        pthread_mutex_unlock(&slave->lock);
+
+        error = write_slave_packet(tee, slave, tp, error);
+
+        pthread_mutex_lock(&slave->lock);
+        slave->error = error;
+    }
+    pthread_mutex_unlock(&slave->lock);
+    return NULL;
+}
+#endif
+
+/**
+ * Parse one output specification, "[key=val:key=val]url", into the muxer
+ * name and the url; the remaining options are set on the muxer context.
+ */
+static int open_slave(AVFormatContext *avf, TeeSlave *slave, char *spec)
+{
+    AVFormatContext *avf2;
+    AVFormatParameters ap = { { 0 } };
+    AVOutputFormat *fmt;
+    char *opts = NULL, *url = spec, *format = NULL;
+    char *p, *next;
+    int i, ret;
+
+    if (*spec == '[') {
+        opts = spec + 1;
+        url  = strchr(opts, ']');
+        if (!url) {
+            av_log(avf, AV_LOG_ERROR, "Missing ']' in output '%s'\n", spec);
+            return AVERROR(EINVAL);
+        }
+        *url++ = 0;
+        for (p = opts; p && *p; p = next) {
+            if ((next = strchr(p, ':')))
+                *next++ = 0;
+            if (!strncmp(p, "f=", 2))
+                format = p + 2;
+        }
+    }
+
+    fmt = av_guess_format(format, url, NULL);
+    if (!fmt) {
+        av_log(avf, AV_LOG_ERROR, "Unable to find a muxer for output '%s'\n", url);
+        return AVERROR(EINVAL);
+    }
+    if (fmt == avf->oformat) {
+        av_log(avf, AV_LOG_ERROR, "Nested tee outputs are not supported\n");
+        return AVERROR(EINVAL);
+    }
+
+    avf2 = avformat_alloc_context();
+    if (!avf2)
+        return AVERROR(ENOMEM);
+    slave->avf = avf2;
+    avf2->oformat = fmt;
+    av_strlcpy(avf2->filename, url, sizeof(avf2->filename));
+    avf2->flags = avf->flags;
+    av_metadata_copy(&avf2->metadata, avf->metadata, 0);
+
+    for (i = 0; i < avf->nb_streams; i++) {
+        AVStream *st = avf->streams[i], *st2;
+
+        st2 = av_new_stream(avf2, st->id);
+        if (!st2)
+            return AVERROR(ENOMEM);
+        if ((ret = avcodec_copy_context(st2->codec, st->codec)) < 0)
+            return ret;
+        /* let the muxer pick its own tag for the codec */
+        st2->codec->codec_tag = 0;
+        st2->sample_aspect_ratio = st->sample_aspect_ratio;
+        st2->r_frame_rate        = st->r_frame_rate;
+        st2->avg_frame_rate      = st->avg_frame_rate;
+        st2->time_base           = st->time_base;
+        st2->disposition         = st->disposition;
+        av_metadata_copy(&st2->metadata, st->metadata, 0);
+        if (st->codec->codec_type == AVMEDIA_TYPE_VIDEO)
+            slave->has_video = 1;
+    }
+
+    if ((ret = av_set_parameters(avf2, &ap)) < 0)
+        return ret;
+    for (p = opts; p && p < url - 1; p += strlen(p) + 1) {
+        char *val = strchr(p, '=');
+        if (!val || !strncmp(p, "f=", 2))
+            continue;
+        *val++ = 0;
+        if (!avf2->priv_data || !fmt->priv_class ||
+            av_set_string3(avf2->priv_data, p, val, 1, NULL) < 0)
+            av_log(avf, AV_LOG_WARNING, "Option '%s' not supported by %s muxer\n",
+                   p, fmt->name);
+    }
+
+    if (!(fmt->flags & AVFMT_NOFILE)) {
+        if ((ret = avio_open(&avf2->pb, url, AVIO_WRONLY)) < 0) {
+            av_log(avf, AV_LOG_ERROR, "Unable to open output '%s'\n", url);
+            return ret;
+        }
+    }
+    if ((ret = av_write_header(avf2)) < 0) {
+        av_log(avf, AV_LOG_ERROR, "Unable to write the header of '%s'\n", url);
+        return ret;
+    }
+    return 0;
+}
+
+/**
+ * Wait until the thread of the output has written everything queued.
+ */
+static void stop_slave_thread(TeeSlave *slave)
+{
+#if HAVE_PTHREADS
+    if (!slave->thread_started)
+        return;
+    pthread_mutex_lock(&slave->lock);
+    slave->eof = 1;
+    pthread_cond_signal(&slave->cond);
+    pthread_mutex_unlock(&slave->lock);
+    pthread_join(slave->thread, NULL);
+    pthread_mutex_destroy(&slave->lock);
+    pthread_cond_destroy(&slave->cond);
+    slave->thread_started = 0;
+#endif
+}
+
+static void close_slave(TeeSlave *slave)
+{
+    AVFormatContext *avf2 = slave->avf;
+
+    if (!avf2)
+        return;
+    if (avf2->pb && !(avf2->oformat->flags & AVFMT_NOFILE))
+        avio_close(avf2->pb);
+    avformat_free_context(avf2);
+    slave->avf = NULL;
+}
+
+static void close_slaves(TeeContext *tee)
+{
+    int i;
+
+    for (i = 0; i < tee->nb_slaves; i++) {
+        stop_slave_thread(&tee->slaves[i]);
+        close_slave(&tee->slaves[i]);
+    }
+#if HAVE_PTHREADS
+    pthread_mutex_destroy(&tee->buf_lock);
+#endif
+    tee->nb_slaves = 0;
+}
+
+static int tee_write_header(AVFormatContext *avf)
+{
+    TeeContext *tee = avf->priv_data;
+    char *specs, *spec, *next;
+    int ret = 0;
+
+    if (!tee->queue_size)
+        tee->queue_size = 256;
+    specs = av_strdup(avf->filename);
+    if (!specs)
+        return AVERROR(ENOMEM);
+#if HAVE_PTHREADS
+    pthread_mutex_init(&tee->buf_lock, NULL);
+#endif
+
+    for (spec = specs; spec && *spec; spec = next) {
+        TeeSlave *slave;
+
+        if ((next = strchr(spec, '|')))
+            *next++ = 0;
+        if (tee->nb_slaves == MAX_SLAVES) {
+            av_log(avf, AV_LOG_ERROR, "Too many outputs, at most %d are supported\n",
+                   MAX_SLAVES);
+            ret = AVERROR(EINVAL);
+            goto fail;
+        }
+        slave = &tee->slaves[tee->nb_slaves++];
+        if ((ret = open_slave(avf, slave, spec)) < 0)
+            goto fail;
+#if HAVE_PTHREADS
+        {
+            SlaveThreadArg *arg = av_malloc(sizeof(*arg));
+            if (!arg) {
+                ret = AVERROR(ENOMEM);
+                goto fail;
+            }
+            arg->tee   = tee;
+            arg->slave = slave;
+            pthread_mutex_init(&slave->lock, NULL);
+            pthread_cond_init(&slave->cond, NULL);
+            if (pthread_create(&slave->thread, NULL, slave_thread, arg)) {
+                av_free(arg);
+                pthread_mutex_destroy(&slave->lock);
+                pthread_cond_destroy(&slave->cond);
+                ret = AVERROR(ENOMEM);
+                goto fail;
+            }
+            slave->thread_started = 1;
+        }
+#endif
+    }
+    if (!tee->nb_slaves) {
+        av_log(avf, AV_LOG_ERROR, "No outputs given\n");
+        ret = AVERROR(EINVAL);
+        goto fail;
+    }
+    av_free(specs);
+    return 0;
+
+fail:
+    av_free(specs);
+    close_slaves(tee);
+    return ret;
+}
+
+#if HAVE_PTHREADS
+static int64_t packet_time(AVStream *st, AVPacket *pkt)
+{
+    int64_t ts = pkt->dts != AV_NOPTS_VALUE ? pkt->dts : pkt->pts;
+
+    if (ts == AV_NOPTS_VALUE)
+        return AV_NOPTS_VALUE;
+    return av_rescale_q(ts, st->time_base, AV_TIME_BASE_Q);
+}
+
+/**
+ * Decide whether a packet must be dropped for an output that cannot keep up.
+ * Once the queue is full every packet is dropped until one that the output
+ * can resume from arrives while there is room again: a video keyframe, or
+ * any packet for outputs without video.
+ * @param queued number of packets in the queue of the output
+ * @return 1 if the packet must be dropped, 0 otherwise
+ */
+static int drop_packet(AVFormatContext *avf, TeeSlave *slave, AVStream *st,
+                       AVPacket *pkt, int queued)
+{
+    TeeContext *tee = avf->priv_data;
+    int full = queued >= tee->queue_size;
+
+    if (!slave->dropping) {
+        if (!full)
+            return 0;
+        slave->dropping  = 1;
+        slave->gap_start = packet_time(st, pkt);
+        av_log(avf, AV_LOG_WARNING,
+               "Output %s is too slow, dropping packets until the next keyframe\n",
+               slave->avf->filename);
+    } else if (!full && (!slave->has_video ||
+                         (st->codec->codec_type == AVMEDIA_TYPE_VIDEO &&
+                          pkt->flags & AV_PKT_FLAG_KEY))) {
+        int64_t gap_end = packet_time(st, pkt);
+
+        slave->dropping = 0;
+        if (slave->gap_start != AV_NOPTS_VALUE && gap_end != AV_NOPTS_VALUE)
+            av_log(avf, AV_LOG_WARNING,
+                   "Output %s resumes at %0.3f s, gap from %0.3f s, %d packets dropped so far\n",
+                   slave->avf->filename, gap_end / (double)AV_TIME_BASE,
+                   slave->gap_start / (double)AV_TIME_BASE, slave->nb_dropped);
+        else
+            av_log(avf, AV_LOG_WARNING,
+                   "Output %s resumes, %d packets dropped so far\n",
+                   slave->avf->filename, slave->nb_dropped);
+        return 0;
+    }
+    slave->nb_dropped++;
+    return 1;
+}
+#endif
+
+static int tee_write_packet(AVFormatContext *avf, AVPacket *pkt)
+{
+    TeeContext *tee = avf->priv_data;
+    AVStream *st = avf->streams[pkt->stream_index];
+    TeeBuffer *buf;
+    int i, nb_ok = 0;
+
+    buf = av_mallocz(sizeof(*buf));
+    if (!buf)
+        return AVERROR(ENOMEM);
+    buf->data = av_malloc(pkt->size + FF_INPUT_BUFFER_PADDING_SIZE);
+    if (!buf->data) {
+        av_free(buf);
+        return AVERROR(ENOMEM);
+    }
+    memcpy(buf->data, pkt->data, pkt->size);
+    memset(buf->data + pkt->size, 0, FF_INPUT_BUFFER_PADDING_SIZE);
+    /* held by this function until every output has queued the packet */
+    buf->refs = 1;
+
+    for (i = 0; i < tee->nb_slaves; i++) {
+        TeeSlave *slave = &tee->slaves[i];
+        AVStream *st2 = slave->avf->streams[pkt->stream_index];
+        TeePacket *tp;
+        int error;
+#if HAVE_PTHREADS
+        int queued;
+
+        pthread_mutex_lock(&slave->lock);
+        error  = slave->error;
+        queued = slave->nb_queued;
+        pthread_mutex_unlock(&slave->lock);
+#else
+        error  = slave->error;
+#endif
+        if (error)
+            continue;
+        nb_ok++;
+#if HAVE_PTHREADS
+        if (drop_packet(avf, slave, st, pkt, queued))
+            continue;
+#endif
+        tp = av_malloc(sizeof(*tp));
+        if (!tp) {
+            release_buffer(tee, buf);
+            return AVERROR(ENOMEM);
+        }
+        tp->pkt       = *pkt;
+        tp->pkt.data  = buf->data;
+        tp->pkt.destruct = NULL;
+        tp->pkt.priv  = NULL;
+        if (pkt->pts != AV_NOPTS_VALUE)
+            tp->pkt.pts = av_rescale_q(pkt->pts, st->time_base, st2->time_base);
+        if (pkt->dts != AV_NOPTS_VALUE)
+            tp->pkt.dts = av_rescale_q(pkt->dts, st->time_base, st2->time_base);
+        tp->pkt.duration = av_rescale_q(pkt->duration, st->time_base, st2->time_base);
+        tp->buf  = buf;
+        tp->next = NULL;
+
+#if HAVE_PTHREADS
+        pthread_mutex_lock(&tee->buf_lock);
+        buf->refs++;
+        pthread_mutex_unlock(&tee->buf_lock);
+
+        pthread_mutex_lock(&slave->lock);
+        if (slave->queue_end)
+            slave->queue_end->next = tp;
+        else
+            slave->queue = tp;
+        slave->queue_end = tp;
+        slave->nb_queued++;
+        pthread_cond_signal(&slave->cond);
+        pthread_mutex_unlock(&slave->lock);
+#else
+        buf->refs++;
+        slave->error = write_slave_packet(tee, slave, tp, slave->error);
+#endif
+    }
+    release_buffer(tee, buf);
+
+    return nb_ok ? 0 : AVERROR(EIO);
+}
+
+static int tee_write_trailer(AVFormatContext *avf)
+{
+    TeeContext *tee = avf->priv_data;
+    int i, ret = 0;
+
+    for (i = 0; i < tee->nb_slaves; i++) {
+        TeeSlave *slave = &tee->slaves[i];
+
+        stop_slave_thread(slave);
+        if (slave->nb_dropped)
+            av_log(avf, AV_LOG_WARNING, "%d packets dropped for output %s\n",
+                   slave->nb_dropped, slave->avf->filename);
+        if (!slave->error) {
+            int err = av_write_trailer(slave->avf);
+            if (err < 0 && !ret)
+                ret = err;
+        } else if (!ret) {
+            ret = slave->error;
+        }
+    }
+    close_slaves(tee);
+    return ret;
+}
+
+AVOutputFormat ff_tee_muxer = {
+    "tee",
+    NULL_IF_CONFIG_SMALL("Multiple muxer tee"),
+    NULL,
+    NULL,
+    sizeof(TeeContext),
+    CODEC_ID_MP2,
+    CODEC_ID_MPEG4,
+    tee_write_header,
+    tee_write_packet,
+    tee_write_trailer,
+    .flags = AVFMT_NOFILE,
+    .priv_class = &tee_muxer_class,
+};
@@ -79,6 +79,17 @@ TimeFilter * ff_timefilter_new(double clock_period, double feedback2_factor, dou
  */
 double ff_timefilter_update(TimeFilter *self, double system_time, double period);
 
+/**
+ * Evaluate the filtered time at a given distance from the last update
+ *
+ * @param delta the distance from the last update, in clock_periods as
+ * passed to ff_timefilter_update()
+ *
+ * @return the filtered time, in seconds, extrapolated with the current
+ * estimate of the clock period
+ */
+double ff_timefilter_eval(TimeFilter *self, double delta);
+
 /**
  * Reset the filter
  *
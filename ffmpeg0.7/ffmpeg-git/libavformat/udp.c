@@ -25,6 +25,7 @@
  */
 
 #define _BSD_SOURCE     /* Needed for using struct ip_mreq with recent glibc */
+#define _GNU_SOURCE     /* Needed for sendmmsg */
 #define _DARWIN_C_SOURCE /* Needed for using IP_MULTICAST_TTL on OS X */
 #include "avformat.h"
 #include "avio_internal.h"
@@ -34,6 +35,9 @@
 #include "network.h"
 #include "os_support.h"
 #include "url.h"
+#if !HAVE_WINSOCK2_H
+#include <sys/uio.h>
+#endif
 #if HAVE_TERMIOS_H
 #include <sys/time.h>
 #endif
@@ -53,6 +57,11 @@ typedef struct {
     struct sockaddr_storage dest_addr;
     int dest_addr_len;
     int is_connected;
+
+    /* output pacing */
+    int64_t bitrate;
+    int64_t pace_start;
+    int64_t pace_bytes;
 } UDPContext;
 
 #define UDP_TX_BUF_SIZE 32768
@@ -377,6 +386,9 @@ static int udp_open(URLContext *h, const char *uri, int flags)
         if (av_find_info_tag(buf, sizeof(buf), "connect", p)) {
             s->is_connected = strtol(buf, NULL, 10);
         }
+        if (av_find_info_tag(buf, sizeof(buf), "bitrate", p)) {
+            s->bitrate = strtoll(buf, NULL, 10);
+        }
     }
 
     /* fill the dest addr */
@@ -480,11 +492,40 @@ static int udp_read(URLContext *h, uint8_t *buf, int size)
     return ret < 0 ? ff_neterrno() : ret;
 }
 
+/**
+ * Wait until a packet of size bytes can be sent without exceeding the
+ * bitrate, so that packets are spread evenly in time instead of being
+ * sent in bursts.
+ */
+static int udp_pace(URLContext *h, int size)
+{
+    UDPContext *s = h->priv_data;
+    int64_t now = av_gettime(), target;
+
+    target = s->pace_start + av_rescale(s->pace_bytes, 8 * 1000000, s->bitrate);
+    /* restart the clock after a stall instead of catching up in a burst */
+    if (!s->pace_start || now - target > 100000) {
+        s->pace_start = now;
+        s->pace_bytes = 0;
+        target        = now;
+    }
+    if (target > now) {
+        if (h->flags & AVIO_FLAG_NONBLOCK)
+            return AVERROR(EAGAIN);
+        usleep(target - now);
+    }
+    s->pace_bytes += size;
+    return 0;
+}
+
 static int udp_write(URLContext *h, const uint8_t *buf, int size)
 {
     UDPContext *s = h->priv_data;
     int ret;
 
+    if (s->bitrate && (ret = udp_pace(h, size)) < 0)
+        return ret;
+
     if (!(h->flags & AVIO_FLAG_NONBLOCK)) {
         ret = ff_network_wait_fd(s->udp_fd, 1);
         if (ret < 0)
@@ -501,6 +542,67 @@ static int udp_write(URLContext *h, const uint8_t *buf, int size)
     return ret < 0 ? ff_neterrno() : ret;
 }
 
+#if !HAVE_WINSOCK2_H
+#define UDP_MAX_BATCH 64
+
+/* send the header and payload of each packet from where they are, and
+ * as many packets as possible with one call */
+static int udp_write_packets(URLContext *h, const URLPacket *pkts, int nb_pkts)
+{
+    UDPContext *s = h->priv_data;
+    struct iovec iov[UDP_MAX_BATCH][2];
+#if HAVE_SENDMMSG
+    struct mmsghdr msgs[UDP_MAX_BATCH];
+#else
+    struct msghdr msg1;
+#endif
+    struct msghdr *msg;
+    int i, ret;
+
+    if (!(h->flags & AVIO_FLAG_NONBLOCK)) {
+        ret = ff_network_wait_fd(s->udp_fd, 1);
+        if (ret < 0)
+            return ret;
+    }
+
+    nb_pkts = FFMIN(nb_pkts, UDP_MAX_BATCH);
+    if (s->bitrate) {
+        /* paced packets are sent one by one */
+        nb_pkts = 1;
+        if ((ret = udp_pace(h, pkts[0].hdr_size + pkts[0].size)) < 0)
+            return ret;
+    }
+    for (i = 0; i < nb_pkts; i++) {
+#if HAVE_SENDMMSG
+        msg = &msgs[i].msg_hdr;
+#else
+        msg = &msg1;
+#endif
+        iov[i][0].iov_base = (void *)(uintptr_t)pkts[i].hdr;
+        iov[i][0].iov_len  = pkts[i].hdr_size;
+        iov[i][1].iov_base = (void *)(uintptr_t)pkts[i].data;
+        iov[i][1].iov_len  = pkts[i].size;
+        memset(msg, 0, sizeof(*msg));
+        if (!s->is_connected) {
+            msg->msg_name    = &s->dest_addr;
+            msg->msg_namelen = s->dest_addr_len;
+        }
+        msg->msg_iov    = iov[i];
+        msg->msg_iovlen = 2;
+#if !HAVE_SENDMMSG
+        if (sendmsg(s->udp_fd, msg, 0) < 0)
+            return i ? i : ff_neterrno();
+#endif
+    }
+#if HAVE_SENDMMSG
+    ret = sendmmsg(s->udp_fd, msgs, nb_pkts, 0);
+    return ret < 0 ? ff_neterrno() : ret;
+#else
+    return nb_pkts;
+#endif
+}
+#endif
+
 static int udp_close(URLContext *h)
 {
     UDPContext *s = h->priv_data;
@@ -519,4 +621,7 @@ URLProtocol ff_udp_protocol = {
     .url_write           = udp_write,
     .url_close           = udp_close,
     .url_get_file_handle = udp_get_file_handle,
+#if !HAVE_WINSOCK2_H
+    .url_write_packets   = udp_write_packets,
+#endif
 };
@@ -60,6 +60,7 @@ typedef struct URLProtocol {
     const AVClass *priv_data_class;
     int flags;
     int (*url_check)(URLContext *h, int mask);
+    int     (*url_write_packets)(URLContext *h, const struct URLPacket *pkts, int nb_pkts);
 } URLProtocol;
 #endif
 
@@ -122,6 +123,28 @@ int ffurl_read_complete(URLContext *h, unsigned char *buf, int size);
  */
 int ffurl_write(URLContext *h, const unsigned char *buf, int size);
 
+/**
+ * A packet for ffurl_write_packets(): a header followed by a payload,
+ * which do not need to be contiguous in memory.
+ */
+typedef struct URLPacket {
+    const uint8_t *hdr;
+    int hdr_size;
+    const uint8_t *data;
+    int size;
+} URLPacket;
+
+/**
+ * Write packets to the packetized resource accessed by h, with the same
+ * result as one ffurl_write() call per packet, but without gathering
+ * the packets in memory and with fewer system calls if the protocol
+ * supports it.
+ *
+ * @return 0 on success, or a negative value corresponding to an
+ * AVERROR code in case of failure
+ */
+int ffurl_write_packets(URLContext *h, const URLPacket *pkts, int nb_pkts);
+
 /**
  * Change the position that will be used by the next read/write
  * operation on the resource accessed by h.
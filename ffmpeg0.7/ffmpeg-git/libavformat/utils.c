@@ -33,6 +33,7 @@
 #include "riff.h"
 #include "audiointerleave.h"
 #include "url.h"
+#include "timefilter.h"
 #if HAVE_TERMIOS_H
 #include <sys/time.h>
 #endif
@@ -697,6 +698,81 @@ static AVPacket *add_to_pktbuf(AVPacketList **packet_buffer, AVPacket *pkt,
     return &pktl->pkt;
 }
 
+/* bandwidth of the clock recovery loop, in Hz */
+#define INPUT_CLOCK_BANDWIDTH 0.1
+/* timestamp jumps and arrival time errors that restart the recovery, in seconds */
+#define INPUT_CLOCK_MAX_DELTA 10.0
+#define INPUT_CLOCK_MAX_ERROR 1.0
+
+typedef struct InputClock {
+    TimeFilter *filter;
+    int stream_index;   ///< stream whose timestamps drive the filter
+    int64_t last_ts;    ///< last timestamp of that stream
+} InputClock;
+
+static void update_input_clock(AVFormatContext *s, AVStream *st, AVPacket *pkt)
+{
+    InputClock *c = s->input_clock;
+    int64_t ts = pkt->dts != AV_NOPTS_VALUE ? pkt->dts : pkt->pts;
+    double now = av_gettime() / 1000000.0, delta;
+
+    if (ts == AV_NOPTS_VALUE)
+        return;
+    if (!c) {
+        c = s->input_clock = av_mallocz(sizeof(*c));
+        if (!c)
+            return;
+        c->stream_index = st->index;
+        c->last_ts      = AV_NOPTS_VALUE;
+    }
+    if (st->index != c->stream_index)
+        return;
+
+    if (c->last_ts == AV_NOPTS_VALUE) {
+        c->last_ts = ts;
+        return;
+    }
+    delta = (ts - c->last_ts) * av_q2d(st->time_base);
+    if (!delta)
+        return;
+    if (!c->filter) {
+        /* the loop gains depend on the update period, take the first one */
+        double o = 2 * M_PI * INPUT_CLOCK_BANDWIDTH * FFMIN(FFABS(delta), 1.0);
+        c->filter = ff_timefilter_new(1.0, sqrt(2 * o), o * o);
+        if (!c->filter)
+            return;
+    } else if (delta < 0 || delta > INPUT_CLOCK_MAX_DELTA ||
+               fabs(now - ff_timefilter_eval(c->filter, delta)) > INPUT_CLOCK_MAX_ERROR) {
+        av_log(s, AV_LOG_VERBOSE, "Input clock discontinuity, restarting recovery\n");
+        ff_timefilter_reset(c->filter);
+    }
+    ff_timefilter_update(c->filter, now, delta);
+    c->last_ts = ts;
+}
+
+int64_t av_get_input_wallclock(AVFormatContext *s, int stream_index, int64_t ts)
+{
+    InputClock *c = s->input_clock;
+    double delta;
+
+    if (!c || !c->filter || ts == AV_NOPTS_VALUE ||
+        stream_index < 0 || stream_index >= s->nb_streams)
+        return AV_NOPTS_VALUE;
+    delta = ts * av_q2d(s->streams[stream_index]->time_base) -
+            c->last_ts * av_q2d(s->streams[c->stream_index]->time_base);
+    return llrint(ff_timefilter_eval(c->filter, delta) * 1000000.0);
+}
+
+double av_get_input_clock_drift(AVFormatContext *s)
+{
+    InputClock *c = s->input_clock;
+
+    if (!c || !c->filter)
+        return 0;
+    return (ff_timefilter_eval(c->filter, 1.0) -
+            ff_timefilter_eval(c->filter, 0.0) - 1.0) * 1000000.0;
+}
+
 int av_read_packet(AVFormatContext *s, AVPacket *pkt)
 {
     int ret, i;
@@ -727,6 +803,9 @@ int av_read_packet(AVFormatContext *s, AVPacket *pkt)
         }
         st= s->streams[pkt->stream_index];
 
+        if (s->flags & AVFMT_FLAG_CLOCK_RECOVERY)
+            update_input_clock(s, st, pkt);
+
         switch(st->codec->codec_type){
         case AVMEDIA_TYPE_VIDEO:
             if(s->video_codec_id)   st->codec->codec_id= s->video_codec_id;
@@ -2668,6 +2747,10 @@ void avformat_free_context(AVFormatContext *s)
     av_freep(&s->chapters);
     av_metadata_free(&s->metadata);
     av_freep(&s->key);
+    if (s->input_clock) {
+        ff_timefilter_destroy(s->input_clock->filter);
+        av_freep(&s->input_clock);
+    }
     av_free(s);
 }
 
@@ -0,0 +1,52 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "atomic.h"
+
+#if !defined(__GNUC__) && !defined(_MSC_VER) && HAVE_PTHREADS
+#include <pthread.h>
+
+/* one lock for all the variables, so that they may be shared by any files */
+static pthread_mutex_t atomic_lock = PTHREAD_MUTEX_INITIALIZER;
+
+void ff_memory_barrier(void)
+{
+    pthread_mutex_lock(&atomic_lock);
+    pthread_mutex_unlock(&atomic_lock);
+}
+
+int ff_atomic_cas32(volatile uint32_t *p, uint32_t old, uint32_t val)
+{
+    int ret;
+    pthread_mutex_lock(&atomic_lock);
+    if ((ret = *p == old))
+        *p = val;
+    pthread_mutex_unlock(&atomic_lock);
+    return ret;
+}
+
+int ff_atomic_cas_ptr(void * volatile *p, void *old, void *val)
+{
+    int ret;
+    pthread_mutex_lock(&atomic_lock);
+    if ((ret = *p == old))
+        *p = val;
+    pthread_mutex_unlock(&atomic_lock);
+    return ret;
+}
+#endif
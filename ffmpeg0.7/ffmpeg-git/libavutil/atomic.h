@@ -0,0 +1,92 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * compare-and-swap and full memory barrier, internal to libavutil
+ *
+ * The compiler builtins are used with gcc and the Interlocked functions
+ * with MSVC. Other compilers fall back to a global mutex when pthreads
+ * are available, and to plain accesses in single-threaded builds.
+ */
+
+#ifndef AVUTIL_ATOMIC_H
+#define AVUTIL_ATOMIC_H
+
+#include <stdint.h>
+#include "config.h"
+#include "attributes.h"
+
+#if defined(__GNUC__)
+
+#define ff_memory_barrier() __sync_synchronize()
+
+static av_always_inline int ff_atomic_cas32(volatile uint32_t *p, uint32_t old, uint32_t val)
+{
+    return __sync_bool_compare_and_swap(p, old, val);
+}
+
+static av_always_inline int ff_atomic_cas_ptr(void * volatile *p, void *old, void *val)
+{
+    return __sync_bool_compare_and_swap(p, old, val);
+}
+
+#elif defined(_MSC_VER)
+#include <windows.h>
+
+#define ff_memory_barrier() MemoryBarrier()
+
+static av_always_inline int ff_atomic_cas32(volatile uint32_t *p, uint32_t old, uint32_t val)
+{
+    return InterlockedCompareExchange((volatile LONG *)p, val, old) == (LONG)old;
+}
+
+static av_always_inline int ff_atomic_cas_ptr(void * volatile *p, void *old, void *val)
+{
+    return InterlockedCompareExchangePointer(p, val, old) == old;
+}
+
+#elif HAVE_PTHREADS
+
+void ff_memory_barrier(void);
+int ff_atomic_cas32(volatile uint32_t *p, uint32_t old, uint32_t val);
+int ff_atomic_cas_ptr(void * volatile *p, void *old, void *val);
+
+#else
+
+#define ff_memory_barrier()
+
+static inline int ff_atomic_cas32(volatile uint32_t *p, uint32_t old, uint32_t val)
+{
+    if (*p != old)
+        return 0;
+    *p = val;
+    return 1;
+}
+
+static inline int ff_atomic_cas_ptr(void * volatile *p, void *old, void *val)
+{
+    if (*p != old)
+        return 0;
+    *p = val;
+    return 1;
+}
+
+#endif
+
+#endif /* AVUTIL_ATOMIC_H */
@@ -37,12 +37,18 @@ static struct {
     [AV_CRC_32_IEEE]    = { 0, 32, 0x04C11DB7 },
     [AV_CRC_32_IEEE_LE] = { 1, 32, 0xEDB88320 },
 };
+#if CONFIG_SMALL
 static AVCRC av_crc_table[AV_CRC_MAX][257];
+#else
+static AVCRC av_crc_table[AV_CRC_MAX][2049];
+#endif
 #endif
 
 /**
  * Initialize a CRC table.
- * @param ctx must be an array of size sizeof(AVCRC)*257 or sizeof(AVCRC)*1024
+ * @param ctx must be an array of size sizeof(AVCRC)*257, sizeof(AVCRC)*1024
+ *            or sizeof(AVCRC)*2049; the larger tables let av_crc() process
+ *            4 or 8 bytes per step
  * @param le If 1, the lowest bit represents the coefficient for the highest
  *           exponent of the corresponding polynomial (both for poly and
  *           actual CRC).
@@ -62,7 +68,8 @@ int av_crc_init(AVCRC *ctx, int le, int bits, uint32_t poly, int ctx_size){
 
     if (bits < 8 || bits > 32 || poly >= (1LL<<bits))
         return -1;
-    if (ctx_size != sizeof(AVCRC)*257 && ctx_size != sizeof(AVCRC)*1024)
+    if (ctx_size != sizeof(AVCRC)*257 && ctx_size != sizeof(AVCRC)*1024 &&
+        ctx_size != sizeof(AVCRC)*2049)
         return -1;
 
     for (i = 0; i < 256; i++) {
@@ -78,10 +85,21 @@ int av_crc_init(AVCRC *ctx, int le, int bits, uint32_t poly, int ctx_size){
     }
     ctx[256]=1;
 #if !CONFIG_SMALL
-    if(ctx_size >= sizeof(AVCRC)*1024)
+    if(ctx_size == sizeof(AVCRC)*1024)
         for (i = 0; i < 256; i++)
             for(j=0; j<3; j++)
                 ctx[256*(j+1) + i]= (ctx[256*j + i]>>8) ^ ctx[ ctx[256*j + i]&0xFF ];
+    /* slice-by-8 tables follow the marker, which tells them from the above */
+    if(ctx_size == sizeof(AVCRC)*2049){
+        ctx[256]= 2;
+        for (i = 0; i < 256; i++){
+            c= ctx[i];
+            for(j=1; j<8; j++){
+                c= (c>>8) ^ ctx[c&0xFF];
+                ctx[1 + 256*j + i]= c;
+            }
+        }
+    }
 #endif
 
     return 0;
@@ -94,7 +112,7 @@ int av_crc_init(AVCRC *ctx, int le, int bits, uint32_t poly, int ctx_size){
  */
 const AVCRC *av_crc_get_table(AVCRCId crc_id){
 #if !CONFIG_HARDCODED_TABLES
-    if (!av_crc_table[crc_id][FF_ARRAY_ELEMS(av_crc_table[crc_id])-1])
+    if (!av_crc_table[crc_id][256])
         if (av_crc_init(av_crc_table[crc_id],
                         av_crc_table_params[crc_id].le,
                         av_crc_table_params[crc_id].bits,
@@ -116,7 +134,25 @@ uint32_t av_crc(const AVCRC *ctx, uint32_t crc, const uint8_t *buffer, size_t le
     const uint8_t *end= buffer+length;
 
 #if !CONFIG_SMALL
-    if(!ctx[256]) {
+    if(ctx[256] == 2) {
+        const AVCRC *t= ctx + 1;
+
+        while(((intptr_t) buffer & 7) && buffer < end)
+            crc = ctx[((uint8_t)crc) ^ *buffer++] ^ (crc >> 8);
+
+        while(buffer<end-7){
+            uint32_t hi= av_le2ne32(((const uint32_t*)buffer)[1]);
+            crc ^= av_le2ne32(((const uint32_t*)buffer)[0]); buffer+=8;
+            crc =  t[7*256 + ( crc     &0xFF)]
+                  ^t[6*256 + ((crc>>8 )&0xFF)]
+                  ^t[5*256 + ((crc>>16)&0xFF)]
+                  ^t[4*256 + ((crc>>24)     )]
+                  ^t[3*256 + ( hi      &0xFF)]
+                  ^t[2*256 + ((hi >>8 )&0xFF)]
+                  ^t[1*256 + ((hi >>16)&0xFF)]
+                  ^ctx[       ((hi >>24)     )];
+        }
+    }else if(!ctx[256]) {
         while(((intptr_t) buffer & 3) && buffer < end)
             crc = ctx[((uint8_t)crc) ^ *buffer++] ^ (crc >> 8);
 
@@ -136,10 +172,17 @@ uint32_t av_crc(const AVCRC *ctx, uint32_t crc, const uint8_t *buffer, size_t le
 }
 
 #ifdef TEST
+#include <stdio.h>
+#include <time.h>
 #undef printf
+#define BENCH_SIZE (1 << 20)
+#define BENCH_RUNS 512
 int main(void){
+    static uint8_t big[BENCH_SIZE];
+    static AVCRC tables[3][2049];
+    static const int sizes[3] = { 257, 1024, 2049 };
     uint8_t buf[1999];
-    int i;
+    int i, j, k;
     int p[4][3]={{AV_CRC_32_IEEE_LE, 0xEDB88320, 0x3D5CDD04},
                  {AV_CRC_32_IEEE   , 0x04C11DB7, 0xC0F5BAE0},
                  {AV_CRC_16_ANSI   , 0x8005,     0x1FBB    },
@@ -153,6 +196,33 @@ int main(void){
         ctx = av_crc_get_table(p[i][0]);
         printf("crc %08X =%X\n", p[i][1], av_crc(ctx, 0, buf, sizeof(buf)));
     }
+
+    /* all table sizes must agree, whatever the alignment and length */
+    for(i=0; i<4; i++){
+        int le= i == 0, bits= i < 2 ? 32 : i == 2 ? 16 : 8;
+        for(k=0; k<3; k++)
+            av_crc_init(tables[k], le, bits, p[i][1], sizes[k]*sizeof(AVCRC));
+        for(j=0; j<64; j++){
+            uint32_t ref= av_crc(tables[0], 0, buf + j, sizeof(buf) - 3*j);
+            for(k=1; k<3; k++)
+                if(av_crc(tables[k], 0, buf + j, sizeof(buf) - 3*j) != ref){
+                    printf("crc %08X mismatch with %d entries\n", p[i][1], sizes[k]);
+                    return 1;
+                }
+        }
+    }
+
+    for(i=0; i<BENCH_SIZE; i++)
+        big[i]= i*i + (i>>8);
+    for(k=0; k<3; k++){
+        uint32_t crc= 0;
+        clock_t t= clock();
+        for(j=0; j<BENCH_RUNS; j++)
+            crc= av_crc(tables[k], crc, big, BENCH_SIZE);
+        t= clock() - t;
+        printf("%4d entries: %6.2f GB/s (%08X)\n", sizes[k],
+               (double)BENCH_SIZE*BENCH_RUNS*CLOCKS_PER_SEC / FFMAX(t, 1) / 1e9, crc);
+    }
     return 0;
 }
 #endif
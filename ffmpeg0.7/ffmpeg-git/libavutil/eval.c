@@ -122,6 +122,7 @@ struct AVExpr {
         e_mod, e_max, e_min, e_eq, e_gt, e_gte,
         e_pow, e_mul, e_div, e_add,
         e_last, e_st, e_while, e_floor, e_ceil, e_trunc,
+        e_jz, e_jmp, // bytecode only
     } type;
     double value; // is sign in other types
     union {
@@ -131,8 +132,39 @@ struct AVExpr {
         double (*func2)(void *, double, double);
     } a;
     struct AVExpr *param[2];
+    struct ExprCode *code; // compiled form, on the root only
 };
 
+/**
+ * One bytecode instruction: it computes a node of the tree into register
+ * reg from its operands in reg and reg + 1, so that registers work as a
+ * stack indexed by the depth in the tree.
+ */
+typedef struct ExprInsn {
+    int type;           // an AVExpr type
+    int reg;
+    int target;         // for e_jz and e_jmp
+    double value;
+    union {
+        int const_index;
+        double (*func0)(double);
+        double (*func1)(void *, double);
+        double (*func2)(void *, double, double);
+    } a;
+} ExprInsn;
+
+#define MAX_REGS 32
+#define LANES    64
+
+typedef struct ExprCode {
+    ExprInsn *insn;
+    int nb_insn;
+    int nb_regs;
+    int has_jumps;
+    int has_vars;
+    double *lane_regs;  ///< registers and variables of av_expr_eval_array(), allocated on its first call
+} ExprCode;
+
 static double eval_expr(Parser *p, AVExpr *e)
 {
     switch (e->type) {
@@ -183,6 +215,11 @@ void av_expr_free(AVExpr *e)
     if (!e) return;
     av_expr_free(e->param[0]);
     av_expr_free(e->param[1]);
+    if (e->code) {
+        av_freep(&e->code->insn);
+        av_freep(&e->code->lane_regs);
+    }
+    av_freep(&e->code);
     av_freep(&e);
 }
 
@@ -454,6 +491,175 @@ static int verify_expr(AVExpr *e)
     }
 }
 
+/**
+ * Replace the subtrees which depend neither on the constants nor on the
+ * functions, variables or loops by their value.
+ * @return 1 if e is now a value
+ */
+static int fold_expr(AVExpr *e)
+{
+    Parser p;
+    int c0, c1;
+
+    if (!e) return 1;
+    c0 = fold_expr(e->param[0]);
+    c1 = fold_expr(e->param[1]);
+    switch (e->type) {
+        case e_value: return 1;
+        case e_const:
+        case e_func1:
+        case e_func2:
+        case e_ld:
+        case e_st:
+        case e_while: return 0;
+    }
+    if (!c0 || !c1)
+        return 0;
+
+    e->value = eval_expr(&p, e);
+    e->type  = e_value;
+    av_expr_free(e->param[0]);
+    av_expr_free(e->param[1]);
+    e->param[0] = e->param[1] = NULL;
+    return 1;
+}
+
+static int count_nodes(AVExpr *e)
+{
+    return e ? 1 + count_nodes(e->param[0]) + count_nodes(e->param[1]) : 0;
+}
+
+static ExprInsn *emit(ExprCode *c, int type, int reg, AVExpr *e)
+{
+    ExprInsn *insn = &c->insn[c->nb_insn++];
+
+    insn->type  = type;
+    insn->reg   = reg;
+    insn->value = e ? e->value : 0;
+    if (e)
+        memcpy(&insn->a, &e->a, sizeof(insn->a));
+    c->nb_regs  = FFMAX(c->nb_regs, reg + 1);
+    return insn;
+}
+
+static void compile_expr(ExprCode *c, AVExpr *e, int reg)
+{
+    ExprInsn *jz;
+    int loop;
+
+    switch (e->type) {
+        case e_value:
+        case e_const: break;
+        case e_while:
+            emit(c, e_value, reg, NULL)->value = NAN;
+            loop = c->nb_insn;
+            compile_expr(c, e->param[0], reg + 1);
+            jz = emit(c, e_jz, reg + 1, NULL);
+            compile_expr(c, e->param[1], reg);
+            emit(c, e_jmp, reg, NULL)->target = loop;
+            jz->target = c->nb_insn;
+            c->has_jumps = 1;
+            return;
+        case e_func2:
+        case e_mod: case e_max: case e_min: case e_eq: case e_gt: case e_gte:
+        case e_pow: case e_mul: case e_div: case e_add: case e_last: case e_st:
+            compile_expr(c, e->param[0], reg);
+            compile_expr(c, e->param[1], reg + 1);
+            break;
+        default:
+            /* the second parameter of unary functions is never evaluated */
+            compile_expr(c, e->param[0], reg);
+    }
+    c->has_vars |= e->type == e_ld || e->type == e_st;
+    emit(c, e->type, reg, e);
+}
+
+/**
+ * Compile the tree into bytecode, leaving e->code NULL if it needs more
+ * than MAX_REGS registers or on allocation failure.
+ */
+static void compile(AVExpr *e)
+{
+    ExprCode *c = av_mallocz(sizeof(*c));
+
+    /* a node takes one instruction, a loop three more */
+    if (!c || !(c->insn = av_malloc(4 * count_nodes(e) * sizeof(*c->insn)))) {
+        av_free(c);
+        return;
+    }
+    compile_expr(c, e, 0);
+    if (c->nb_regs > MAX_REGS) {
+        av_free(c->insn);
+        av_freep(&c);
+    }
+    e->code = c;
+}
+
+#define RUN_CODE(lanes, CONST_VALUE, LD, ST) {                                  \
+    const ExprInsn *insn = c->insn, *end = insn + c->nb_insn;                   \
+    int l;                                                                      \
+                                                                                \
+    while (insn < end) {                                                        \
+        double *d = r + insn->reg * lanes, *d2 = d + lanes, v = insn->value;    \
+        switch (insn->type) {                                                   \
+        case e_value:  for (l = 0; l < lanes; l++) d[l] = v; break;             \
+        case e_const:  for (l = 0; l < lanes; l++) d[l] = v * CONST_VALUE; break; \
+        case e_func0:  for (l = 0; l < lanes; l++) d[l] = v * insn->a.func0(d[l]); break; \
+        case e_func1:  for (l = 0; l < lanes; l++) d[l] = v * insn->a.func1(opaque, d[l]); break; \
+        case e_func2:  for (l = 0; l < lanes; l++) d[l] = v * insn->a.func2(opaque, d[l], d2[l]); break; \
+        case e_squish: for (l = 0; l < lanes; l++) d[l] = 1/(1+exp(4*d[l])); break; \
+        case e_gauss:  for (l = 0; l < lanes; l++) d[l] = exp(-d[l]*d[l]/2)/sqrt(2*M_PI); break; \
+        case e_ld:     for (l = 0; l < lanes; l++) d[l] = v * LD; break;        \
+        case e_isnan:  for (l = 0; l < lanes; l++) d[l] = v * !!isnan(d[l]); break; \
+        case e_floor:  for (l = 0; l < lanes; l++) d[l] = v * floor(d[l]); break; \
+        case e_ceil:   for (l = 0; l < lanes; l++) d[l] = v * ceil (d[l]); break; \
+        case e_trunc:  for (l = 0; l < lanes; l++) d[l] = v * trunc(d[l]); break; \
+        case e_mod:    for (l = 0; l < lanes; l++) d[l] = v * (d[l] - floor(d[l]/d2[l])*d2[l]); break; \
+        case e_max:    for (l = 0; l < lanes; l++) d[l] = v * (d[l] >  d2[l] ? d[l] : d2[l]); break; \
+        case e_min:    for (l = 0; l < lanes; l++) d[l] = v * (d[l] <  d2[l] ? d[l] : d2[l]); break; \
+        case e_eq:     for (l = 0; l < lanes; l++) d[l] = v * (d[l] == d2[l] ? 1.0 : 0.0); break; \
+        case e_gt:     for (l = 0; l < lanes; l++) d[l] = v * (d[l] >  d2[l] ? 1.0 : 0.0); break; \
+        case e_gte:    for (l = 0; l < lanes; l++) d[l] = v * (d[l] >= d2[l] ? 1.0 : 0.0); break; \
+        case e_pow:    for (l = 0; l < lanes; l++) d[l] = v * pow(d[l], d2[l]); break; \
+        case e_mul:    for (l = 0; l < lanes; l++) d[l] = v * (d[l] * d2[l]); break; \
+        case e_div:    for (l = 0; l < lanes; l++) d[l] = v * (d[l] / d2[l]); break; \
+        case e_add:    for (l = 0; l < lanes; l++) d[l] = v * (d[l] + d2[l]); break; \
+        case e_last:   for (l = 0; l < lanes; l++) d[l] = v * d2[l]; break;     \
+        case e_st:     for (l = 0; l < lanes; l++) d[l] = v * (ST = d2[l]); break; \
+        case e_jz:     if (!*d) { insn = c->insn + insn->target; continue; } break; \
+        case e_jmp:    insn = c->insn + insn->target; continue;                \
+        }                                                                       \
+        insn++;                                                                 \
+    }                                                                           \
+}
+
+static double run_code(const ExprCode *c, const double *const_values, void *opaque)
+{
+    double r[MAX_REGS], var[VARS];
+
+    /* only the registers the code uses, the result register included */
+    memset(r, 0, FFMAX(c->nb_regs, 1) * sizeof(*r));
+    if (c->has_vars)
+        memset(var, 0, sizeof(var));
+    RUN_CODE(1, const_values[insn->a.const_index],
+             var[av_clip(d[0], 0, VARS-1)], var[av_clip(d[0], 0, VARS-1)])
+    return r[0];
+}
+
+/**
+ * Run loop-free code on several sets of constants at once, each
+ * instruction processing all of them before the next one.
+ */
+static void run_code_lanes(const ExprCode *c, double *r, double *var, int lanes,
+                           const double *const_values, int stride, void *opaque)
+{
+    if (c->has_vars)
+        memset(var, 0, VARS * LANES * sizeof(*var));
+    RUN_CODE(lanes, const_values[l * stride + insn->a.const_index],
+             var[av_clip(d[l], 0, VARS-1) * LANES + l],
+             var[av_clip(d[l], 0, VARS-1) * LANES + l])
+}
+
 int av_expr_parse(AVExpr **expr, const char *s,
                   const char * const *const_names,
                   const char * const *func1_names, double (* const *funcs1)(void *, double),
@@ -497,6 +703,8 @@ int av_expr_parse(AVExpr **expr, const char *s,
         ret = AVERROR(EINVAL);
         goto end;
     }
+    fold_expr(e);
+    compile(e);
     *expr = e;
 end:
     av_free(w);
@@ -507,11 +715,39 @@ double av_expr_eval(AVExpr *e, const double *const_values, void *opaque)
 {
     Parser p;
 
+    if (e->code)
+        return run_code(e->code, const_values, opaque);
     p.const_values = const_values;
     p.opaque     = opaque;
+    memset(p.var, 0, sizeof(p.var));
     return eval_expr(&p, e);
 }
 
+void av_expr_eval_array(AVExpr *e, double *res, const double *const_values,
+                        int stride, int count, void *opaque)
+{
+    double *r = NULL;
+    int i;
+
+    if (e->code && !e->code->has_jumps) {
+        if (!e->code->lane_regs)
+            e->code->lane_regs = av_malloc((e->code->nb_regs + VARS) * LANES * sizeof(*r));
+        r = e->code->lane_regs;
+    }
+    if (!r) {
+        for (i = 0; i < count; i++)
+            res[i] = av_expr_eval(e, const_values + i * stride, opaque);
+        return;
+    }
+    for (i = 0; i < count; i += LANES) {
+        int lanes = FFMIN(count - i, LANES);
+
+        run_code_lanes(e->code, r, r + e->code->nb_regs * LANES, lanes,
+                       const_values + i * stride, stride, opaque);
+        memcpy(res + i, r, lanes * sizeof(*res));
+    }
+}
+
 int av_expr_parse_and_eval(double *d, const char *s,
                            const char * const *const_names, const double *const_values,
                            const char * const *func1_names, double (* const *funcs1)(void *, double),
@@ -563,7 +799,13 @@ void av_free_expr(AVExpr *e)
 #endif /* FF_API_OLD_EVAL_NAMES */
 
 #ifdef TEST
+#include <time.h>
 #undef printf
+#define BENCH_W 1920
+#define BENCH_H 1080
+
+static const char *bench_names[] = { "X", "Y", "W", "H", 0 };
+
 static double const_values[] = {
     M_PI,
     M_E,
@@ -655,6 +897,68 @@ int main(void)
                                    NULL, NULL, NULL, NULL, NULL, 0, NULL);
         STOP_TIMER("av_expr_parse_and_eval")
     }
+
+    /* per pixel evaluation as done by the filters: tree walk, bytecode,
+     * bytecode over a row at a time */
+    {
+        static const char *bench_exprs[] = {
+            "(X+Y)/2",
+            "128+64*sin(X*6.2832/W)*cos(Y*6.2832/H)",
+            "gt(X,W/2)*255 + lte(X,W/2)*(max(min(Y-H/4,255),0)+mod(X,16)*abs(-2))",
+            NULL
+        };
+        double *vals = av_malloc(BENCH_W * 4 * sizeof(*vals));
+        double *res  = av_malloc(BENCH_W * sizeof(*res));
+        double sum[3];
+        clock_t t[4];
+        AVExpr *e;
+        Parser p;
+        int x, y;
+
+        for (x = 0; x < BENCH_W; x++) {
+            vals[4*x + 0] = x;
+            vals[4*x + 2] = BENCH_W;
+            vals[4*x + 3] = BENCH_H;
+        }
+        for (expr = bench_exprs; *expr; expr++) {
+            if (av_expr_parse(&e, *expr, bench_names, NULL, NULL, NULL, NULL, 0, NULL) < 0)
+                return 1;
+            memset(sum, 0, sizeof(sum));
+            memset(&p, 0, sizeof(p));
+            p.const_values = vals;
+
+            t[0] = clock();
+            for (y = 0; y < BENCH_H; y++)
+                for (x = 0; x < BENCH_W; x++) {
+                    vals[4*x + 1] = y;
+                    p.const_values = vals + 4*x;
+                    sum[0] += eval_expr(&p, e);
+                }
+            t[1] = clock();
+            for (y = 0; y < BENCH_H; y++)
+                for (x = 0; x < BENCH_W; x++) {
+                    vals[4*x + 1] = y;
+                    sum[1] += av_expr_eval(e, vals + 4*x, NULL);
+                }
+            t[2] = clock();
+            for (y = 0; y < BENCH_H; y++) {
+                for (x = 0; x < BENCH_W; x++)
+                    vals[4*x + 1] = y;
+                av_expr_eval_array(e, res, vals, 4, BENCH_W, NULL);
+                for (x = 0; x < BENCH_W; x++)
+                    sum[2] += res[x];
+            }
+            t[3] = clock();
+            printf("'%s'\n  tree %6.1f, bytecode %6.1f, array %6.1f Mevals/s%s\n", *expr,
+                   BENCH_W * BENCH_H / 1e6 * CLOCKS_PER_SEC / FFMAX(t[1] - t[0], 1),
+                   BENCH_W * BENCH_H / 1e6 * CLOCKS_PER_SEC / FFMAX(t[2] - t[1], 1),
+                   BENCH_W * BENCH_H / 1e6 * CLOCKS_PER_SEC / FFMAX(t[3] - t[2], 1),
+                   sum[0] == sum[1] && sum[0] == sum[2] ? "" : ", MISMATCH");
+            av_expr_free(e);
+        }
+        av_free(vals);
+        av_free(res);
+    }
     return 0;
 }
 #endif
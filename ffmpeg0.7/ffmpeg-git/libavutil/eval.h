@@ -86,6 +86,21 @@ FFMPEGLIB_API int av_expr_parse(AVExpr **expr, const char *s,
  */
 FFMPEGLIB_API double av_expr_eval(AVExpr *e, const double *const_values, void *opaque);
 
+/**
+ * Evaluate a previously parsed expression for several sets of constant
+ * values, which is faster than calling av_expr_eval() for each of them.
+ * The expression keeps its working memory between calls, so this must not
+ * be called from several threads at once for the same expression.
+ *
+ * @param res array where the count results are put
+ * @param const_values count arrays of values for the identifiers from
+ * av_expr_parse() const_names, the i-th one starting at const_values + i * stride
+ * @param stride distance in elements between two arrays of const_values
+ * @param opaque a pointer which will be passed to all functions from funcs1 and funcs2
+ */
+FFMPEGLIB_API void av_expr_eval_array(AVExpr *e, double *res, const double *const_values,
+                                      int stride, int count, void *opaque);
+
 /**
  * Free a parsed expression previously created with av_expr_parse().
  */
@@ -24,6 +24,16 @@
 #include "imgutils.h"
 #include "internal.h"
 #include "libavutil/pixdesc.h"
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define HAVE_SSE2_INTRINSICS 1
+#else
+#define HAVE_SSE2_INTRINSICS 0
+#endif
+
+/* images larger than this are copied with non-temporal stores, which do
+ * not evict the rest of the caches for data nobody reads back soon */
+#define STREAM_COPY_MIN (4 << 20)
 
 void av_image_fill_max_pixsteps(int max_pixsteps[4], int max_pixstep_comps[4],
                                 const AVPixFmtDescriptor *pixdesc)
@@ -183,8 +193,13 @@ int av_image_alloc(uint8_t *pointers[4], int linesizes[4],
     if ((ret = av_image_fill_linesizes(linesizes, pix_fmt, w)) < 0)
         return ret;
 
-    for (i = 0; i < 4; i++)
+    for (i = 0; i < 4; i++) {
         linesizes[i] = FFALIGN(linesizes[i], align);
+        /* rows a multiple of 4 KiB apart map to the same cache sets,
+         * which makes vertical filters thrash, so pad them */
+        if (linesizes[i] && !(linesizes[i] & 4095))
+            linesizes[i] += FFALIGN(64, align);
+    }
 
     if ((ret = av_image_fill_pointers(pointers, pix_fmt, h, NULL, linesizes)) < 0)
         return ret;
@@ -220,19 +235,56 @@ int av_image_check_size(unsigned int w, unsigned int h, int log_offset, void *lo
     return AVERROR(EINVAL);
 }
 
-void av_image_copy_plane(uint8_t       *dst, int dst_linesize,
-                         const uint8_t *src, int src_linesize,
-                         int bytewidth, int height)
+static void copy_plane(uint8_t       *dst, int dst_linesize,
+                       const uint8_t *src, int src_linesize,
+                       int bytewidth, int height, int stream)
 {
-    if (!dst || !src)
+    if (!dst || !src || height <= 0)
         return;
-    for (;height > 0; height--) {
+    if (dst_linesize == bytewidth && src_linesize == bytewidth) {
+        bytewidth *= height;
+        height     = 1;
+    }
+#if HAVE_SSE2_INTRINSICS
+    if (stream && bytewidth >= 64) {
+        for (; height > 0; height--) {
+            int head = -(intptr_t)dst & 15, x;
+
+            memcpy(dst, src, head);
+            for (x = head; x <= bytewidth - 64; x += 64) {
+                __m128i a = _mm_loadu_si128((const __m128i *)(src + x     ));
+                __m128i b = _mm_loadu_si128((const __m128i *)(src + x + 16));
+                __m128i c = _mm_loadu_si128((const __m128i *)(src + x + 32));
+                __m128i d = _mm_loadu_si128((const __m128i *)(src + x + 48));
+                _mm_stream_si128((__m128i *)(dst + x     ), a);
+                _mm_stream_si128((__m128i *)(dst + x + 16), b);
+                _mm_stream_si128((__m128i *)(dst + x + 32), c);
+                _mm_stream_si128((__m128i *)(dst + x + 48), d);
+            }
+            memcpy(dst + x, src + x, bytewidth - x);
+            dst += dst_linesize;
+            src += src_linesize;
+        }
+        /* order the streaming stores before the stores of the caller */
+        _mm_sfence();
+        return;
+    }
+#endif
+    for (; height > 0; height--) {
         memcpy(dst, src, bytewidth);
         dst += dst_linesize;
         src += src_linesize;
     }
 }
 
+void av_image_copy_plane(uint8_t       *dst, int dst_linesize,
+                         const uint8_t *src, int src_linesize,
+                         int bytewidth, int height)
+{
+    copy_plane(dst, dst_linesize, src, src_linesize, bytewidth, height,
+               (int64_t)bytewidth * height >= STREAM_COPY_MIN);
+}
+
 void av_image_copy(uint8_t *dst_data[4], int dst_linesizes[4],
                    const uint8_t *src_data[4], const int src_linesizes[4],
                    enum PixelFormat pix_fmt, int width, int height)
@@ -249,24 +301,158 @@ void av_image_copy(uint8_t *dst_data[4], int dst_linesizes[4],
         /* copy the palette */
         memcpy(dst_data[1], src_data[1], 4*256);
     } else {
-        int i, planes_nb = 0;
+        int i, planes_nb = 0, bwidth[4], h[4];
+        int64_t size = 0;
 
         for (i = 0; i < desc->nb_components; i++)
             planes_nb = FFMAX(planes_nb, desc->comp[i].plane + 1);
 
         for (i = 0; i < planes_nb; i++) {
-            int h = height;
-            int bwidth = av_image_get_linesize(pix_fmt, width, i);
+            h[i] = height;
+            bwidth[i] = av_image_get_linesize(pix_fmt, width, i);
             if (i == 1 || i == 2) {
-                h= -((-height)>>desc->log2_chroma_h);
+                h[i]= -((-height)>>desc->log2_chroma_h);
             }
-            av_image_copy_plane(dst_data[i], dst_linesizes[i],
-                                src_data[i], src_linesizes[i],
-                                bwidth, h);
+            size += (int64_t)bwidth[i] * h[i];
         }
+        /* decide for the whole image, the planes are as likely to be reused */
+        for (i = 0; i < planes_nb; i++)
+            copy_plane(dst_data[i], dst_linesizes[i],
+                       src_data[i], src_linesizes[i],
+                       bwidth[i], h[i], size >= STREAM_COPY_MIN);
+    }
+}
+
+/* filter parameters: [-1 4 2 4 -1] // 8 */
+static void deinterlace_line(uint8_t *dst,
+                             const uint8_t *lum_m4, const uint8_t *lum_m3,
+                             const uint8_t *lum_m2, const uint8_t *lum_m1,
+                             const uint8_t *lum, uint8_t *save, int size)
+{
+    int x = 0;
+
+#if HAVE_SSE2_INTRINSICS
+    const __m128i zero = _mm_setzero_si128(), four = _mm_set1_epi16(4);
+
+    for (; x <= size - 16; x += 16) {
+        __m128i m4 = _mm_loadu_si128((const __m128i *)(lum_m4 + x));
+        __m128i m3 = _mm_loadu_si128((const __m128i *)(lum_m3 + x));
+        __m128i m2 = _mm_loadu_si128((const __m128i *)(lum_m2 + x));
+        __m128i m1 = _mm_loadu_si128((const __m128i *)(lum_m1 + x));
+        __m128i p0 = _mm_loadu_si128((const __m128i *)(lum    + x));
+        __m128i lo, hi;
+
+#define FILTER(unpack)                                                              \
+        _mm_srai_epi16(_mm_sub_epi16(_mm_add_epi16(                                 \
+            _mm_slli_epi16(_mm_add_epi16(unpack(m3, zero), unpack(m1, zero)), 2),   \
+            _mm_add_epi16(_mm_slli_epi16(unpack(m2, zero), 1), four)),              \
+            _mm_add_epi16(unpack(m4, zero), unpack(p0, zero))), 3)
+        lo = FILTER(_mm_unpacklo_epi8);
+        hi = FILTER(_mm_unpackhi_epi8);
+#undef FILTER
+        if (save)
+            _mm_storeu_si128((__m128i *)(save + x), m2);
+        _mm_storeu_si128((__m128i *)(dst + x), _mm_packus_epi16(lo, hi));
+    }
+#endif
+    for (; x < size; x++) {
+        int sum = -lum_m4[x] + (lum_m3[x] << 2) + (lum_m2[x] << 1) + (lum_m1[x] << 2) - lum[x];
+        if (save)
+            save[x] = lum_m2[x];
+        dst[x] = av_clip_uint8((sum + 4) >> 3);
     }
 }
 
+/* deinterlacing : 2 temporal taps, 3 spatial taps linear filter. The
+   top field is copied as is, but the bottom field is deinterlaced
+   against the top field. */
+static void deinterlace_bottom_field(uint8_t *dst, int dst_wrap,
+                                     const uint8_t *src1, int src_wrap,
+                                     int width, int height)
+{
+    const uint8_t *src_m2, *src_m1, *src_0, *src_p1, *src_p2;
+    int y;
+
+    copy_plane(dst, 2*dst_wrap, src1, 2*src_wrap, width, height >> 1, 0);
+    src_m2 = src1;
+    src_m1 = src1;
+    src_0  = src_m1 + src_wrap;
+    src_p1 = src_0  + src_wrap;
+    src_p2 = src_p1 + src_wrap;
+    dst   += dst_wrap;
+    for (y = 0; y < height - 2; y += 2) {
+        deinterlace_line(dst, src_m2, src_m1, src_0, src_p1, src_p2, NULL, width);
+        src_m2  = src_0;
+        src_m1  = src_p1;
+        src_0   = src_p2;
+        src_p1 += 2*src_wrap;
+        src_p2 += 2*src_wrap;
+        dst    += 2*dst_wrap;
+    }
+    /* do last line */
+    deinterlace_line(dst, src_m2, src_m1, src_0, src_0, src_0, NULL, width);
+}
+
+static int deinterlace_bottom_field_inplace(uint8_t *src1, int src_wrap,
+                                            int width, int height)
+{
+    uint8_t *src_m1, *src_0, *src_p1, *src_p2;
+    int y;
+    /* the previous bottom line, before it was filtered */
+    uint8_t *buf = av_malloc(width);
+
+    if (!buf)
+        return AVERROR(ENOMEM);
+    src_m1 = src1;
+    memcpy(buf, src_m1, width);
+    src_0  = src_m1 + src_wrap;
+    src_p1 = src_0  + src_wrap;
+    src_p2 = src_p1 + src_wrap;
+    for (y = 0; y < height - 2; y += 2) {
+        deinterlace_line(src_0, buf, src_m1, src_0, src_p1, src_p2, buf, width);
+        src_m1  = src_p1;
+        src_0   = src_p2;
+        src_p1 += 2*src_wrap;
+        src_p2 += 2*src_wrap;
+    }
+    /* do last line */
+    deinterlace_line(src_0, buf, src_m1, src_0, src_0, src_0, buf, width);
+    av_free(buf);
+    return 0;
+}
+
+int av_image_deinterlace(uint8_t *dst_data[4], const int dst_linesizes[4],
+                         uint8_t * const src_data[4], const int src_linesizes[4],
+                         enum PixelFormat pix_fmt, int width, int height)
+{
+    const AVPixFmtDescriptor *desc = &av_pix_fmt_descriptors[pix_fmt];
+    int i, ret;
+
+    /* gray formats are flagged as paletted too, only their palette is fixed */
+    if (pix_fmt == PIX_FMT_PAL8 || desc->flags & (PIX_FMT_BITSTREAM | PIX_FMT_HWACCEL))
+        return AVERROR(EINVAL);
+    for (i = 0; i < desc->nb_components; i++)
+        if (desc->comp[i].plane != i || desc->comp[i].step_minus1 ||
+            desc->comp[i].depth_minus1 != 7)
+            return AVERROR(EINVAL);
+    if (height % (2 << desc->log2_chroma_h) || width % (1 << desc->log2_chroma_w))
+        return AVERROR(EINVAL);
+
+    for (i = 0; i < desc->nb_components; i++) {
+        int w = i == 1 || i == 2 ? width  >> desc->log2_chroma_w : width;
+        int h = i == 1 || i == 2 ? height >> desc->log2_chroma_h : height;
+
+        if (dst_data[i] == src_data[i]) {
+            if ((ret = deinterlace_bottom_field_inplace(dst_data[i], dst_linesizes[i], w, h)) < 0)
+                return ret;
+        } else {
+            deinterlace_bottom_field(dst_data[i], dst_linesizes[i],
+                                     src_data[i], src_linesizes[i], w, h);
+        }
+    }
+    return 0;
+}
+
 #if FF_API_OLD_IMAGE_NAMES
 void av_fill_image_max_pixsteps(int max_pixsteps[4], int max_pixstep_comps[4],
                                 const AVPixFmtDescriptor *pixdesc)
@@ -295,3 +481,99 @@ int av_check_image_size(unsigned int w, unsigned int h, int log_offset, void *lo
     return av_image_check_size(w, h, log_offset, log_ctx);
 }
 #endif
+
+#ifdef TEST
+#include <stdio.h>
+#include <time.h>
+#include "lfg.h"
+#undef printf
+#define BENCH_W    3840
+#define BENCH_H    2160
+#define BENCH_RUNS 50
+
+static int ref_filter(const uint8_t *p, int stride, int y, int h)
+{
+    int m2 = FFMAX(y - 2, 0), p1 = FFMIN(y + 1, h - 1), p2 = FFMIN(y + 2, h - 1);
+    int sum = -p[m2*stride] + (p[(y-1)*stride] << 2) + (p[y*stride] << 1)
+              + (p[p1*stride] << 2) - p[p2*stride];
+    return av_clip_uint8((sum + 4) >> 3);
+}
+
+int main(void)
+{
+    static const enum PixelFormat fmts[] = { PIX_FMT_YUV420P, PIX_FMT_YUV422P, PIX_FMT_GRAY8 };
+    uint8_t *src[4], *dst[4], *ref[4];
+    int src_ls[4], dst_ls[4], ref_ls[4];
+    int f, i, x, y, run;
+    AVLFG lfg;
+
+    av_lfg_init(&lfg, 1);
+
+    /* odd widths exercise the C tails, the in place path must match too */
+    for (f = 0; f < FF_ARRAY_ELEMS(fmts); f++) {
+        const AVPixFmtDescriptor *desc = &av_pix_fmt_descriptors[fmts[f]];
+        int w = 166, h = 36;
+
+        if (av_image_alloc(src, src_ls, w, h, fmts[f], 1) < 0 ||
+            av_image_alloc(dst, dst_ls, w, h, fmts[f], 16) < 0 ||
+            av_image_alloc(ref, ref_ls, w, h, fmts[f], 16) < 0)
+            return 1;
+        for (i = 0; i < desc->nb_components; i++)
+            for (y = 0; y < (i ? -(-h >> desc->log2_chroma_h) : h); y++)
+                for (x = 0; x < src_ls[i]; x++)
+                    src[i][y * src_ls[i] + x] = av_lfg_get(&lfg);
+        if (av_image_deinterlace(dst, dst_ls, src, src_ls, fmts[f], w, h) < 0)
+            return 1;
+        av_image_copy(ref, ref_ls, (const uint8_t **)src, src_ls, fmts[f], w, h);
+        if (av_image_deinterlace(ref, ref_ls, ref, ref_ls, fmts[f], w, h) < 0)
+            return 1;
+        for (i = 0; i < desc->nb_components; i++) {
+            int cw = i ? -(-w >> desc->log2_chroma_w) : w;
+            int ch = i ? -(-h >> desc->log2_chroma_h) : h;
+            for (y = 0; y < ch; y++)
+                for (x = 0; x < cw; x++) {
+                    int v = y & 1 ? ref_filter(src[i] + x, src_ls[i], y, ch)
+                                  : src[i][y * src_ls[i] + x];
+                    if (dst[i][y * dst_ls[i] + x] != v || ref[i][y * ref_ls[i] + x] != v) {
+                        printf("%s: deinterlace mismatch in plane %d at %d,%d\n",
+                               desc->name, i, x, y);
+                        return 1;
+                    }
+                }
+        }
+        av_freep(&src[0]);
+        av_freep(&dst[0]);
+        av_freep(&ref[0]);
+    }
+    printf("deinterlace ok\n");
+
+    /* 4K frame copies, line by line with memcpy and with av_image_copy() */
+    if (av_image_alloc(src, src_ls, BENCH_W, BENCH_H, PIX_FMT_YUV420P, 16) < 0 ||
+        av_image_alloc(dst, dst_ls, BENCH_W, BENCH_H, PIX_FMT_YUV420P, 16) < 0)
+        return 1;
+    memset(src[0], 0x80, src_ls[0] * BENCH_H * 3 / 2);
+    for (run = 0; run < 2; run++) {
+        clock_t t = clock();
+        for (i = 0; i < BENCH_RUNS; i++) {
+            if (run) {
+                av_image_copy(dst, dst_ls, (const uint8_t **)src, src_ls,
+                              PIX_FMT_YUV420P, BENCH_W, BENCH_H);
+            } else {
+                int p;
+                for (p = 0; p < 3; p++)
+                    for (y = 0; y < (p ? BENCH_H / 2 : BENCH_H); y++)
+                        memcpy(dst[p] + y * dst_ls[p], src[p] + y * src_ls[p],
+                               p ? BENCH_W / 2 : BENCH_W);
+            }
+        }
+        t = clock() - t;
+        printf("%-13s %6.2f GB/s\n", run ? "av_image_copy" : "memcpy",
+               BENCH_W * BENCH_H * 3 / 2. * BENCH_RUNS * CLOCKS_PER_SEC / FFMAX(t, 1) / 1e9);
+    }
+    if (memcmp(dst[0], src[0], dst_ls[0] * BENCH_H * 3 / 2))
+        return 1;
+    av_freep(&src[0]);
+    av_freep(&dst[0]);
+    return 0;
+}
+#endif
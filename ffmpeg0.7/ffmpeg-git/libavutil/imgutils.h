@@ -82,6 +82,8 @@ FFMPEGLIB_API int av_image_fill_pointers(uint8_t *data[4], enum PixelFormat pix_
  * fill pointers and linesizes accordingly.
  * The allocated image buffer has to be freed by using
  * av_freep(&pointers[0]).
+ * Linesizes which would be a multiple of 4096 are padded, so that
+ * successive lines do not compete for the same cache sets.
  *
  * @param align the value to use for buffer size alignment
  * @return the size in bytes required for the image buffer, a negative
@@ -95,6 +97,8 @@ FFMPEGLIB_API int av_image_alloc(uint8_t *pointers[4], int linesizes[4],
  * That is, copy "height" number of lines of "bytewidth" bytes each.
  * The first byte of each successive line is separated by *_linesize
  * bytes.
+ * Large planes are written with non-temporal stores where available, so
+ * the copy runs at memory bandwidth without evicting the caches.
  *
  * @param dst_linesize linesize for the image plane in dst
  * @param src_linesize linesize for the image plane in src
@@ -113,6 +117,20 @@ FFMPEGLIB_API void av_image_copy(uint8_t *dst_data[4], int dst_linesizes[4],
                    const uint8_t *src_data[4], const int src_linesizes[4],
                    enum PixelFormat pix_fmt, int width, int height);
 
+/**
+ * Deinterlace an image with a [-1 4 2 4 -1] vertical filter: the top
+ * field is copied as is, the bottom field is interpolated from both.
+ * Only formats where each component is in its own plane with 8 bits per
+ * sample are supported.
+ *
+ * @param dst_data may be equal to src_data to deinterlace in place
+ * @param height must be a multiple of twice the vertical chroma subsampling
+ * @return >= 0 on success, a negative error code otherwise
+ */
+FFMPEGLIB_API int av_image_deinterlace(uint8_t *dst_data[4], const int dst_linesizes[4],
+                         uint8_t * const src_data[4], const int src_linesizes[4],
+                         enum PixelFormat pix_fmt, int width, int height);
+
 /**
  * Check if the given dimension of an image is valid, meaning that all
  * bytes of the image can be addressed with a signed int.
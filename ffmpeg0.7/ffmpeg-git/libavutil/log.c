@@ -137,19 +137,36 @@ void av_log_default_callback(void* ptr, int level, const char* fmt, va_list vl)
 
 static void (*av_log_callback)(void*, int, const char*, va_list) = av_log_default_callback;
 
-void av_log(void* avcl, int level, const char *fmt, ...)
+static int log_level_offset(void* avcl, int level)
 {
     AVClass* avc= avcl ? *(AVClass**)avcl : NULL;
-    va_list vl;
-    va_start(vl, fmt);
     if(avc && avc->version >= (50<<16 | 15<<8 | 2) && avc->log_level_offset_offset && level>=AV_LOG_FATAL)
         level += *(int*)(((uint8_t*)avcl) + avc->log_level_offset_offset);
-    av_vlog(avcl, level, fmt, vl);
+    return level;
+}
+
+void av_log(void* avcl, int level, const char *fmt, ...)
+{
+    va_list vl;
+    va_start(vl, fmt);
+    av_vlog(avcl, log_level_offset(avcl, level), fmt, vl);
+    va_end(vl);
+}
+
+void av_log_once(void* avcl, int initial_level, int subsequent_level, int *state, const char *fmt, ...)
+{
+    va_list vl;
+    va_start(vl, fmt);
+    av_vlog(avcl, log_level_offset(avcl, *state ? subsequent_level : initial_level), fmt, vl);
     va_end(vl);
+    *state = 1;
 }
 
 void av_vlog(void* avcl, int level, const char *fmt, va_list vl)
 {
+    /* what the default callback would drop anyway, without calling it */
+    if(level > av_log_level && av_log_callback == av_log_default_callback)
+        return;
     av_log_callback(avcl, level, fmt, vl);
 }
 
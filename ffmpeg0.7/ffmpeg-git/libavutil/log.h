@@ -70,8 +70,20 @@ typedef struct {
      * can be NULL of course
      */
     int parent_log_context_offset;
+
+    /**
+     * A combination of AV_CLASS_FLAG_*.
+     * Only read if version is 50.41.0 or later.
+     */
+    int flags;
 } AVClass;
 
+/**
+ * The class and its options exist until the process exits, so that
+ * av_find_opt() may keep an index of the option names of the class.
+ */
+#define AV_CLASS_FLAG_STATIC 0x0001
+
 /* av_log API */
 
 #define AV_LOG_QUIET    -8
@@ -128,6 +140,24 @@ FFMPEGLIB_API void av_log(void *avcl, int level, const char *fmt, ...) __attribu
 FFMPEGLIB_API void av_log(void *avcl, int level, const char *fmt, ...);
 #endif
 
+/**
+ * Send the specified message to the log once with the initial_level and then
+ * with the subsequent_level, so that a warning repeated for every packet is
+ * only shown the first time at the default level.
+ *
+ * @param state a variable keeping track of whether a message has already been
+ * printed, it must be initialized to 0 before the first use; the same state
+ * must not be accessed by two threads simultaneously
+ * @see av_log
+ */
+#ifdef __GNUC__
+FFMPEGLIB_API void av_log_once(void *avcl, int initial_level, int subsequent_level, int *state,
+                               const char *fmt, ...) __attribute__ ((__format__ (__printf__, 5, 6)));
+#else
+FFMPEGLIB_API void av_log_once(void *avcl, int initial_level, int subsequent_level, int *state,
+                               const char *fmt, ...);
+#endif
+
 FFMPEGLIB_API void av_vlog(void *avcl, int level, const char *fmt, va_list);
 FFMPEGLIB_API int av_log_get_level(void);
 FFMPEGLIB_API void av_log_set_level(int);
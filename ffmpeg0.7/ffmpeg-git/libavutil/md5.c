@@ -31,7 +31,15 @@
  */
 
 #include <string.h>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define HAVE_SSE2_INTRINSICS !HAVE_BIGENDIAN
+#else
+#define HAVE_SSE2_INTRINSICS 0
+#endif
 #include "bswap.h"
+#include "common.h"
+#include "intreadwrite.h"
 #include "md5.h"
 
 typedef struct AVMD5{
@@ -71,20 +79,23 @@ static const uint32_t T[64] = { // T[i]= fabs(sin(i+1)<<32)
     0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391,
 };
 
+/* index of the message word used by step i */
+#define W(i) ((i) < 16 ? (i)&15 : (i) < 32 ? (1+5*(i))&15 : (i) < 48 ? (5+3*(i))&15 : (7*(i))&15)
+
 #define CORE(i, a, b, c, d) \
         t = S[i>>4][i&3];\
-        a += T[i];\
+        a += T[i] + AV_RL32(X + 4*W(i));\
 \
         if(i<32){\
-            if(i<16) a += (d ^ (b&(c^d))) + X[      i &15 ];\
-            else     a += (c ^ (d&(c^b))) + X[ (1+5*i)&15 ];\
+            if(i<16) a += (d ^ (b&(c^d)));\
+            else     a += (c ^ (d&(c^b)));\
         }else{\
-            if(i<48) a += (b^c^d)         + X[ (5+3*i)&15 ];\
-            else     a += (c^(b|~d))      + X[ (  7*i)&15 ];\
+            if(i<48) a += (b^c^d);\
+            else     a += (c^(b|~d));\
         }\
         a = b + (( a << t ) | ( a >> (32 - t) ));
 
-static void body(uint32_t ABCD[4], uint32_t X[16]){
+static void body(uint32_t ABCD[4], const uint8_t *X){
 
     int t;
     int i av_unused;
@@ -93,11 +104,6 @@ static void body(uint32_t ABCD[4], uint32_t X[16]){
     unsigned int c= ABCD[1];
     unsigned int d= ABCD[0];
 
-#if HAVE_BIGENDIAN
-    for(i=0; i<16; i++)
-        X[i]= av_bswap32(X[i]);
-#endif
-
 #if CONFIG_SMALL
     for( i = 0; i < 64; i++ ){
         CORE(i,a,b,c,d)
@@ -115,6 +121,66 @@ CORE4(0) CORE4(16) CORE4(32) CORE4(48)
     ABCD[3] += a;
 }
 
+#if HAVE_SSE2_INTRINSICS
+/* the steps of body() on four independent messages, one per 32-bit lane */
+#define CORE_X4(i, a, b, c, d) \
+        if(i<32){\
+            if(i<16) f = _mm_xor_si128(d, _mm_and_si128(b, _mm_xor_si128(c, d)));\
+            else     f = _mm_xor_si128(c, _mm_and_si128(d, _mm_xor_si128(c, b)));\
+        }else{\
+            if(i<48) f = _mm_xor_si128(_mm_xor_si128(b, c), d);\
+            else     f = _mm_xor_si128(c, _mm_or_si128(b, _mm_xor_si128(d, ones)));\
+        }\
+        a = _mm_add_epi32(a, _mm_add_epi32(f, _mm_add_epi32(X[W(i)], _mm_set1_epi32(T[i]))));\
+        a = _mm_add_epi32(b, _mm_or_si128(_mm_slli_epi32(a, S[i>>4][i&3]),\
+                                          _mm_srli_epi32(a, 32 - S[i>>4][i&3])));
+
+static void body_x4(AVMD5 *ctx[4], const uint8_t *src[4], int blocks){
+    const __m128i ones = _mm_set1_epi32(-1);
+    __m128i a = _mm_set_epi32(ctx[3]->ABCD[3], ctx[2]->ABCD[3], ctx[1]->ABCD[3], ctx[0]->ABCD[3]);
+    __m128i b = _mm_set_epi32(ctx[3]->ABCD[2], ctx[2]->ABCD[2], ctx[1]->ABCD[2], ctx[0]->ABCD[2]);
+    __m128i c = _mm_set_epi32(ctx[3]->ABCD[1], ctx[2]->ABCD[1], ctx[1]->ABCD[1], ctx[0]->ABCD[1]);
+    __m128i d = _mm_set_epi32(ctx[3]->ABCD[0], ctx[2]->ABCD[0], ctx[1]->ABCD[0], ctx[0]->ABCD[0]);
+    uint32_t out[4][4];
+    int i, n;
+
+    for(n=0; n<blocks; n++){
+        __m128i X[16], f, a0 = a, b0 = b, c0 = c, d0 = d;
+
+        /* transpose 4 words of each message into 4 vectors of one word */
+        for(i=0; i<4; i++){
+            __m128i r0 = _mm_loadu_si128((const __m128i*)(src[0] + 64*n + 16*i));
+            __m128i r1 = _mm_loadu_si128((const __m128i*)(src[1] + 64*n + 16*i));
+            __m128i r2 = _mm_loadu_si128((const __m128i*)(src[2] + 64*n + 16*i));
+            __m128i r3 = _mm_loadu_si128((const __m128i*)(src[3] + 64*n + 16*i));
+            __m128i t0 = _mm_unpacklo_epi32(r0, r1), t1 = _mm_unpackhi_epi32(r0, r1);
+            __m128i t2 = _mm_unpacklo_epi32(r2, r3), t3 = _mm_unpackhi_epi32(r2, r3);
+            X[4*i    ] = _mm_unpacklo_epi64(t0, t2);
+            X[4*i + 1] = _mm_unpackhi_epi64(t0, t2);
+            X[4*i + 2] = _mm_unpacklo_epi64(t1, t3);
+            X[4*i + 3] = _mm_unpackhi_epi64(t1, t3);
+        }
+
+#define CORE2_X4(i) CORE_X4(i,a,b,c,d) CORE_X4((i+1),d,a,b,c) CORE_X4((i+2),c,d,a,b) CORE_X4((i+3),b,c,d,a)
+#define CORE4_X4(i) CORE2_X4(i) CORE2_X4((i+4)) CORE2_X4((i+8)) CORE2_X4((i+12))
+CORE4_X4(0) CORE4_X4(16) CORE4_X4(32) CORE4_X4(48)
+
+        a = _mm_add_epi32(a, a0);
+        b = _mm_add_epi32(b, b0);
+        c = _mm_add_epi32(c, c0);
+        d = _mm_add_epi32(d, d0);
+    }
+
+    _mm_storeu_si128((__m128i*)out[0], d);
+    _mm_storeu_si128((__m128i*)out[1], c);
+    _mm_storeu_si128((__m128i*)out[2], b);
+    _mm_storeu_si128((__m128i*)out[3], a);
+    for(n=0; n<4; n++)
+        for(i=0; i<4; i++)
+            ctx[n]->ABCD[i]= out[i][n];
+}
+#endif
+
 int av_getav_md5_size(void)
 {
 	return av_md5_size;
@@ -130,18 +196,60 @@ void av_md5_init(AVMD5 *ctx){
 }
 
 void av_md5_update(AVMD5 *ctx, const uint8_t *src, const int len){
-    int i, j;
+    const uint8_t *end= src + len;
+    int j;
 
     j= ctx->len & 63;
     ctx->len += len;
 
-    for( i = 0; i < len; i++ ){
-        ctx->block[j++] = src[i];
-        if( 64 == j ){
-            body(ctx->ABCD, (uint32_t*) ctx->block);
-            j = 0;
+    if(j){
+        int n= FFMIN(len, 64 - j);
+        memcpy(ctx->block + j, src, n);
+        src += n;
+        if(j + n < 64)
+            return;
+        body(ctx->ABCD, ctx->block);
+    }
+    /* whole blocks are hashed in place */
+    for(; end - src >= 64; src += 64)
+        body(ctx->ABCD, src);
+    memcpy(ctx->block, src, end - src);
+}
+
+void av_md5_update_multi(AVMD5 * const *ctx, const uint8_t * const *src, const int *len, int count){
+    int i= 0;
+#if HAVE_SSE2_INTRINSICS
+    for(; i + 1 < count; i += 4){
+        AVMD5 dummy, *c[4];
+        const uint8_t *p[4];
+        int left[4], l, n= FFMIN(count - i, 4), blocks= INT_MAX;
+
+        for(l=0; l<n; l++){
+            /* complete the buffered partial block first */
+            int head= FFMIN(len[i + l], -ctx[i + l]->len & 63);
+
+            av_md5_update(ctx[i + l], src[i + l], head);
+            c[l]    = ctx[i + l];
+            p[l]    = src[i + l] + head;
+            left[l] = len[i + l] - head;
+            blocks  = FFMIN(blocks, left[l] >> 6);
+        }
+        /* unused lanes hash a copy of the first message into a dummy context */
+        av_md5_init(&dummy);
+        for(; l<4; l++){
+            c[l]= &dummy;
+            p[l]= p[0];
+        }
+        if(blocks > 0)
+            body_x4(c, p, blocks);
+        for(l=0; l<n; l++){
+            c[l]->len += 64 * blocks;
+            av_md5_update(c[l], p[l] + 64 * blocks, left[l] - 64 * blocks);
         }
     }
+#endif
+    for(; i<count; i++)
+        av_md5_update(ctx[i], src[i], len[i]);
 }
 
 void av_md5_final(AVMD5 *ctx, uint8_t *dst){
@@ -169,20 +277,86 @@ void av_md5_sum(uint8_t *dst, const uint8_t *src, const int len){
 #ifdef TEST
 #include <stdio.h>
 #include <inttypes.h>
+#include <time.h>
 #undef printf
-int main(void){
+#define BENCH_SIZE (1 << 20)
+#define BENCH_RUNS 256
+
+static void print_md5(const uint8_t *in, int len){
+    uint8_t md5[16];
     uint64_t md5val;
-    int i;
+
+    av_md5_sum(md5, in, len);
+    memcpy(&md5val, md5, 8);
+    printf("%"PRId64"\n", md5val);
+}
+
+int main(void){
+    int i, j, n;
     uint8_t in[1000];
+    static uint8_t big[4][BENCH_SIZE];
+    uint8_t ref[16], res[16];
+    AVMD5 ctx_buf[5], *ctx[4];
+    const uint8_t *src[4];
+    int len[4];
+    clock_t t;
 
     for(i=0; i<1000; i++) in[i]= i*i;
-    av_md5_sum( (uint8_t*)&md5val, in,  1000); printf("%"PRId64"\n", md5val);
-    av_md5_sum( (uint8_t*)&md5val, in,  63); printf("%"PRId64"\n", md5val);
-    av_md5_sum( (uint8_t*)&md5val, in,  64); printf("%"PRId64"\n", md5val);
-    av_md5_sum( (uint8_t*)&md5val, in,  65); printf("%"PRId64"\n", md5val);
+    print_md5(in, 1000);
+    print_md5(in, 63);
+    print_md5(in, 64);
+    print_md5(in, 65);
     for(i=0; i<1000; i++) in[i]= i % 127;
-    av_md5_sum( (uint8_t*)&md5val, in,  999); printf("%"PRId64"\n", md5val);
+    print_md5(in, 999);
+
+    for(i=0; i<4; i++){
+        ctx[i]= &ctx_buf[i];
+        for(j=0; j<BENCH_SIZE; j++)
+            big[i][j]= j*(i+1) + (j>>9);
+    }
+
+    /* multi-buffer updates of any length and count must match single ones */
+    for(n=1; n<=4; n++){
+        for(i=0; i<n; i++)
+            av_md5_init(ctx[i]);
+        for(j=0; j<50; j++){
+            for(i=0; i<n; i++){
+                src[i]= big[i] + 997*j;
+                len[i]= (j*37 + i*151) % 700;
+            }
+            av_md5_update_multi(ctx, src, len, n);
+        }
+        for(i=0; i<n; i++){
+            AVMD5 *single= &ctx_buf[4];
+            av_md5_final(ctx[i], res);
+            av_md5_init(single);
+            for(j=0; j<50; j++)
+                av_md5_update(single, big[i] + 997*j, (j*37 + i*151) % 700);
+            av_md5_final(single, ref);
+            if(memcmp(res, ref, 16)){
+                printf("multi-buffer md5 mismatch, %d buffers\n", n);
+                return 1;
+            }
+        }
+    }
 
+    av_md5_init(ctx[0]);
+    t= clock();
+    for(j=0; j<BENCH_RUNS; j++)
+        av_md5_update(ctx[0], big[0], BENCH_SIZE);
+    t= clock() - t;
+    printf("1 buffer:  %5.2f GB/s\n", (double)BENCH_SIZE*BENCH_RUNS*CLOCKS_PER_SEC / FFMAX(t, 1) / 1e9);
+
+    for(i=0; i<4; i++){
+        av_md5_init(ctx[i]);
+        src[i]= big[i];
+        len[i]= BENCH_SIZE;
+    }
+    t= clock();
+    for(j=0; j<BENCH_RUNS/4; j++)
+        av_md5_update_multi(ctx, src, len, 4);
+    t= clock() - t;
+    printf("4 buffers: %5.2f GB/s\n", (double)BENCH_SIZE*BENCH_RUNS*CLOCKS_PER_SEC / FFMAX(t, 1) / 1e9);
     return 0;
 }
 #endif
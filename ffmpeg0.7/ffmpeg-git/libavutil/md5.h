@@ -30,6 +30,14 @@ struct AVMD5;
 FFMPEGLIB_API int av_getav_md5_size(void);
 FFMPEGLIB_API void av_md5_init(struct AVMD5 *ctx);
 FFMPEGLIB_API void av_md5_update(struct AVMD5 *ctx, const uint8_t *src, const int len);
+
+/**
+ * Update several MD5 contexts with one buffer each, like calling
+ * av_md5_update(ctx[i], src[i], len[i]) for every i, but hashing the
+ * blocks of up to four messages in parallel where SIMD is available.
+ */
+FFMPEGLIB_API void av_md5_update_multi(struct AVMD5 * const *ctx, const uint8_t * const *src,
+                                       const int *len, int count);
 FFMPEGLIB_API void av_md5_final(struct AVMD5 *ctx, uint8_t *dst);
 FFMPEGLIB_API void av_md5_sum(uint8_t *dst, const uint8_t *src, const int len);
 
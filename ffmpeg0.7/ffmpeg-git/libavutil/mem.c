@@ -33,6 +33,10 @@
 //#include <malloc.h>
 #endif
 
+#if CONFIG_MEM_POOL && HAVE_PTHREADS
+#include <pthread.h>
+#endif
+
 #include "avutil.h"
 #include "mem.h"
 
@@ -77,6 +81,375 @@ int av_mem_checkBy_memwatch(const int logInt)
    memory allocator. You do not need to suppress this file because the
    linker will do it automatically. */
 
+#if CONFIG_MEM_POOL
+
+/*
+ * Every block starts 1 to 16 bytes after the address returned by the system
+ * allocator, and the byte before the block holds that offset. Blocks of the
+ * pool are marked with an offset of 0 instead, see av_mem_pool_enable().
+ */
+#define HEADER_SIZE 16
+
+static void *system_malloc(size_t size)
+{
+    void *ptr = NULL;
+#if CONFIG_MEMALIGN_HACK
+    long diff;
+
+    ptr = malloc(size+HEADER_SIZE);
+
+    if(!ptr)
+        return ptr;
+    diff= ((-(long)ptr - 1)&15) + 1;
+    ptr = (char*)ptr + diff;
+    ((char*)ptr)[-1]= diff;
+#else
+#if HAVE_POSIX_MEMALIGN
+    if (posix_memalign(&ptr,16,size+HEADER_SIZE))
+        ptr = NULL;
+#elif HAVE_MEMALIGN
+    ptr = memalign(16,size+HEADER_SIZE);
+#else
+    ptr = malloc(size+HEADER_SIZE);
+#endif
+    if(!ptr)
+        return ptr;
+    ptr = (char*)ptr + HEADER_SIZE;
+    ((char*)ptr)[-1]= HEADER_SIZE;
+#endif
+    return ptr;
+}
+
+static void system_free(void *ptr)
+{
+    free((char*)ptr - ((char*)ptr)[-1]);
+}
+
+/* size classes: 16 to 128 bytes in steps of 16, then 4 classes per power of 2 */
+#define POOL_NB_CLASSES 40
+#define POOL_MAX_SIZE   32768
+/* bytes of each class a thread keeps before returning blocks to the shared lists */
+#define POOL_THREAD_CACHE 65536
+/* bytes kept in the shared lists, beyond which freed blocks go back to the system */
+#define POOL_MAX_SHARED (16 << 20)
+
+typedef struct PoolCache {
+    struct PoolCache *next;
+    void *free[POOL_NB_CLASSES];
+    int nb_free[POOL_NB_CLASSES];
+    /* the last entries count the allocations too large for the pool */
+    uint64_t nb_allocs[POOL_NB_CLASSES + 1];
+    uint64_t nb_frees[POOL_NB_CLASSES + 1];
+} PoolCache;
+
+static int pool_enabled;
+/* blocks released by the threads, and counts of the threads that have exited */
+static PoolCache shared;
+static size_t shared_bytes;
+/* blocks obtained from the system for each class, now and at most */
+static uint64_t nb_system[POOL_NB_CLASSES];
+static size_t pool_bytes[POOL_NB_CLASSES], peak_bytes[POOL_NB_CLASSES];
+
+static int size_to_class(size_t size)
+{
+    int p;
+
+    if (size <= 128)
+        return size ? (size - 1) >> 4 : 0;
+    p = av_log2(size - 1);
+    return 8 + (p - 7) * 4 + ((size - 1 - (1 << p)) >> (p - 2));
+}
+
+static size_t class_to_size(int c)
+{
+    int p;
+
+    if (c < 8)
+        return (c + 1) << 4;
+    p = 7 + (c - 8) / 4;
+    return (1 << p) + ((c - 8) % 4 + 1) * (1 << (p - 2));
+}
+
+static int cache_limit(int c)
+{
+    return FFMAX(POOL_THREAD_CACHE / class_to_size(c), 4);
+}
+
+#if HAVE_PTHREADS
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t pool_once  = PTHREAD_ONCE_INIT;
+static pthread_key_t pool_key;
+static PoolCache *caches;
+
+#define LOCK()   pthread_mutex_lock(&pool_lock)
+#define UNLOCK() pthread_mutex_unlock(&pool_lock)
+#else
+#define LOCK()
+#define UNLOCK()
+#endif
+
+/**
+ * Move n blocks of class c from the free list of a thread to the shared
+ * list, or back to the system once the shared lists are full or if the
+ * list is the shared one.
+ * Must be called with the pool lock held.
+ */
+static void release_blocks(PoolCache *cache, int c, int n)
+{
+    size_t size = class_to_size(c);
+
+    while (n-- > 0 && cache->free[c]) {
+        void *ptr = cache->free[c];
+        cache->free[c] = *(void **)ptr;
+        cache->nb_free[c]--;
+        if (cache != &shared && shared_bytes + size <= POOL_MAX_SHARED) {
+            *(void **)ptr = shared.free[c];
+            shared.free[c] = ptr;
+            shared.nb_free[c]++;
+            shared_bytes += size;
+        } else {
+            pool_bytes[c] -= size;
+            free((char*)ptr - ((uint8_t*)ptr)[-3]);
+        }
+    }
+}
+
+#if HAVE_PTHREADS
+static void cache_exit(void *opaque)
+{
+    PoolCache *cache = opaque, **p;
+    int c;
+
+    LOCK();
+    for (p = &caches; *p; p = &(*p)->next) {
+        if (*p == cache) {
+            *p = cache->next;
+            break;
+        }
+    }
+    for (c = 0; c < POOL_NB_CLASSES; c++)
+        release_blocks(cache, c, cache->nb_free[c]);
+    for (c = 0; c <= POOL_NB_CLASSES; c++) {
+        shared.nb_allocs[c] += cache->nb_allocs[c];
+        shared.nb_frees[c]  += cache->nb_frees[c];
+    }
+    UNLOCK();
+    system_free(cache);
+}
+
+static void init_key(void)
+{
+    pthread_key_create(&pool_key, cache_exit);
+}
+
+static PoolCache *get_cache(void)
+{
+    PoolCache *cache;
+
+    pthread_once(&pool_once, init_key);
+    cache = pthread_getspecific(pool_key);
+    if (!cache) {
+        /* not from the pool itself, which needs the cache to exist */
+        cache = system_malloc(sizeof(*cache));
+        if (!cache)
+            return NULL;
+        memset(cache, 0, sizeof(*cache));
+        pthread_setspecific(pool_key, cache);
+        LOCK();
+        cache->next = caches;
+        caches = cache;
+        UNLOCK();
+    }
+    return cache;
+}
+#else
+static PoolCache *get_cache(void)
+{
+    return &shared;
+}
+#endif
+
+static void *pool_malloc(size_t size)
+{
+    PoolCache *cache = get_cache();
+    int c = size_to_class(size);
+    uint8_t *ptr, *raw;
+
+    if (!cache)
+        return NULL;
+    cache->nb_allocs[c]++;
+    if (!cache->free[c] && cache != &shared) {
+        /* refill half of the thread cache from the shared list */
+        int n = cache_limit(c) / 2;
+        LOCK();
+        while (n-- && shared.free[c]) {
+            void *block = shared.free[c];
+            shared.free[c] = *(void **)block;
+            shared.nb_free[c]--;
+            shared_bytes -= class_to_size(c);
+            *(void **)block = cache->free[c];
+            cache->free[c] = block;
+            cache->nb_free[c]++;
+        }
+        UNLOCK();
+    }
+    if (cache->free[c]) {
+        ptr = cache->free[c];
+        cache->free[c] = *(void **)ptr;
+        cache->nb_free[c]--;
+        return ptr;
+    }
+
+    size = class_to_size(c);
+    raw  = malloc(size + 2*HEADER_SIZE);
+    if (!raw)
+        return NULL;
+    /* aligned, with the offset to raw in ptr[-3], the class in ptr[-2] */
+    ptr = raw + HEADER_SIZE + ((-(long)raw) & 15);
+    ptr[-3] = ptr - raw;
+    ptr[-2] = c;
+    ptr[-1] = 0;
+    LOCK();
+    nb_system[c]++;
+    pool_bytes[c] += size;
+    peak_bytes[c]  = FFMAX(peak_bytes[c], pool_bytes[c]);
+    UNLOCK();
+    return ptr;
+}
+
+static void pool_free(void *ptr)
+{
+    PoolCache *cache = get_cache();
+    int c = ((uint8_t*)ptr)[-2];
+
+    if (!cache)
+        return;
+    cache->nb_frees[c]++;
+    *(void **)ptr = cache->free[c];
+    cache->free[c] = ptr;
+    cache->nb_free[c]++;
+    if (cache->nb_free[c] > cache_limit(c)) {
+        LOCK();
+        release_blocks(cache, c, cache->nb_free[c] / 2);
+        UNLOCK();
+    }
+}
+
+void av_mem_pool_enable(int enable)
+{
+    pool_enabled = enable;
+}
+
+int av_mem_pool_get_stats(AVMemPoolStats *stats, int max_stats)
+{
+    int c, n = FFMIN(max_stats, POOL_NB_CLASSES + 1);
+#if HAVE_PTHREADS
+    PoolCache *cache;
+#endif
+
+    LOCK();
+    for (c = 0; c < n; c++) {
+        AVMemPoolStats *s = &stats[c];
+        s->nb_allocs = shared.nb_allocs[c];
+        s->nb_frees  = shared.nb_frees[c];
+#if HAVE_PTHREADS
+        for (cache = caches; cache; cache = cache->next) {
+            s->nb_allocs += cache->nb_allocs[c];
+            s->nb_frees  += cache->nb_frees[c];
+        }
+#endif
+        if (c < POOL_NB_CLASSES) {
+            s->size       = class_to_size(c);
+            s->nb_system  = nb_system[c];
+            s->bytes      = pool_bytes[c];
+            s->peak_bytes = peak_bytes[c];
+        } else {
+            s->size       = 0;
+            s->nb_system  = s->nb_allocs;
+            s->bytes      = 0;
+            s->peak_bytes = 0;
+        }
+    }
+    UNLOCK();
+    return n;
+}
+
+void av_mem_pool_dump(void *log_ctx, int level)
+{
+    AVMemPoolStats stats[POOL_NB_CLASSES + 1];
+    int c, n = av_mem_pool_get_stats(stats, FF_ARRAY_ELEMS(stats));
+
+    av_log(log_ctx, level, "%8s %12s %12s %10s %10s %10s\n",
+           "size", "allocs", "frees", "system", "kB", "peak kB");
+    for (c = 0; c < n; c++) {
+        AVMemPoolStats *s = &stats[c];
+        if (!s->nb_allocs)
+            continue;
+        if (s->size)
+            av_log(log_ctx, level, "%8d %12"PRIu64" %12"PRIu64" %10"PRIu64" %10d %10d\n",
+                   (int)s->size, s->nb_allocs, s->nb_frees, s->nb_system,
+                   (int)(s->bytes >> 10), (int)(s->peak_bytes >> 10));
+        else
+            av_log(log_ctx, level, "%8s %12"PRIu64"\n", "larger", s->nb_allocs);
+    }
+}
+
+void *av_malloc(FF_INTERNAL_MEM_TYPE size)
+{
+    /* let's disallow possible ambiguous cases */
+    if(size > (INT_MAX-2*HEADER_SIZE) )
+        return NULL;
+
+    if (pool_enabled) {
+        PoolCache *cache;
+        if (size <= POOL_MAX_SIZE)
+            return pool_malloc(size);
+        if ((cache = get_cache()))
+            cache->nb_allocs[POOL_NB_CLASSES]++;
+    }
+    return system_malloc(size);
+}
+
+void *av_realloc(void *ptr, FF_INTERNAL_MEM_TYPE size)
+{
+    int diff;
+
+    /* let's disallow possible ambiguous cases */
+    if(size > (INT_MAX-2*HEADER_SIZE) )
+        return NULL;
+
+    if(!ptr) return av_malloc(size);
+    diff= ((char*)ptr)[-1];
+    if (!diff) {
+        size_t old_size = class_to_size(((uint8_t*)ptr)[-2]);
+        void *new_ptr;
+
+        if (size <= old_size)
+            return ptr;
+        new_ptr = av_malloc(size);
+        if (!new_ptr)
+            return NULL;
+        memcpy(new_ptr, ptr, old_size);
+        pool_free(ptr);
+        return new_ptr;
+    }
+    //FIXME this isn't aligned correctly, though it probably isn't needed
+    ptr = realloc((char*)ptr - diff, size + diff);
+    return ptr ? (char*)ptr + diff : NULL;
+}
+
+void av_free(void *ptr)
+{
+    if (!ptr)
+        return;
+    if (!((char*)ptr)[-1])
+        pool_free(ptr);
+    else
+        system_free(ptr);
+}
+
+#else /* CONFIG_MEM_POOL */
+
 void *av_malloc(FF_INTERNAL_MEM_TYPE size)
 {
     void *ptr = NULL;
@@ -163,6 +536,21 @@ void av_free(void *ptr)
 #endif
 }
 
+void av_mem_pool_enable(int enable)
+{
+}
+
+int av_mem_pool_get_stats(AVMemPoolStats *stats, int max_stats)
+{
+    return 0;
+}
+
+void av_mem_pool_dump(void *log_ctx, int level)
+{
+}
+
+#endif /* CONFIG_MEM_POOL */
+
 void av_freep(void *arg)
 {
     void **ptr= (void**)arg;
@@ -190,3 +578,90 @@ char *av_strdup(const char *s)
     return ptr;
 }
 
+
+#ifdef TEST
+
+#undef printf
+
+static void *test_thread(void *arg)
+{
+    void *blocks[256] = { 0 };
+    unsigned seed = (intptr_t)arg;
+    int i;
+
+    for (i = 0; i < 200000; i++) {
+        int j = (seed = seed * 1664525 + 1013904223) >> 24;
+        int size = (seed >> 8 & 0xFFFF) % 40000;
+        if (blocks[j]) {
+            av_free(blocks[j]);
+            blocks[j] = NULL;
+        } else {
+            blocks[j] = av_malloc(size);
+            if (!blocks[j] || (intptr_t)blocks[j] & 15)
+                return (void *)1;
+            memset(blocks[j], j, FFMIN(size, 64));
+        }
+    }
+    for (i = 0; i < 256; i++)
+        av_free(blocks[i]);
+    return NULL;
+}
+
+int main(void)
+{
+    AVMemPoolStats stats[64];
+    uint8_t *a, *b;
+    int i, n, ret = 0;
+
+    av_mem_pool_enable(1);
+
+    for (i = 0; i <= POOL_MAX_SIZE; i += i < 300 ? 1 : 97) {
+        int c = size_to_class(i);
+        if (class_to_size(c) < i || (c && class_to_size(c - 1) >= i)) {
+            printf("wrong class %d for size %d\n", c, i);
+            ret = 1;
+        }
+    }
+
+    a = av_malloc(100);
+    for (i = 0; i < 100; i++)
+        a[i] = i;
+    b = av_realloc(a, 5000);
+    for (i = 0; i < 100; i++)
+        if (b[i] != i) {
+            printf("realloc lost data\n");
+            ret = 1;
+            break;
+        }
+    av_free(b);
+
+#if HAVE_PTHREADS
+    {
+        pthread_t threads[4];
+        void *res;
+        for (i = 0; i < 4; i++)
+            pthread_create(&threads[i], NULL, test_thread, (void *)(intptr_t)(i + 1));
+        for (i = 0; i < 4; i++) {
+            pthread_join(threads[i], &res);
+            if (res) {
+                printf("misaligned or failed allocation\n");
+                ret = 1;
+            }
+        }
+    }
+#else
+    ret |= test_thread((void *)1) != NULL;
+#endif
+
+    n = av_mem_pool_get_stats(stats, FF_ARRAY_ELEMS(stats));
+    for (i = 0; i < n - 1; i++)
+        if (stats[i].nb_allocs != stats[i].nb_frees) {
+            printf("class %d: %"PRIu64" allocs, %"PRIu64" frees\n",
+                   (int)stats[i].size, stats[i].nb_allocs, stats[i].nb_frees);
+            ret = 1;
+        }
+    av_mem_pool_dump(NULL, AV_LOG_INFO);
+    return ret;
+}
+
+#endif
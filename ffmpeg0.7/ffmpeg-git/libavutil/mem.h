@@ -128,6 +128,47 @@ FFMPEGLIB_API void *av_mallocz(FF_INTERNAL_MEM_TYPE size) av_malloc_attrib av_al
  */
 FFMPEGLIB_API char *av_strdup(const char *s) av_malloc_attrib;
 
+typedef struct AVMemPoolStats {
+    size_t   size;          ///< block size of the class, 0 for larger allocations
+    uint64_t nb_allocs;
+    uint64_t nb_frees;      ///< not tracked for larger allocations
+    uint64_t nb_system;     ///< blocks obtained from the system allocator
+    size_t   bytes;         ///< memory held by the pool for the class, in use or cached
+    size_t   peak_bytes;
+} AVMemPoolStats;
+
+/**
+ * Enable or disable the pool allocator; disabled by default.
+ *
+ * While enabled, av_malloc() serves blocks of up to 32 kB from size classes.
+ * Freed blocks are kept on a free list of the freeing thread, and moved in
+ * batches to lists shared by all threads, so most allocations take no lock
+ * and do not call the system allocator.
+ *
+ * This can be changed at any time; every block is returned to the allocator
+ * it came from. Without --enable-mem-pool this does nothing, and av_malloc()
+ * always uses the system allocator.
+ */
+FFMPEGLIB_API void av_mem_pool_enable(int enable);
+
+/**
+ * Get the allocation counts of the pool, one entry per size class followed
+ * by one for the allocations too large for the pool.
+ *
+ * @param stats     array to fill
+ * @param max_stats size of stats
+ * @return number of entries written
+ */
+FFMPEGLIB_API int av_mem_pool_get_stats(AVMemPoolStats *stats, int max_stats);
+
+/**
+ * Print the allocation counts of the pool, for the size classes used.
+ *
+ * @param log_ctx context passed to av_log()
+ * @param level   log level of the table
+ */
+FFMPEGLIB_API void av_mem_pool_dump(void *log_ctx, int level);
+
 /**
  * Free a memory block which has been allocated with av_malloc(z)() or
  * av_realloc() and set the pointer pointing to it to NULL.
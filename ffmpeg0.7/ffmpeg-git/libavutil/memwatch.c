@@ -115,6 +115,7 @@
 #include <setjmp.h>
 #include <time.h>
 #include <limits.h>
+#include "config.h"
 #include "memwatch.h"
 
 #ifndef toupper
@@ -126,6 +127,11 @@
 #include <windows.h>
 #endif
 
+/* without the mutex, concurrent av_malloc() calls corrupt the block list */
+#if !defined(WIN32) && !defined(__WIN32__) && !defined(MW_PTHREADS) && HAVE_PTHREADS
+#define MW_PTHREADS
+#endif
+
 #if defined(MW_PTHREADS) || defined(HAVE_PTHREAD_H)
 #define MW_HAVE_MUTEX 1
 #include <pthread.h>
@@ -25,16 +25,136 @@
  * @author Michael Niedermayer <michaelni@gmx.at>
  */
 
+#include <stdlib.h>
 #include "avutil.h"
 #include "avstring.h"
+#include "atomic.h"
 #include "opt.h"
 #include "eval.h"
 
-//FIXME order them and do a bin search
+/* Options are looked up by name per stream and sometimes per packet, in
+ * classes such as AVCodecContext with hundreds of them. Each class marked
+ * with AV_CLASS_FLAG_STATIC gets a hash index of its option names on its
+ * first lookup, kept in a table shared by all threads and freed when the
+ * process exits. Other classes may not outlive their index and are searched
+ * linearly. */
+
+#define OPT_CACHE_SIZE  256     ///< a power of 2
+#define OPT_CACHE_PROBE 16      ///< slots tried before falling back to a linear search
+
+typedef struct OptIndex {
+    const AVClass *class;
+    const AVOption *option;     ///< class->option when the index was built
+    unsigned mask;              ///< number of slots minus 1
+    struct {
+        uint32_t hash;
+        int index;              ///< in option, -1 for an empty slot
+    } slot[1];
+} OptIndex;
+
+static OptIndex * volatile opt_cache[OPT_CACHE_SIZE];
+static volatile uint32_t opt_cache_used;
+
+static void free_opt_cache(void)
+{
+    int i;
+
+    for (i = 0; i < OPT_CACHE_SIZE; i++) {
+        av_free(opt_cache[i]);
+        opt_cache[i] = NULL;
+    }
+}
+
+static uint32_t hash_name(const char *s)
+{
+    uint32_t h = 2166136261U;
+
+    while (*s)
+        h = (h ^ (uint8_t)*s++) * 16777619;
+    return h;
+}
+
+/**
+ * Build the index of the option names of a class, by linear probing so that
+ * the options of the same name are found in the order of the array.
+ */
+static OptIndex *build_index(const AVClass *c)
+{
+    OptIndex *idx;
+    int n = 0, size = 1, i;
+
+    while (c->option[n].name)
+        n++;
+    while (size < 2 * n)
+        size <<= 1;
+    idx = av_malloc(sizeof(*idx) + (size - 1) * sizeof(idx->slot[0]));
+    if (!idx)
+        return NULL;
+    idx->class  = c;
+    idx->option = c->option;
+    idx->mask   = size - 1;
+    for (i = 0; i < size; i++)
+        idx->slot[i].index = -1;
+    for (i = 0; i < n; i++) {
+        uint32_t h = hash_name(c->option[i].name);
+        unsigned j = h & idx->mask;
+
+        while (idx->slot[j].index >= 0)
+            j = (j + 1) & idx->mask;
+        idx->slot[j].hash  = h;
+        idx->slot[j].index = i;
+    }
+    return idx;
+}
+
+static const OptIndex *get_index(const AVClass *c)
+{
+    unsigned h = (uint32_t)((uintptr_t)c * 2654435761U) >> 24, i;
+
+    if (c->version < AV_VERSION_INT(50, 41, 0) || !(c->flags & AV_CLASS_FLAG_STATIC))
+        return NULL;
+    for (i = 0; i < OPT_CACHE_PROBE; i++) {
+        OptIndex * volatile *slot = &opt_cache[(h + i) & (OPT_CACHE_SIZE - 1)];
+        OptIndex *idx = *slot;
+
+        if (!idx) {
+            if (!(idx = build_index(c)))
+                return NULL;
+            if (ff_atomic_cas_ptr((void * volatile *)slot, NULL, idx)) {
+                if (ff_atomic_cas32(&opt_cache_used, 0, 1))
+                    atexit(free_opt_cache);
+                return idx;
+            }
+            /* another thread took the slot first */
+            av_free(idx);
+            idx = *slot;
+        }
+        if (idx->class == c)
+            return idx->option == c->option ? idx : NULL;
+    }
+    return NULL;
+}
+
 const AVOption *av_find_opt(void *v, const char *name, const char *unit, int mask, int flags)
 {
     AVClass *c= *(AVClass**)v; //FIXME silly way of storing AVClass
     const AVOption *o= c->option;
+    const OptIndex *idx;
+
+    if (!o)
+        return NULL;
+    if ((idx = get_index(c))) {
+        uint32_t h = hash_name(name);
+        unsigned j;
+
+        for (j = h & idx->mask; idx->slot[j].index >= 0; j = (j + 1) & idx->mask) {
+            o = idx->option + idx->slot[j].index;
+            if (idx->slot[j].hash == h && !strcmp(o->name, name) &&
+                (!unit || (o->unit && !strcmp(o->unit, unit))) && (o->flags & mask) == flags)
+                return o;
+        }
+        return NULL;
+    }
 
     for (; o && o->name; o++) {
         if (!strcmp(o->name, name) && (!unit || (o->unit && !strcmp(o->unit, unit))) && (o->flags & mask) == flags)
@@ -517,7 +637,10 @@ int av_set_options_string(void *ctx, const char *opts,
 
 #ifdef TEST
 
+#include <time.h>
 #undef printf
+#define BENCH_OPTIONS 256
+#define BENCH_RUNS    2000
 
 typedef struct TestContext
 {
@@ -558,6 +681,16 @@ static const AVClass test_class = {
     test_options
 };
 
+static const AVOption *find_opt_linear(const AVOption *o, const char *name, const char *unit,
+                                       int mask, int flags)
+{
+    for (; o->name; o++)
+        if (!strcmp(o->name, name) && (!unit || (o->unit && !strcmp(o->unit, unit))) &&
+            (o->flags & mask) == flags)
+            return o;
+    return NULL;
+}
+
 int main(void)
 {
     int i;
@@ -601,6 +734,55 @@ int main(void)
         }
     }
 
+    printf("\nTesting av_find_opt()\n");
+    {
+        /* a class as large as AVCodecContext, with constants of the same
+         * name in several units */
+        static char names[BENCH_OPTIONS][16], units[4][8];
+        static AVOption opts[BENCH_OPTIONS + 1];
+        static const AVClass big_class = {
+            "BigContext", test_get_name, opts, LIBAVUTIL_VERSION_INT,
+            .flags = AV_CLASS_FLAG_STATIC,
+        };
+        const AVClass *big_ctx = &big_class;
+        static const AVOption *found[2][BENCH_OPTIONS];
+        clock_t t[2];
+        int n, run;
+
+        for (i = 0; i < 4; i++)
+            snprintf(units[i], sizeof(units[i]), "unit%d", i);
+        for (i = 0; i < BENCH_OPTIONS; i++) {
+            snprintf(names[i], sizeof(names[i]), i & 1 ? "opt%d" : "const%d", i & 1 ? i : i / 8);
+            opts[i].name  = names[i];
+            opts[i].type  = i & 1 ? FF_OPT_TYPE_INT : FF_OPT_TYPE_CONST;
+            opts[i].unit  = i & 1 ? NULL : units[i & 3];
+            opts[i].flags = i & 2;
+        }
+
+        /* the index must find the first match of the array, as the linear
+         * search does; time both */
+        for (run = 0; run < 2; run++) {
+            t[run] = clock();
+            for (n = 0; n < BENCH_RUNS; n++)
+                for (i = 0; i < BENCH_OPTIONS; i++)
+                    found[run][i] = run ? av_find_opt(&big_ctx, names[i], opts[i].unit, 2, i & 2) :
+                                          find_opt_linear(opts, names[i], opts[i].unit, 2, i & 2);
+            t[run] = clock() - t[run];
+        }
+        for (i = 0; i < BENCH_OPTIONS; i++)
+            if (found[1][i] != found[0][i] || !found[0][i]) {
+                printf("av_find_opt(%s) mismatch\n", names[i]);
+                return 1;
+            }
+        if (av_find_opt(&big_ctx, "unknown", NULL, 0, 0) ||
+            av_find_opt(&big_ctx, "opt1", "unit1", 0, 0)) {
+            printf("av_find_opt() found a missing option\n");
+            return 1;
+        }
+        printf("%d lookups: linear %.1f ms, indexed %.1f ms\n", BENCH_OPTIONS * BENCH_RUNS,
+               t[0] * 1000.0 / CLOCKS_PER_SEC, t[1] * 1000.0 / CLOCKS_PER_SEC);
+    }
+
     return 0;
 }
 
@@ -149,6 +149,8 @@ typedef struct AVOption2 {
  * @param[in] unit the unit of the option to look for, or any if NULL
  * @return a pointer to the option found, or NULL if no option
  * has been found
+ * @note the options of a class are indexed on its first lookup, so the
+ * AVClass and its option array must not change afterwards
  */
 FFMPEGLIB_API const AVOption *av_find_opt(void *obj, const char *name, const char *unit, int mask, int flags);
 
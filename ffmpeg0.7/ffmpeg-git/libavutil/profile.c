@@ -0,0 +1,319 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Lightweight profiling of named code sections
+ */
+
+#include <string.h>
+#include <time.h>
+#include "config.h"
+#if defined(_WIN32)
+#include <windows.h>
+#elif !defined(CLOCK_MONOTONIC)
+#include <sys/time.h>
+#endif
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#include <intrin.h>
+#endif
+#if HAVE_PTHREADS
+#include <pthread.h>
+#endif
+#include "avstring.h"
+#include "common.h"
+#include "log.h"
+#include "mem.h"
+#include "profile.h"
+
+typedef struct ProfileThread {
+    struct ProfileThread *next;
+    AVProfileStats stats[AV_PROFILE_MAX_SCOPES];
+} ProfileThread;
+
+static int profile_enabled;
+static char *scope_names[AV_PROFILE_MAX_SCOPES];
+static int nb_scopes;
+/* counts of the running threads, and of the threads that have exited */
+static ProfileThread *threads;
+static ProfileThread exited;
+
+static void add_stats(AVProfileStats *dst, const AVProfileStats *src, int n)
+{
+    int i, j;
+
+    for (i = 0; i < n; i++) {
+        dst[i].count  += src[i].count;
+        dst[i].cycles += src[i].cycles;
+        dst[i].ns     += src[i].ns;
+        dst[i].max_ns  = FFMAX(dst[i].max_ns, src[i].max_ns);
+        for (j = 0; j < AV_PROFILE_HIST_BUCKETS; j++)
+            dst[i].histogram[j] += src[i].histogram[j];
+    }
+}
+
+#if HAVE_PTHREADS
+static pthread_mutex_t profile_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t profile_once  = PTHREAD_ONCE_INIT;
+static pthread_key_t profile_key;
+
+#define LOCK()   pthread_mutex_lock(&profile_lock)
+#define UNLOCK() pthread_mutex_unlock(&profile_lock)
+
+static void thread_exit(void *opaque)
+{
+    ProfileThread *t = opaque, **p;
+
+    LOCK();
+    for (p = &threads; *p; p = &(*p)->next) {
+        if (*p == t) {
+            *p = t->next;
+            break;
+        }
+    }
+    add_stats(exited.stats, t->stats, nb_scopes);
+    UNLOCK();
+    av_free(t);
+}
+
+static void init_key(void)
+{
+    pthread_key_create(&profile_key, thread_exit);
+}
+
+static ProfileThread *get_thread(void)
+{
+    ProfileThread *t;
+
+    pthread_once(&profile_once, init_key);
+    t = pthread_getspecific(profile_key);
+    if (!t) {
+        t = av_mallocz(sizeof(*t));
+        if (!t)
+            return NULL;
+        pthread_setspecific(profile_key, t);
+        LOCK();
+        t->next = threads;
+        threads = t;
+        UNLOCK();
+    }
+    return t;
+}
+#else
+#define LOCK()
+#define UNLOCK()
+
+static ProfileThread *get_thread(void)
+{
+    return &exited;
+}
+#endif
+
+static int64_t profile_ns(void)
+{
+#if defined(_WIN32)
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER t;
+    if (!freq.QuadPart)
+        QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&t);
+    return t.QuadPart / freq.QuadPart * 1000000000 +
+           t.QuadPart % freq.QuadPart * 1000000000 / freq.QuadPart;
+#elif defined(CLOCK_MONOTONIC)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#else
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec * 1000000000 + tv.tv_usec * 1000;
+#endif
+}
+
+static uint64_t profile_cycles(void)
+{
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+    return __rdtsc();
+#elif defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+    uint32_t lo, hi;
+    __asm__ volatile ("rdtsc" : "=a"(lo), "=d"(hi));
+    return (uint64_t)hi << 32 | lo;
+#else
+    return 0;
+#endif
+}
+
+void av_profile_enable(int enable)
+{
+    profile_enabled = enable;
+}
+
+int av_profile_register(const char *name)
+{
+    int i;
+
+    LOCK();
+    for (i = 0; i < nb_scopes; i++)
+        if (!strcmp(scope_names[i], name))
+            break;
+    if (i == nb_scopes) {
+        if (nb_scopes == AV_PROFILE_MAX_SCOPES ||
+            !(scope_names[i] = av_strdup(name)))
+            i = -1;
+        else
+            nb_scopes++;
+    }
+    UNLOCK();
+    return i;
+}
+
+void av_profile_begin(AVProfileTimer *t)
+{
+    if (!profile_enabled) {
+        t->ns = -1;
+        return;
+    }
+    t->cycles = profile_cycles();
+    t->ns     = profile_ns();
+}
+
+void av_profile_end(int scope, const AVProfileTimer *t)
+{
+    ProfileThread *thread;
+    AVProfileStats *s;
+    uint64_t ns, cycles;
+
+    if (t->ns < 0 || scope < 0)
+        return;
+    ns     = profile_ns() - t->ns;
+    cycles = profile_cycles() - t->cycles;
+    if (!(thread = get_thread()))
+        return;
+
+    s = &thread->stats[scope];
+    s->count++;
+    s->cycles += cycles;
+    s->ns     += ns;
+    if (ns > s->max_ns)
+        s->max_ns = ns;
+    s->histogram[ns >> 32 ? AV_PROFILE_HIST_BUCKETS - 1 : av_log2(ns)]++;
+}
+
+int av_profile_get_stats(AVProfileStats *stats, int max_stats)
+{
+    ProfileThread *t;
+    int i, n;
+
+    LOCK();
+    n = FFMIN(nb_scopes, max_stats);
+    memcpy(stats, exited.stats, n * sizeof(*stats));
+    for (t = threads; t; t = t->next)
+        add_stats(stats, t->stats, n);
+    for (i = 0; i < n; i++)
+        stats[i].name = scope_names[i];
+    UNLOCK();
+    return n;
+}
+
+void av_profile_reset(void)
+{
+    ProfileThread *t;
+
+    LOCK();
+    memset(exited.stats, 0, sizeof(exited.stats));
+    for (t = threads; t; t = t->next)
+        memset(t->stats, 0, sizeof(t->stats));
+    UNLOCK();
+}
+
+void av_profile_dump(void *log_ctx, int level)
+{
+    AVProfileStats *stats = av_malloc(AV_PROFILE_MAX_SCOPES * sizeof(*stats));
+    int i, j, n;
+
+    if (!stats)
+        return;
+    n = av_profile_get_stats(stats, AV_PROFILE_MAX_SCOPES);
+    av_log(log_ctx, level, "%-24s %10s %12s %10s %10s %12s\n",
+           "section", "runs", "total ms", "avg us", "max us", "avg cycles");
+    for (i = 0; i < n; i++) {
+        AVProfileStats *s = &stats[i];
+        int median = 0;
+        uint64_t sum = 0;
+
+        if (!s->count)
+            continue;
+        for (j = 0; j < AV_PROFILE_HIST_BUCKETS; j++) {
+            sum += s->histogram[j];
+            if (2 * sum >= s->count) {
+                median = j;
+                break;
+            }
+        }
+        av_log(log_ctx, level, "%-24s %10"PRIu64" %12.3f %10.3f %10.3f %12"PRIu64" median<%dus\n",
+               s->name, s->count, s->ns / 1000000.0, s->ns / 1000.0 / s->count,
+               s->max_ns / 1000.0, s->cycles / s->count,
+               (int)FFMAX((2LL << median) / 1000, 1));
+    }
+    av_free(stats);
+}
+
+#ifdef TEST
+
+#undef printf
+
+int main(void)
+{
+    AVProfileStats stats[2];
+    AVProfileTimer t;
+    int a, b, i, n;
+
+    a = av_profile_register("a");
+    b = av_profile_register("b");
+    if (a != 0 || b != 1 || av_profile_register("a") != a) {
+        printf("registration failed\n");
+        return 1;
+    }
+
+    av_profile_begin(&t);
+    av_profile_end(a, &t);
+
+    av_profile_enable(1);
+    for (i = 0; i < 100; i++) {
+        av_profile_begin(&t);
+        av_profile_end(i & 1 ? b : a, &t);
+    }
+
+    n = av_profile_get_stats(stats, 2);
+    if (n != 2 || stats[0].count != 50 || stats[1].count != 50 ||
+        strcmp(stats[0].name, "a") || strcmp(stats[1].name, "b")) {
+        printf("wrong counts\n");
+        return 1;
+    }
+    av_profile_dump(NULL, AV_LOG_INFO);
+
+    av_profile_reset();
+    av_profile_get_stats(stats, 2);
+    if (stats[0].count || stats[1].count) {
+        printf("reset failed\n");
+        return 1;
+    }
+    return 0;
+}
+
+#endif
@@ -0,0 +1,116 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Lightweight profiling of named code sections
+ *
+ * A section is registered once by name and then timed with
+ * av_profile_begin()/av_profile_end(). Every thread accumulates its own
+ * counts, so timing does not take any lock. While profiling is disabled
+ * the timing functions only test a flag.
+ *
+ * @code
+ * static int scope = -1;
+ * AVProfileTimer t;
+ *
+ * if (scope < 0)
+ *     scope = av_profile_register("decode");
+ * av_profile_begin(&t);
+ * ...
+ * av_profile_end(scope, &t);
+ * @endcode
+ */
+
+#ifndef AVUTIL_PROFILE_H
+#define AVUTIL_PROFILE_H
+
+#include <stdint.h>
+#include "libavutil/attributes.h"
+
+#define AV_PROFILE_MAX_SCOPES   256
+#define AV_PROFILE_HIST_BUCKETS 32
+
+typedef struct AVProfileTimer {
+    int64_t  ns;        ///< start time, negative if profiling was disabled
+    uint64_t cycles;
+} AVProfileTimer;
+
+typedef struct AVProfileStats {
+    const char *name;
+    uint64_t count;     ///< number of timed runs
+    uint64_t cycles;    ///< total CPU cycles, 0 if no cycle counter is available
+    uint64_t ns;        ///< total time in nanoseconds
+    uint64_t max_ns;    ///< longest run in nanoseconds
+    /** histogram[i] counts the runs that took [2^i, 2^(i+1)) nanoseconds */
+    uint64_t histogram[AV_PROFILE_HIST_BUCKETS];
+} AVProfileStats;
+
+/**
+ * Enable or disable the timing of all sections; disabled by default.
+ */
+FFMPEGLIB_API void av_profile_enable(int enable);
+
+/**
+ * Register a section, or look up a section already registered with
+ * the same name.
+ *
+ * @param name name of the section, copied
+ * @return index of the section, or a negative value if the table is full
+ */
+FFMPEGLIB_API int av_profile_register(const char *name);
+
+/**
+ * Start timing a run of a section.
+ */
+FFMPEGLIB_API void av_profile_begin(AVProfileTimer *t);
+
+/**
+ * Stop timing a run and add it to the counts of the calling thread.
+ *
+ * @param scope index returned by av_profile_register(), ignored if negative
+ * @param t     timer started by av_profile_begin()
+ */
+FFMPEGLIB_API void av_profile_end(int scope, const AVProfileTimer *t);
+
+/**
+ * Sum the counts of all threads.
+ *
+ * Counts of threads that are still running are read without
+ * synchronization, so they may lag behind by a few runs.
+ *
+ * @param stats     array filled with one entry per registered section
+ * @param max_stats size of stats
+ * @return number of entries written
+ */
+FFMPEGLIB_API int av_profile_get_stats(AVProfileStats *stats, int max_stats);
+
+/**
+ * Clear the counts of all threads; registered sections are kept.
+ */
+FFMPEGLIB_API void av_profile_reset(void);
+
+/**
+ * Print a table of the counts of all sections that ran at least once.
+ *
+ * @param log_ctx context passed to av_log()
+ * @param level   log level of the table
+ */
+FFMPEGLIB_API void av_profile_dump(void *log_ctx, int level);
+
+#endif /* AVUTIL_PROFILE_H */
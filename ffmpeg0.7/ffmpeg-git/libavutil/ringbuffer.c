@@ -0,0 +1,265 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * thread-safe ring buffer of variable-size records
+ *
+ * Positions are byte counts since the allocation, wrapping at 2^32.
+ * Producers claim space by advancing wpos, with a compare-and-swap if
+ * there are several of them, and publish it by advancing committed in
+ * claim order. The consumer reads up to committed and releases space by
+ * advancing rpos. A record that would cross the end of the ring is
+ * preceded by a padding record filling the ring up to its end.
+ */
+
+#include "config.h"
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sched.h>
+#endif
+#include "atomic.h"
+#include "common.h"
+#include "error.h"
+#include "mem.h"
+#include "ringbuffer.h"
+
+#define RECORD_PAD 1
+
+typedef struct RingHeader {
+    uint32_t size;
+    uint32_t flags;
+    uint32_t start;     ///< claimed position, including the padding record
+    uint32_t end;       ///< position after the record
+} RingHeader;
+
+struct AVRingBuffer {
+    uint8_t *buffer;
+    uint32_t size;
+    int flags;
+    /* written by the producers and by the consumer, on separate cache lines */
+    uint8_t pad0[64];
+    volatile uint32_t wpos;
+    volatile uint32_t committed;
+    uint8_t pad1[64];
+    volatile uint32_t rpos;
+};
+
+static uint32_t load_acquire(volatile uint32_t *p)
+{
+    uint32_t v = *p;
+    ff_memory_barrier();
+    return v;
+}
+
+static void store_release(volatile uint32_t *p, uint32_t v)
+{
+    ff_memory_barrier();
+    *p = v;
+}
+
+static void yield(void)
+{
+#if defined(_WIN32)
+    Sleep(0);
+#else
+    sched_yield();
+#endif
+}
+
+AVRingBuffer *av_ring_alloc(unsigned int size, int flags)
+{
+    AVRingBuffer *r;
+
+    if (size < 2 * sizeof(RingHeader) || size > 1U << 30)
+        return NULL;
+    r = av_mallocz(sizeof(*r));
+    if (!r)
+        return NULL;
+    r->size   = 1 << av_log2(2 * size - 1);
+    r->flags  = flags;
+    r->buffer = av_malloc(r->size);
+    if (!r->buffer)
+        av_freep(&r);
+    return r;
+}
+
+void av_ring_freep(AVRingBuffer **r)
+{
+    if (*r)
+        av_free((*r)->buffer);
+    av_freep(r);
+}
+
+void *av_ring_reserve(AVRingBuffer *r, unsigned int size)
+{
+    uint32_t total = sizeof(RingHeader) + FFALIGN(size, 16);
+    uint32_t w, off, pad;
+    RingHeader *hdr;
+
+    if (size > r->size / 2 || total > r->size / 2)
+        return NULL;
+    for (;;) {
+        w   = r->wpos;
+        off = w & (r->size - 1);
+        pad = off + total > r->size ? r->size - off : 0;
+        if (w + pad + total - load_acquire(&r->rpos) > r->size)
+            return NULL;
+        if (!(r->flags & AV_RING_MULTI_PRODUCER)) {
+            r->wpos = w + pad + total;
+            break;
+        }
+        if (ff_atomic_cas32(&r->wpos, w, w + pad + total))
+            break;
+    }
+
+    if (pad) {
+        hdr = (RingHeader *)(r->buffer + off);
+        hdr->size  = pad;
+        hdr->flags = RECORD_PAD;
+    }
+    hdr = (RingHeader *)(r->buffer + ((w + pad) & (r->size - 1)));
+    hdr->size  = size;
+    hdr->flags = 0;
+    hdr->start = w;
+    hdr->end   = w + pad + total;
+    return hdr + 1;
+}
+
+void av_ring_commit(AVRingBuffer *r, void *data)
+{
+    RingHeader *hdr = (RingHeader *)data - 1;
+
+    /* publish in claim order, after the records reserved before this one */
+    if (r->flags & AV_RING_MULTI_PRODUCER)
+        while (load_acquire(&r->committed) != hdr->start)
+            yield();
+    store_release(&r->committed, hdr->end);
+}
+
+int av_ring_peek(AVRingBuffer *r, void **data)
+{
+    for (;;) {
+        uint32_t rd = r->rpos;
+        RingHeader *hdr;
+
+        if (rd == load_acquire(&r->committed))
+            return AVERROR(EAGAIN);
+        hdr = (RingHeader *)(r->buffer + (rd & (r->size - 1)));
+        if (hdr->flags & RECORD_PAD) {
+            store_release(&r->rpos, rd + hdr->size);
+            continue;
+        }
+        *data = hdr + 1;
+        return hdr->size;
+    }
+}
+
+void av_ring_advance(AVRingBuffer *r)
+{
+    RingHeader *hdr = (RingHeader *)(r->buffer + (r->rpos & (r->size - 1)));
+
+    store_release(&r->rpos, r->rpos + sizeof(*hdr) + FFALIGN(hdr->size, 16));
+}
+
+#ifdef TEST
+
+#include <pthread.h>
+
+#undef printf
+
+#define NB_PRODUCERS 3
+#define NB_RECORDS   100000
+
+typedef struct TestRecord {
+    int producer;
+    int seq;
+} TestRecord;
+
+static AVRingBuffer *ring;
+
+static void *producer(void *arg)
+{
+    int id = (intptr_t)arg, i;
+
+    for (i = 0; i < NB_RECORDS; i++) {
+        int size = sizeof(TestRecord) + (i * 7 + id) % 200;
+        TestRecord *rec;
+
+        while (!(rec = av_ring_reserve(ring, size)))
+            yield();
+        if ((intptr_t)rec & 15)
+            return (void *)1;
+        rec->producer = id;
+        rec->seq      = i;
+        av_ring_commit(ring, rec);
+    }
+    return NULL;
+}
+
+static int run(int nb_producers, int flags)
+{
+    pthread_t threads[NB_PRODUCERS];
+    int next_seq[NB_PRODUCERS] = { 0 };
+    int i, n = 0, ret = 0;
+    void *res;
+
+    ring = av_ring_alloc(4096, flags);
+    for (i = 0; i < nb_producers; i++)
+        pthread_create(&threads[i], NULL, producer, (void *)(intptr_t)i);
+
+    while (n < nb_producers * NB_RECORDS) {
+        TestRecord *rec;
+        int size = av_ring_peek(ring, (void **)&rec);
+
+        if (size == AVERROR(EAGAIN)) {
+            yield();
+            continue;
+        }
+        if (size != sizeof(*rec) + (rec->seq * 7 + rec->producer) % 200 ||
+            rec->seq != next_seq[rec->producer]) {
+            printf("record %d of producer %d out of order or corrupted\n",
+                   rec->seq, rec->producer);
+            return 1;
+        }
+        next_seq[rec->producer]++;
+        av_ring_advance(ring);
+        n++;
+    }
+
+    for (i = 0; i < nb_producers; i++) {
+        pthread_join(threads[i], &res);
+        if (res) {
+            printf("misaligned record\n");
+            ret = 1;
+        }
+    }
+    av_ring_freep(&ring);
+    return ret;
+}
+
+int main(void)
+{
+    if (run(1, 0) || run(NB_PRODUCERS, AV_RING_MULTI_PRODUCER))
+        return 1;
+    printf("ok\n");
+    return 0;
+}
+
+#endif
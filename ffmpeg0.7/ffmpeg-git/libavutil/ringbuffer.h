@@ -0,0 +1,88 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * thread-safe ring buffer of variable-size records
+ *
+ * Unlike AVFifoBuffer, producers and the consumer may run in different
+ * threads without a lock. A producer reserves space for a record, fills it
+ * in place and commits it; the consumer peeks at the oldest committed record,
+ * processes it in place and advances past it. Records are contiguous in
+ * memory and their data is 16-byte aligned.
+ *
+ * There may be only one consumer. Without AV_RING_MULTI_PRODUCER there may
+ * also be only one producer.
+ */
+
+#ifndef AVUTIL_RINGBUFFER_H
+#define AVUTIL_RINGBUFFER_H
+
+#include <stdint.h>
+#include "libavutil/attributes.h"
+
+typedef struct AVRingBuffer AVRingBuffer;
+
+/**
+ * Allow several threads to reserve and commit records concurrently.
+ * Records become readable in the order they were reserved, so committing a
+ * record waits until the records reserved before it are committed.
+ */
+#define AV_RING_MULTI_PRODUCER 1
+
+/**
+ * Allocate a ring buffer.
+ * @param size  size of the ring in bytes, rounded up to a power of 2; each
+ *              record takes 16 bytes plus its size rounded up to 16, and a
+ *              record may take at most half of the ring
+ * @param flags AV_RING_* flags
+ * @return the ring buffer, or NULL on failure
+ */
+FFMPEGLIB_API AVRingBuffer *av_ring_alloc(unsigned int size, int flags);
+
+/**
+ * Free a ring buffer and set the pointer to NULL.
+ */
+FFMPEGLIB_API void av_ring_freep(AVRingBuffer **r);
+
+/**
+ * Reserve space for a record.
+ * @param size size of the record in bytes
+ * @return pointer to write the record to, or NULL if the ring is full
+ */
+FFMPEGLIB_API void *av_ring_reserve(AVRingBuffer *r, unsigned int size);
+
+/**
+ * Make a record returned by av_ring_reserve() readable by the consumer.
+ */
+FFMPEGLIB_API void av_ring_commit(AVRingBuffer *r, void *data);
+
+/**
+ * Get the oldest committed record, without removing it.
+ * @param data set to the data of the record
+ * @return size of the record, or AVERROR(EAGAIN) if the ring is empty
+ */
+FFMPEGLIB_API int av_ring_peek(AVRingBuffer *r, void **data);
+
+/**
+ * Remove the record returned by av_ring_peek(), releasing its space to
+ * the producers.
+ */
+FFMPEGLIB_API void av_ring_advance(AVRingBuffer *r);
+
+#endif /* AVUTIL_RINGBUFFER_H */
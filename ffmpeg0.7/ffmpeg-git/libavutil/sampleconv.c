@@ -0,0 +1,944 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * sample format, packing and channel layout conversion
+ *
+ * Without remixing, a conversion is a single kernel call over the whole
+ * buffer when the packings match, and a kernel call plus an interleave or
+ * deinterleave per block otherwise. With remixing, blocks of samples go
+ * through planar float: input to float, matrix, float to output.
+ */
+
+#include <string.h>
+#include "config.h"
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define HAVE_SSE2_INTRINSICS 1
+#else
+#define HAVE_SSE2_INTRINSICS 0
+#endif
+#include "audioconvert.h"
+#include "common.h"
+#include "cpu.h"
+#include "error.h"
+#include "libm.h"
+#include "mathematics.h"
+#include "mem.h"
+#include "sampleconv.h"
+
+/** samples per channel converted at a time through the temporary buffers */
+#define BLOCK_SIZE 256
+
+typedef void (*ConvFunc)(uint8_t *dst, const uint8_t *src, int len);
+typedef void (*InterleaveFunc)(uint8_t *dst, const uint8_t * const *src,
+                               int channels, int len);
+typedef void (*DeinterleaveFunc)(uint8_t * const *dst, const uint8_t *src,
+                                 int channels, int len);
+typedef void (*MixFunc)(float *dst, const float *src, float coeff, int len);
+
+struct AVSampleConv {
+    int in_channels, out_channels;
+    int in_bps, out_bps;
+    int planar;
+    int same_fmt;
+    float *matrix;              ///< NULL if the channels are not remixed
+
+    ConvFunc conv;              ///< input to output format
+    ConvFunc to_flt, from_flt;  ///< input to float and float to output, when remixing
+    InterleaveFunc   interleave_out, interleave_flt;
+    DeinterleaveFunc deinterleave_in, deinterleave_out, deinterleave_flt;
+    MixFunc mix;
+
+    uint8_t *tmp[3];
+};
+
+/* sample format conversions, with the expressions of av_audio_convert() */
+
+#define CONV_FUNC(ofmt, otype, ifmt, itype, expr)                           \
+static void conv_ ## ifmt ## _to_ ## ofmt(uint8_t *dst, const uint8_t *src, \
+                                          int len)                          \
+{                                                                           \
+    const itype *pi = (const itype *)src;                                   \
+    otype *po = (otype *)dst;                                               \
+    int i;                                                                  \
+    for (i = 0; i < len; i++)                                               \
+        po[i] = expr;                                                       \
+}
+
+CONV_FUNC(s16, int16_t, u8 , uint8_t, (pi[i] - 0x80)<<8)
+CONV_FUNC(s32, int32_t, u8 , uint8_t, (pi[i] - 0x80)<<24)
+CONV_FUNC(flt, float  , u8 , uint8_t, (pi[i] - 0x80)*(1.0 / (1<<7)))
+CONV_FUNC(dbl, double , u8 , uint8_t, (pi[i] - 0x80)*(1.0 / (1<<7)))
+CONV_FUNC(u8 , uint8_t, s16, int16_t, (pi[i]>>8) + 0x80)
+CONV_FUNC(s32, int32_t, s16, int16_t,  pi[i]<<16)
+CONV_FUNC(flt, float  , s16, int16_t,  pi[i]*(1.0 / (1<<15)))
+CONV_FUNC(dbl, double , s16, int16_t,  pi[i]*(1.0 / (1<<15)))
+CONV_FUNC(u8 , uint8_t, s32, int32_t, (pi[i]>>24) + 0x80)
+CONV_FUNC(s16, int16_t, s32, int32_t,  pi[i]>>16)
+CONV_FUNC(flt, float  , s32, int32_t,  pi[i]*(1.0 / (1U<<31)))
+CONV_FUNC(dbl, double , s32, int32_t,  pi[i]*(1.0 / (1U<<31)))
+CONV_FUNC(u8 , uint8_t, flt, float  , av_clip_uint8(  lrintf(pi[i] * (1<<7)) + 0x80))
+CONV_FUNC(s16, int16_t, flt, float  , av_clip_int16(  lrintf(pi[i] * (1<<15))))
+CONV_FUNC(s32, int32_t, flt, float  , av_clipl_int32(llrintf(pi[i] * (1U<<31))))
+CONV_FUNC(dbl, double , flt, float  ,  pi[i])
+CONV_FUNC(u8 , uint8_t, dbl, double , av_clip_uint8(  lrint(pi[i] * (1<<7)) + 0x80))
+CONV_FUNC(s16, int16_t, dbl, double , av_clip_int16(  lrint(pi[i] * (1<<15))))
+CONV_FUNC(s32, int32_t, dbl, double , av_clipl_int32(llrint(pi[i] * (1U<<31))))
+CONV_FUNC(flt, float  , dbl, double ,  pi[i])
+
+#define COPY_FUNC(fmt, bps)                                                 \
+static void conv_ ## fmt ## _to_ ## fmt(uint8_t *dst, const uint8_t *src,   \
+                                        int len)                            \
+{                                                                           \
+    memcpy(dst, src, len * bps);                                            \
+}
+
+COPY_FUNC(u8 , 1)
+COPY_FUNC(s16, 2)
+COPY_FUNC(s32, 4)
+COPY_FUNC(flt, 4)
+COPY_FUNC(dbl, 8)
+
+#define CONV_ROW(ofmt) {                                                    \
+    conv_u8_to_ ## ofmt,  conv_s16_to_ ## ofmt, conv_s32_to_ ## ofmt,       \
+    conv_flt_to_ ## ofmt, conv_dbl_to_ ## ofmt }
+
+/** C kernels, indexed by output and input format */
+static const ConvFunc conv_c[AV_SAMPLE_FMT_NB][AV_SAMPLE_FMT_NB] = {
+    CONV_ROW(u8), CONV_ROW(s16), CONV_ROW(s32), CONV_ROW(flt), CONV_ROW(dbl),
+};
+
+/* (de)interleaving, by bytes per sample */
+
+#define INTERLEAVE_FUNCS(bits)                                              \
+static void interleave_ ## bits(uint8_t *dst, const uint8_t * const *src,   \
+                                int channels, int len)                      \
+{                                                                           \
+    uint ## bits ## _t *po = (uint ## bits ## _t *)dst;                     \
+    int ch, i;                                                              \
+    if (channels == 2) {                                                    \
+        const uint ## bits ## _t *l = (const uint ## bits ## _t *)src[0];   \
+        const uint ## bits ## _t *r = (const uint ## bits ## _t *)src[1];   \
+        for (i = 0; i < len; i++) {                                         \
+            po[2*i    ] = l[i];                                             \
+            po[2*i + 1] = r[i];                                             \
+        }                                                                   \
+        return;                                                             \
+    }                                                                       \
+    for (ch = 0; ch < channels; ch++) {                                     \
+        const uint ## bits ## _t *pi = (const uint ## bits ## _t *)src[ch]; \
+        for (i = 0; i < len; i++)                                           \
+            po[i*channels + ch] = pi[i];                                    \
+    }                                                                       \
+}                                                                           \
+                                                                            \
+static void deinterleave_ ## bits(uint8_t * const *dst, const uint8_t *src, \
+                                  int channels, int len)                    \
+{                                                                           \
+    const uint ## bits ## _t *pi = (const uint ## bits ## _t *)src;         \
+    int ch, i;                                                              \
+    if (channels == 2) {                                                    \
+        uint ## bits ## _t *l = (uint ## bits ## _t *)dst[0];               \
+        uint ## bits ## _t *r = (uint ## bits ## _t *)dst[1];               \
+        for (i = 0; i < len; i++) {                                         \
+            l[i] = pi[2*i    ];                                             \
+            r[i] = pi[2*i + 1];                                             \
+        }                                                                   \
+        return;                                                             \
+    }                                                                       \
+    for (ch = 0; ch < channels; ch++) {                                     \
+        uint ## bits ## _t *po = (uint ## bits ## _t *)dst[ch];             \
+        for (i = 0; i < len; i++)                                           \
+            po[i] = pi[i*channels + ch];                                    \
+    }                                                                       \
+}
+
+INTERLEAVE_FUNCS(8)
+INTERLEAVE_FUNCS(16)
+INTERLEAVE_FUNCS(32)
+INTERLEAVE_FUNCS(64)
+
+static const InterleaveFunc   interleave_c[9]   = {
+    [1] = interleave_8,   [2] = interleave_16,   [4] = interleave_32,   [8] = interleave_64 };
+static const DeinterleaveFunc deinterleave_c[9] = {
+    [1] = deinterleave_8, [2] = deinterleave_16, [4] = deinterleave_32, [8] = deinterleave_64 };
+
+static void mix_c(float *dst, const float *src, float coeff, int len)
+{
+    int i;
+    for (i = 0; i < len; i++)
+        dst[i] += src[i] * coeff;
+}
+
+#if HAVE_SSE2_INTRINSICS
+/* SSE2 kernels: 8 samples per iteration, the rest in C */
+
+#define LOADU(p)     _mm_loadu_si128((const __m128i *)(p))
+#define STOREU(p, v) _mm_storeu_si128((__m128i *)(p), v)
+
+static void conv_s16_to_flt_sse2(uint8_t *dst, const uint8_t *src, int len)
+{
+    const int16_t *pi = (const int16_t *)src;
+    float *po = (float *)dst;
+    const __m128 scale = _mm_set1_ps(1.0 / (1<<15));
+    int i;
+
+    for (i = 0; i + 8 <= len; i += 8) {
+        __m128i v  = LOADU(pi + i);
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+        _mm_storeu_ps(po + i,     _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+        _mm_storeu_ps(po + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+    }
+    conv_s16_to_flt(dst + 4*i, src + 2*i, len - i);
+}
+
+/**
+ * Round to the nearest integer like lrintf() of libm.h, halves away from
+ * zero, for values in the int32_t range.
+ */
+static av_always_inline __m128i round_ps(__m128 x)
+{
+    __m128i t = _mm_cvttps_epi32(x);
+    __m128  d = _mm_sub_ps(x, _mm_cvtepi32_ps(t));
+    t = _mm_sub_epi32(t, _mm_castps_si128(_mm_cmpge_ps(d, _mm_set1_ps( 0.5f))));
+    return _mm_add_epi32(t, _mm_castps_si128(_mm_cmple_ps(d, _mm_set1_ps(-0.5f))));
+}
+
+static void conv_flt_to_s16_sse2(uint8_t *dst, const uint8_t *src, int len)
+{
+    const float *pi = (const float *)src;
+    int16_t *po = (int16_t *)dst;
+    const __m128 scale = _mm_set1_ps(1<<15);
+    int i;
+
+    for (i = 0; i + 8 <= len; i += 8) {
+        __m128i lo = round_ps(_mm_mul_ps(_mm_loadu_ps(pi + i    ), scale));
+        __m128i hi = round_ps(_mm_mul_ps(_mm_loadu_ps(pi + i + 4), scale));
+        STOREU(po + i, _mm_packs_epi32(lo, hi));
+    }
+    conv_flt_to_s16(dst + 2*i, src + 4*i, len - i);
+}
+
+static void conv_s32_to_flt_sse2(uint8_t *dst, const uint8_t *src, int len)
+{
+    const int32_t *pi = (const int32_t *)src;
+    float *po = (float *)dst;
+    const __m128 scale = _mm_set1_ps(1.0 / (1U<<31));
+    int i;
+
+    for (i = 0; i + 8 <= len; i += 8) {
+        _mm_storeu_ps(po + i,     _mm_mul_ps(_mm_cvtepi32_ps(LOADU(pi + i    )), scale));
+        _mm_storeu_ps(po + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(LOADU(pi + i + 4)), scale));
+    }
+    conv_s32_to_flt(dst + 4*i, src + 4*i, len - i);
+}
+
+static void conv_flt_to_s32_sse2(uint8_t *dst, const uint8_t *src, int len)
+{
+    const float *pi = (const float *)src;
+    int32_t *po = (int32_t *)dst;
+    const __m128 scale = _mm_set1_ps(1U<<31);
+    int i, j;
+
+    for (i = 0; i + 8 <= len; i += 8) {
+        for (j = 0; j < 8; j += 4) {
+            __m128  f = _mm_mul_ps(_mm_loadu_ps(pi + i + j), scale);
+            /* cvtps returns INT32_MIN on overflow, flip it to INT32_MAX above 2^31 */
+            __m128i o = _mm_castps_si128(_mm_cmpge_ps(f, scale));
+            STOREU(po + i + j, _mm_xor_si128(_mm_cvtps_epi32(f), o));
+        }
+    }
+    conv_flt_to_s32(dst + 4*i, src + 4*i, len - i);
+}
+
+static void conv_s16_to_s32_sse2(uint8_t *dst, const uint8_t *src, int len)
+{
+    const int16_t *pi = (const int16_t *)src;
+    int32_t *po = (int32_t *)dst;
+    int i;
+
+    for (i = 0; i + 8 <= len; i += 8) {
+        __m128i v = LOADU(pi + i);
+        STOREU(po + i,     _mm_unpacklo_epi16(_mm_setzero_si128(), v));
+        STOREU(po + i + 4, _mm_unpackhi_epi16(_mm_setzero_si128(), v));
+    }
+    conv_s16_to_s32(dst + 4*i, src + 2*i, len - i);
+}
+
+static void conv_s32_to_s16_sse2(uint8_t *dst, const uint8_t *src, int len)
+{
+    const int32_t *pi = (const int32_t *)src;
+    int16_t *po = (int16_t *)dst;
+    int i;
+
+    for (i = 0; i + 8 <= len; i += 8) {
+        __m128i lo = _mm_srai_epi32(LOADU(pi + i    ), 16);
+        __m128i hi = _mm_srai_epi32(LOADU(pi + i + 4), 16);
+        STOREU(po + i, _mm_packs_epi32(lo, hi));
+    }
+    conv_s32_to_s16(dst + 2*i, src + 4*i, len - i);
+}
+
+static void conv_flt_to_dbl_sse2(uint8_t *dst, const uint8_t *src, int len)
+{
+    const float *pi = (const float *)src;
+    double *po = (double *)dst;
+    int i;
+
+    for (i = 0; i + 4 <= len; i += 4) {
+        __m128 f = _mm_loadu_ps(pi + i);
+        _mm_storeu_pd(po + i,     _mm_cvtps_pd(f));
+        _mm_storeu_pd(po + i + 2, _mm_cvtps_pd(_mm_movehl_ps(f, f)));
+    }
+    conv_flt_to_dbl(dst + 8*i, src + 4*i, len - i);
+}
+
+static void conv_dbl_to_flt_sse2(uint8_t *dst, const uint8_t *src, int len)
+{
+    const double *pi = (const double *)src;
+    float *po = (float *)dst;
+    int i;
+
+    for (i = 0; i + 4 <= len; i += 4) {
+        __m128 lo = _mm_cvtpd_ps(_mm_loadu_pd(pi + i    ));
+        __m128 hi = _mm_cvtpd_ps(_mm_loadu_pd(pi + i + 2));
+        _mm_storeu_ps(po + i, _mm_movelh_ps(lo, hi));
+    }
+    conv_dbl_to_flt(dst + 4*i, src + 8*i, len - i);
+}
+
+static void conv_s16_to_dbl_sse2(uint8_t *dst, const uint8_t *src, int len)
+{
+    const int16_t *pi = (const int16_t *)src;
+    double *po = (double *)dst;
+    const __m128d scale = _mm_set1_pd(1.0 / (1<<15));
+    int i;
+
+    for (i = 0; i + 8 <= len; i += 8) {
+        __m128i v  = LOADU(pi + i);
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+        _mm_storeu_pd(po + i,     _mm_mul_pd(_mm_cvtepi32_pd(lo), scale));
+        _mm_storeu_pd(po + i + 2, _mm_mul_pd(_mm_cvtepi32_pd(_mm_srli_si128(lo, 8)), scale));
+        _mm_storeu_pd(po + i + 4, _mm_mul_pd(_mm_cvtepi32_pd(hi), scale));
+        _mm_storeu_pd(po + i + 6, _mm_mul_pd(_mm_cvtepi32_pd(_mm_srli_si128(hi, 8)), scale));
+    }
+    conv_s16_to_dbl(dst + 8*i, src + 2*i, len - i);
+}
+
+static void conv_s32_to_dbl_sse2(uint8_t *dst, const uint8_t *src, int len)
+{
+    const int32_t *pi = (const int32_t *)src;
+    double *po = (double *)dst;
+    const __m128d scale = _mm_set1_pd(1.0 / (1U<<31));
+    int i;
+
+    for (i = 0; i + 4 <= len; i += 4) {
+        __m128i v = LOADU(pi + i);
+        _mm_storeu_pd(po + i,     _mm_mul_pd(_mm_cvtepi32_pd(v), scale));
+        _mm_storeu_pd(po + i + 2, _mm_mul_pd(_mm_cvtepi32_pd(_mm_srli_si128(v, 8)), scale));
+    }
+    conv_s32_to_dbl(dst + 8*i, src + 4*i, len - i);
+}
+
+/**
+ * Convert 4 doubles to int32_t, rounding like lrint() and llrint(), after
+ * clipping them to [min, max] as the C code clips the result.
+ */
+static av_always_inline __m128i clip_round_pd(const double *p, __m128d scale,
+                                              __m128d min, __m128d max)
+{
+    __m128d lo = _mm_mul_pd(_mm_loadu_pd(p    ), scale);
+    __m128d hi = _mm_mul_pd(_mm_loadu_pd(p + 2), scale);
+    lo = _mm_min_pd(_mm_max_pd(lo, min), max);
+    hi = _mm_min_pd(_mm_max_pd(hi, min), max);
+    return _mm_unpacklo_epi64(_mm_cvtpd_epi32(lo), _mm_cvtpd_epi32(hi));
+}
+
+static void conv_dbl_to_s16_sse2(uint8_t *dst, const uint8_t *src, int len)
+{
+    const double *pi = (const double *)src;
+    int16_t *po = (int16_t *)dst;
+    const __m128d scale = _mm_set1_pd(1<<15);
+    const __m128d min   = _mm_set1_pd(INT16_MIN);
+    const __m128d max   = _mm_set1_pd(INT16_MAX);
+    int i;
+
+    for (i = 0; i + 8 <= len; i += 8) {
+        __m128i lo = clip_round_pd(pi + i,     scale, min, max);
+        __m128i hi = clip_round_pd(pi + i + 4, scale, min, max);
+        STOREU(po + i, _mm_packs_epi32(lo, hi));
+    }
+    conv_dbl_to_s16(dst + 2*i, src + 8*i, len - i);
+}
+
+static void conv_dbl_to_s32_sse2(uint8_t *dst, const uint8_t *src, int len)
+{
+    const double *pi = (const double *)src;
+    int32_t *po = (int32_t *)dst;
+    const __m128d scale = _mm_set1_pd(1U<<31);
+    const __m128d min   = _mm_set1_pd(INT32_MIN);
+    const __m128d max   = _mm_set1_pd(INT32_MAX);
+    int i;
+
+    for (i = 0; i + 4 <= len; i += 4)
+        STOREU(po + i, clip_round_pd(pi + i, scale, min, max));
+    conv_dbl_to_s32(dst + 4*i, src + 8*i, len - i);
+}
+
+static void interleave_16_sse2(uint8_t *dst, const uint8_t * const *src,
+                               int channels, int len)
+{
+    const int16_t *l = (const int16_t *)src[0], *r = (const int16_t *)src[1];
+    int16_t *po = (int16_t *)dst;
+    int i;
+
+    if (channels != 2) {
+        interleave_16(dst, src, channels, len);
+        return;
+    }
+    for (i = 0; i + 8 <= len; i += 8) {
+        __m128i a = LOADU(l + i), b = LOADU(r + i);
+        STOREU(po + 2*i,     _mm_unpacklo_epi16(a, b));
+        STOREU(po + 2*i + 8, _mm_unpackhi_epi16(a, b));
+    }
+    for (; i < len; i++) {
+        po[2*i    ] = l[i];
+        po[2*i + 1] = r[i];
+    }
+}
+
+static void deinterleave_16_sse2(uint8_t * const *dst, const uint8_t *src,
+                                 int channels, int len)
+{
+    const int16_t *pi = (const int16_t *)src;
+    int16_t *l = (int16_t *)dst[0], *r = (int16_t *)dst[1];
+    int i;
+
+    if (channels != 2) {
+        deinterleave_16(dst, src, channels, len);
+        return;
+    }
+    for (i = 0; i + 8 <= len; i += 8) {
+        __m128i a = LOADU(pi + 2*i), b = LOADU(pi + 2*i + 8);
+        STOREU(l + i, _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(a, 16), 16),
+                                      _mm_srai_epi32(_mm_slli_epi32(b, 16), 16)));
+        STOREU(r + i, _mm_packs_epi32(_mm_srai_epi32(a, 16), _mm_srai_epi32(b, 16)));
+    }
+    for (; i < len; i++) {
+        l[i] = pi[2*i    ];
+        r[i] = pi[2*i + 1];
+    }
+}
+
+static void interleave_32_sse2(uint8_t *dst, const uint8_t * const *src,
+                               int channels, int len)
+{
+    const int32_t *l = (const int32_t *)src[0], *r = (const int32_t *)src[1];
+    int32_t *po = (int32_t *)dst;
+    int i;
+
+    if (channels != 2) {
+        interleave_32(dst, src, channels, len);
+        return;
+    }
+    for (i = 0; i + 4 <= len; i += 4) {
+        __m128i a = LOADU(l + i), b = LOADU(r + i);
+        STOREU(po + 2*i,     _mm_unpacklo_epi32(a, b));
+        STOREU(po + 2*i + 4, _mm_unpackhi_epi32(a, b));
+    }
+    for (; i < len; i++) {
+        po[2*i    ] = l[i];
+        po[2*i + 1] = r[i];
+    }
+}
+
+static void deinterleave_32_sse2(uint8_t * const *dst, const uint8_t *src,
+                                 int channels, int len)
+{
+    const float *pi = (const float *)src;
+    float *l = (float *)dst[0], *r = (float *)dst[1];
+    int i;
+
+    if (channels != 2) {
+        deinterleave_32(dst, src, channels, len);
+        return;
+    }
+    for (i = 0; i + 4 <= len; i += 4) {
+        __m128 a = _mm_loadu_ps(pi + 2*i), b = _mm_loadu_ps(pi + 2*i + 4);
+        _mm_storeu_ps(l + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+        _mm_storeu_ps(r + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+    }
+    for (; i < len; i++) {
+        l[i] = pi[2*i    ];
+        r[i] = pi[2*i + 1];
+    }
+}
+
+static void mix_sse2(float *dst, const float *src, float coeff, int len)
+{
+    const __m128 c = _mm_set1_ps(coeff);
+    int i;
+
+    for (i = 0; i + 4 <= len; i += 4)
+        _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i),
+                                          _mm_mul_ps(_mm_loadu_ps(src + i), c)));
+    mix_c(dst + i, src + i, coeff, len - i);
+}
+
+#undef LOADU
+#undef STOREU
+#endif /* HAVE_SSE2_INTRINSICS */
+
+static ConvFunc get_conv(enum AVSampleFormat out_fmt, enum AVSampleFormat in_fmt,
+                         int cpu_flags)
+{
+#if HAVE_SSE2_INTRINSICS
+    if (cpu_flags & AV_CPU_FLAG_SSE2) {
+#define PAIR(o, i) (AV_SAMPLE_FMT_ ## o * AV_SAMPLE_FMT_NB + AV_SAMPLE_FMT_ ## i)
+        switch (out_fmt * AV_SAMPLE_FMT_NB + in_fmt) {
+        case PAIR(FLT, S16): return conv_s16_to_flt_sse2;
+        case PAIR(S16, FLT): return conv_flt_to_s16_sse2;
+        case PAIR(FLT, S32): return conv_s32_to_flt_sse2;
+        case PAIR(S32, FLT): return conv_flt_to_s32_sse2;
+        case PAIR(S32, S16): return conv_s16_to_s32_sse2;
+        case PAIR(S16, S32): return conv_s32_to_s16_sse2;
+        case PAIR(DBL, FLT): return conv_flt_to_dbl_sse2;
+        case PAIR(FLT, DBL): return conv_dbl_to_flt_sse2;
+        case PAIR(DBL, S16): return conv_s16_to_dbl_sse2;
+        case PAIR(S16, DBL): return conv_dbl_to_s16_sse2;
+        case PAIR(DBL, S32): return conv_s32_to_dbl_sse2;
+        case PAIR(S32, DBL): return conv_dbl_to_s32_sse2;
+        }
+#undef PAIR
+    }
+#endif
+    return conv_c[out_fmt][in_fmt];
+}
+
+static InterleaveFunc get_interleave(int bps, int cpu_flags)
+{
+#if HAVE_SSE2_INTRINSICS
+    if (cpu_flags & AV_CPU_FLAG_SSE2) {
+        if (bps == 2) return interleave_16_sse2;
+        if (bps == 4) return interleave_32_sse2;
+    }
+#endif
+    return interleave_c[bps];
+}
+
+static DeinterleaveFunc get_deinterleave(int bps, int cpu_flags)
+{
+#if HAVE_SSE2_INTRINSICS
+    if (cpu_flags & AV_CPU_FLAG_SSE2) {
+        if (bps == 2) return deinterleave_16_sse2;
+        if (bps == 4) return deinterleave_32_sse2;
+    }
+#endif
+    return deinterleave_c[bps];
+}
+
+/* default mixing matrix */
+
+static int channel_index(int64_t layout, int64_t ch)
+{
+    return layout & ch ? av_get_channel_layout_nb_channels(layout & (ch - 1)) : -1;
+}
+
+/**
+ * Add input channel in to output channel ch of matrix with weight w.
+ * @return 1 if the output layout has ch, 0 otherwise
+ */
+static int mix_to(float *matrix, int nb_in, int64_t out_layout, int in,
+                  int64_t ch, float w)
+{
+    int out = channel_index(out_layout, ch);
+
+    if (out < 0)
+        return 0;
+    matrix[out * nb_in + in] += w;
+    return 1;
+}
+
+static void default_matrix(float *m, int64_t out_layout, int64_t in_layout)
+{
+    int nb_in = av_get_channel_layout_nb_channels(in_layout);
+    int i, in = 0;
+
+    for (i = 0; i < 64; i++) {
+        int64_t ch = 1ULL << i;
+        int64_t l, r;
+
+        if (!(in_layout & ch))
+            continue;
+        if (mix_to(m, nb_in, out_layout, in, ch, 1)) {
+            in++;
+            continue;
+        }
+        switch (ch) {
+        case AV_CH_FRONT_LEFT:
+        case AV_CH_FRONT_LEFT_OF_CENTER:
+            if (!mix_to(m, nb_in, out_layout, in, AV_CH_FRONT_LEFT, 1))
+                mix_to(m, nb_in, out_layout, in, AV_CH_FRONT_CENTER, 0.5);
+            break;
+        case AV_CH_FRONT_RIGHT:
+        case AV_CH_FRONT_RIGHT_OF_CENTER:
+            if (!mix_to(m, nb_in, out_layout, in, AV_CH_FRONT_RIGHT, 1))
+                mix_to(m, nb_in, out_layout, in, AV_CH_FRONT_CENTER, 0.5);
+            break;
+        case AV_CH_FRONT_CENTER:
+            if ((out_layout & AV_CH_LAYOUT_STEREO) == AV_CH_LAYOUT_STEREO) {
+                float w = in_layout & AV_CH_LAYOUT_STEREO ? M_SQRT1_2 : 1;
+                mix_to(m, nb_in, out_layout, in, AV_CH_FRONT_LEFT,  w);
+                mix_to(m, nb_in, out_layout, in, AV_CH_FRONT_RIGHT, w);
+            }
+            break;
+        case AV_CH_BACK_LEFT:
+        case AV_CH_SIDE_LEFT:
+            l = ch == AV_CH_BACK_LEFT ? AV_CH_SIDE_LEFT : AV_CH_BACK_LEFT;
+            if (!mix_to(m, nb_in, out_layout, in, l, 1) &&
+                !mix_to(m, nb_in, out_layout, in, AV_CH_FRONT_LEFT, M_SQRT1_2))
+                mix_to(m, nb_in, out_layout, in, AV_CH_FRONT_CENTER, 0.5);
+            break;
+        case AV_CH_BACK_RIGHT:
+        case AV_CH_SIDE_RIGHT:
+            r = ch == AV_CH_BACK_RIGHT ? AV_CH_SIDE_RIGHT : AV_CH_BACK_RIGHT;
+            if (!mix_to(m, nb_in, out_layout, in, r, 1) &&
+                !mix_to(m, nb_in, out_layout, in, AV_CH_FRONT_RIGHT, M_SQRT1_2))
+                mix_to(m, nb_in, out_layout, in, AV_CH_FRONT_CENTER, 0.5);
+            break;
+        case AV_CH_BACK_CENTER:
+            if (channel_index(out_layout, AV_CH_BACK_LEFT) >= 0) {
+                l = AV_CH_BACK_LEFT;
+                r = AV_CH_BACK_RIGHT;
+            } else {
+                l = AV_CH_SIDE_LEFT;
+                r = AV_CH_SIDE_RIGHT;
+            }
+            if (!(mix_to(m, nb_in, out_layout, in, l, M_SQRT1_2) |
+                  mix_to(m, nb_in, out_layout, in, r, M_SQRT1_2)) &&
+                !(mix_to(m, nb_in, out_layout, in, AV_CH_FRONT_LEFT,  0.5) |
+                  mix_to(m, nb_in, out_layout, in, AV_CH_FRONT_RIGHT, 0.5)))
+                mix_to(m, nb_in, out_layout, in, AV_CH_FRONT_CENTER, M_SQRT1_2);
+            break;
+        }
+        /* the low frequency and the other channels are dropped */
+        in++;
+    }
+}
+
+AVSampleConv *av_sample_conv_alloc(enum AVSampleFormat out_fmt, int64_t out_layout,
+                                   enum AVSampleFormat in_fmt,  int64_t in_layout,
+                                   int planar, const float *matrix, int cpu_flags)
+{
+    AVSampleConv *s;
+    int i, max_channels;
+
+    if ((unsigned)out_fmt >= AV_SAMPLE_FMT_NB || (unsigned)in_fmt >= AV_SAMPLE_FMT_NB ||
+        !out_layout || !in_layout)
+        return NULL;
+    if (!(s = av_mallocz(sizeof(*s))))
+        return NULL;
+    if (!(cpu_flags & AV_CPU_FLAG_FORCE)) {
+        cpu_flags |= av_get_cpu_flags();
+        /* the intrinsics are only compiled for targets where SSE2 is baseline */
+        if (HAVE_SSE2_INTRINSICS)
+            cpu_flags |= AV_CPU_FLAG_SSE2;
+    }
+
+    s->in_channels  = av_get_channel_layout_nb_channels(in_layout);
+    s->out_channels = av_get_channel_layout_nb_channels(out_layout);
+    s->in_bps       = av_get_bits_per_sample_fmt(in_fmt)  >> 3;
+    s->out_bps      = av_get_bits_per_sample_fmt(out_fmt) >> 3;
+    s->planar       = planar;
+    s->same_fmt     = in_fmt == out_fmt;
+    s->conv         = get_conv(out_fmt, in_fmt, cpu_flags);
+    s->interleave_out   = get_interleave(s->out_bps, cpu_flags);
+    s->deinterleave_in  = get_deinterleave(s->in_bps,  cpu_flags);
+    s->deinterleave_out = get_deinterleave(s->out_bps, cpu_flags);
+
+    if (matrix || in_layout != out_layout) {
+        s->matrix = av_mallocz(s->in_channels * s->out_channels * sizeof(*s->matrix));
+        if (!s->matrix)
+            goto fail;
+        if (matrix)
+            memcpy(s->matrix, matrix, s->in_channels * s->out_channels * sizeof(*s->matrix));
+        else
+            default_matrix(s->matrix, out_layout, in_layout);
+        s->to_flt           = get_conv(AV_SAMPLE_FMT_FLT, in_fmt, cpu_flags);
+        s->from_flt         = get_conv(out_fmt, AV_SAMPLE_FMT_FLT, cpu_flags);
+        s->interleave_flt   = get_interleave(4, cpu_flags);
+        s->deinterleave_flt = get_deinterleave(4, cpu_flags);
+        s->mix              = mix_c;
+#if HAVE_SSE2_INTRINSICS
+        if (cpu_flags & AV_CPU_FLAG_SSE2)
+            s->mix = mix_sse2;
+#endif
+    }
+
+    max_channels = FFMAX(s->in_channels, s->out_channels);
+    for (i = 0; i < 3; i++)
+        if (!(s->tmp[i] = av_malloc(BLOCK_SIZE * max_channels * sizeof(double))))
+            goto fail;
+    return s;
+fail:
+    av_sample_conv_freep(&s);
+    return NULL;
+}
+
+void av_sample_conv_freep(AVSampleConv **s)
+{
+    int i;
+
+    if (!*s)
+        return;
+    for (i = 0; i < 3; i++)
+        av_free((*s)->tmp[i]);
+    av_free((*s)->matrix);
+    av_freep(s);
+}
+
+/**
+ * Convert len samples per channel starting at sample offset, through the
+ * float planes of the temporary buffers.
+ */
+static void remix_block(AVSampleConv *s, uint8_t * const *out,
+                        const uint8_t * const *in, int offset, int len)
+{
+    const uint8_t *in_planes[64];
+    uint8_t *flt_in[64], *flt_out[64];
+    int i, o;
+
+    for (i = 0; i < s->in_channels; i++)
+        flt_in[i] = s->tmp[0] + i * BLOCK_SIZE * sizeof(float);
+    for (o = 0; o < s->out_channels; o++)
+        flt_out[o] = s->tmp[1] + o * BLOCK_SIZE * sizeof(float);
+
+    if (s->planar & AV_SAMPLE_CONV_PLANAR_IN) {
+        for (i = 0; i < s->in_channels; i++)
+            s->to_flt(flt_in[i], in[i] + offset * s->in_bps, len);
+    } else {
+        s->to_flt(s->tmp[2], in[0] + offset * s->in_bps * s->in_channels,
+                  len * s->in_channels);
+        s->deinterleave_flt(flt_in, s->tmp[2], s->in_channels, len);
+    }
+
+    for (o = 0; o < s->out_channels; o++) {
+        const float *m = s->matrix + o * s->in_channels;
+        memset(flt_out[o], 0, len * sizeof(float));
+        for (i = 0; i < s->in_channels; i++)
+            if (m[i])
+                s->mix((float *)flt_out[o], (const float *)flt_in[i], m[i], len);
+    }
+
+    if (s->planar & AV_SAMPLE_CONV_PLANAR_OUT) {
+        for (o = 0; o < s->out_channels; o++)
+            s->from_flt(out[o] + offset * s->out_bps, flt_out[o], len);
+    } else {
+        for (o = 0; o < s->out_channels; o++)
+            in_planes[o] = flt_out[o];
+        s->interleave_flt(s->tmp[2], in_planes, s->out_channels, len);
+        s->from_flt(out[0] + offset * s->out_bps * s->out_channels, s->tmp[2],
+                    len * s->out_channels);
+    }
+}
+
+int av_sample_conv(AVSampleConv *s, uint8_t * const *out,
+                   const uint8_t * const *in, int nb_samples)
+{
+    const int channels = s->in_channels;
+    const uint8_t *planes_in[64];
+    uint8_t *planes_out[64];
+    int ch, n, len;
+
+    if (channels > 64 || s->out_channels > 64)
+        return AVERROR(EINVAL);
+
+    if (s->matrix) {
+        for (n = 0; n < nb_samples; n += len) {
+            len = FFMIN(nb_samples - n, BLOCK_SIZE);
+            remix_block(s, out, in, n, len);
+        }
+        return 0;
+    }
+
+    switch (s->planar) {
+    case 0:
+        s->conv(out[0], in[0], nb_samples * channels);
+        break;
+    case AV_SAMPLE_CONV_PLANAR_IN | AV_SAMPLE_CONV_PLANAR_OUT:
+        for (ch = 0; ch < channels; ch++)
+            s->conv(out[ch], in[ch], nb_samples);
+        break;
+    case AV_SAMPLE_CONV_PLANAR_IN:
+        if (s->same_fmt) {
+            s->interleave_out(out[0], in, channels, nb_samples);
+            break;
+        }
+        for (n = 0; n < nb_samples; n += len) {
+            len = FFMIN(nb_samples - n, BLOCK_SIZE);
+            for (ch = 0; ch < channels; ch++) {
+                planes_out[ch] = s->tmp[0] + ch * BLOCK_SIZE * s->out_bps;
+                s->conv(planes_out[ch], in[ch] + n * s->in_bps, len);
+                planes_in[ch]  = planes_out[ch];
+            }
+            s->interleave_out(out[0] + n * s->out_bps * channels, planes_in,
+                              channels, len);
+        }
+        break;
+    case AV_SAMPLE_CONV_PLANAR_OUT:
+        if (s->same_fmt) {
+            s->deinterleave_in(out, in[0], channels, nb_samples);
+            break;
+        }
+        for (n = 0; n < nb_samples; n += len) {
+            len = FFMIN(nb_samples - n, BLOCK_SIZE);
+            s->conv(s->tmp[0], in[0] + n * s->in_bps * channels, len * channels);
+            for (ch = 0; ch < channels; ch++)
+                planes_out[ch] = out[ch] + n * s->out_bps;
+            s->deinterleave_out(planes_out, s->tmp[0], channels, len);
+        }
+        break;
+    }
+    return 0;
+}
+
+#ifdef TEST
+
+#include <stdio.h>
+#include <time.h>
+#include "lfg.h"
+
+#undef printf
+#undef fprintf
+
+#define NB_SAMPLES 4096
+#define RUNS       200
+
+static const int64_t layouts[][2] = {
+    { AV_CH_LAYOUT_STEREO,  AV_CH_LAYOUT_STEREO  },
+    { AV_CH_LAYOUT_5POINT1, AV_CH_LAYOUT_5POINT1 },
+    { AV_CH_LAYOUT_STEREO,  AV_CH_LAYOUT_5POINT1 },
+    { AV_CH_LAYOUT_STEREO,  AV_CH_LAYOUT_MONO    },
+};
+
+static const char *const packing[] = { "packed", "planar" };
+
+static void fill(uint8_t *buf, enum AVSampleFormat fmt, int count, AVLFG *lfg)
+{
+    int i;
+
+    for (i = 0; i < count; i++) {
+        unsigned r = av_lfg_get(lfg);
+        /* floats slightly out of range, to check the clipping */
+        float f = ((int)r >> 8) / (float)(1 << 22);
+
+        switch (fmt) {
+        case AV_SAMPLE_FMT_U8:  ((uint8_t *)buf)[i] = r;      break;
+        case AV_SAMPLE_FMT_S16: ((int16_t *)buf)[i] = r;      break;
+        case AV_SAMPLE_FMT_S32: ((int32_t *)buf)[i] = r;      break;
+        case AV_SAMPLE_FMT_FLT: ((float   *)buf)[i] = f * 1.1; break;
+        case AV_SAMPLE_FMT_DBL: ((double  *)buf)[i] = f * 1.1; break;
+        }
+    }
+}
+
+/**
+ * Convert with the C and the SSE2 kernels, compare the outputs and
+ * print the speed of both in millions of samples per second.
+ */
+static int test(enum AVSampleFormat out_fmt, int64_t out_layout,
+                enum AVSampleFormat in_fmt,  int64_t in_layout,
+                int planar, uint8_t *src, uint8_t *dst[2])
+{
+    int in_ch  = av_get_channel_layout_nb_channels(in_layout);
+    int out_ch = av_get_channel_layout_nb_channels(out_layout);
+    int in_bps  = av_get_bits_per_sample_fmt(in_fmt)  >> 3;
+    int out_bps = av_get_bits_per_sample_fmt(out_fmt) >> 3;
+    const uint8_t *in[8];
+    uint8_t *out[8];
+    double speed[2];
+    char in_name[32], out_name[32];
+    int i, k, run;
+
+    for (i = 0; i < in_ch; i++)
+        in[i] = src + (planar & AV_SAMPLE_CONV_PLANAR_IN ? i * NB_SAMPLES * in_bps : 0);
+
+    for (k = 0; k < 2; k++) {
+        AVSampleConv *s = av_sample_conv_alloc(out_fmt, out_layout, in_fmt, in_layout, planar, NULL,
+                                               k ? AV_CPU_FLAG_SSE2 : AV_CPU_FLAG_FORCE);
+        clock_t t;
+
+        if (!s) {
+            printf("allocation failed\n");
+            return 1;
+        }
+        for (i = 0; i < out_ch; i++)
+            out[i] = dst[k] + (planar & AV_SAMPLE_CONV_PLANAR_OUT ? i * NB_SAMPLES * out_bps : 0);
+        t = clock();
+        for (run = 0; run < RUNS; run++)
+            av_sample_conv(s, out, in, NB_SAMPLES);
+        t = clock() - t;
+        speed[k] = (double)RUNS * NB_SAMPLES * FFMAX(in_ch, out_ch) * CLOCKS_PER_SEC / FFMAX(t, 1) / 1e6;
+        av_sample_conv_freep(&s);
+    }
+
+    av_get_channel_layout_string(in_name,  sizeof(in_name),  in_ch,  in_layout);
+    av_get_channel_layout_string(out_name, sizeof(out_name), out_ch, out_layout);
+    printf("%-3s %-6s %-6s -> %-3s %-6s %-6s %8.1f %8.1f\n",
+           av_get_sample_fmt_name(in_fmt),  in_name,  packing[planar & 1],
+           av_get_sample_fmt_name(out_fmt), out_name, packing[planar >> 1],
+           speed[0], speed[1]);
+    if (memcmp(dst[0], dst[1], NB_SAMPLES * out_ch * out_bps)) {
+        printf("SSE2 and C output differ\n");
+        return 1;
+    }
+    return 0;
+}
+
+int main(void)
+{
+    uint8_t *src = av_malloc(NB_SAMPLES * 8 * sizeof(double));
+    uint8_t *dst[2] = { av_malloc(NB_SAMPLES * 8 * sizeof(double)),
+                        av_malloc(NB_SAMPLES * 8 * sizeof(double)) };
+    AVLFG lfg;
+    int in_fmt, out_fmt, planar, l, ret = 0;
+
+    if (!src || !dst[0] || !dst[1])
+        return 1;
+    av_lfg_init(&lfg, 0xdeadbeef);
+    printf("%-37s %8s %8s\n", "conversion", "C Ms/s", "SSE2 Ms/s");
+    for (l = 0; l < FF_ARRAY_ELEMS(layouts); l++)
+        for (in_fmt = 0; in_fmt < AV_SAMPLE_FMT_NB; in_fmt++)
+            for (out_fmt = 0; out_fmt < AV_SAMPLE_FMT_NB; out_fmt++)
+                for (planar = 0; planar < 4; planar++) {
+                    fill(src, in_fmt, NB_SAMPLES * 8, &lfg);
+                    ret |= test(out_fmt, layouts[l][0], in_fmt, layouts[l][1],
+                                planar, src, dst);
+                }
+
+    av_free(src);
+    av_free(dst[0]);
+    av_free(dst[1]);
+    return ret;
+}
+
+#endif
@@ -0,0 +1,81 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * sample format, packing and channel layout conversion
+ *
+ * A converter picks the kernels for a given pair of formats, packings
+ * and layouts once at allocation, so that converting a buffer does not
+ * test the formats per sample. The results are the same as those of
+ * av_audio_convert() whichever kernels are used.
+ */
+
+#ifndef AVUTIL_SAMPLECONV_H
+#define AVUTIL_SAMPLECONV_H
+
+#include <stdint.h>
+#include "libavutil/attributes.h"
+#include "samplefmt.h"
+
+typedef struct AVSampleConv AVSampleConv;
+
+#define AV_SAMPLE_CONV_PLANAR_IN  1 ///< one buffer per input channel
+#define AV_SAMPLE_CONV_PLANAR_OUT 2 ///< one buffer per output channel
+
+/**
+ * Allocate a converter.
+ *
+ * @param out_fmt    output sample format
+ * @param out_layout output channel layout
+ * @param in_fmt     input sample format
+ * @param in_layout  input channel layout
+ * @param planar     AV_SAMPLE_CONV_PLANAR_* flags, interleaved channels if unset
+ * @param matrix     mixing coefficients, matrix[o * nb_in_channels + i] being
+ *                   the weight of input channel i in output channel o; if NULL,
+ *                   channels present in both layouts are copied and the others
+ *                   are downmixed or upmixed with default weights
+ * @param cpu_flags  AV_CPU_FLAG_* flags of the kernels that may be used, in
+ *                   addition to those returned by av_get_cpu_flags() and
+ *                   to SSE2 on targets that always have it, unless
+ *                   AV_CPU_FLAG_FORCE is set
+ * @return the converter, or NULL if a format or layout is not supported
+ */
+FFMPEGLIB_API AVSampleConv *av_sample_conv_alloc(enum AVSampleFormat out_fmt, int64_t out_layout,
+                                                 enum AVSampleFormat in_fmt,  int64_t in_layout,
+                                                 int planar, const float *matrix, int cpu_flags);
+
+/**
+ * Free a converter and set the pointer to NULL.
+ */
+FFMPEGLIB_API void av_sample_conv_freep(AVSampleConv **s);
+
+/**
+ * Convert samples.
+ *
+ * @param out        one pointer per output channel if the output is planar,
+ *                   otherwise out[0] only
+ * @param in         one pointer per input channel if the input is planar,
+ *                   otherwise in[0] only
+ * @param nb_samples number of samples per channel
+ * @return 0, or a negative AVERROR code on failure
+ */
+FFMPEGLIB_API int av_sample_conv(AVSampleConv *s, uint8_t * const *out,
+                                 const uint8_t * const *in, int nb_samples);
+
+#endif /* AVUTIL_SAMPLECONV_H */
@@ -64,8 +64,19 @@ tend= AV_READ_TIME();\
     }\
 }
 #else
-#define START_TIMER
-#define STOP_TIMER(id) {}
+#include "profile.h"
+/* without a cycle counter, time the section with the profiling API */
+#define START_TIMER \
+AVProfileTimer ptimer;\
+av_profile_begin(&ptimer);
+
+#define STOP_TIMER(id) \
+{\
+    static int pscope = -1;\
+    if (pscope < 0)\
+        pscope = av_profile_register(id);\
+    av_profile_end(pscope, &ptimer);\
+}
 #endif
 
 #endif /* AVUTIL_TIMER_H */
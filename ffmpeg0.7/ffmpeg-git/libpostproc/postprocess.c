@@ -26,17 +26,17 @@
  */
 
 /*
-                        C       MMX     MMX2    3DNow   AltiVec
-isVertDC                Ec      Ec                      Ec
-isVertMinMaxOk          Ec      Ec                      Ec
-doVertLowPass           E               e       e       Ec
-doVertDefFilter         Ec      Ec      e       e       Ec
-isHorizDC               Ec      Ec                      Ec
-isHorizMinMaxOk         a       E                       Ec
-doHorizLowPass          E               e       e       Ec
-doHorizDefFilter        Ec      Ec      e       e       Ec
+                        C       MMX     MMX2    3DNow   AltiVec SSE2
+isVertDC                Ec      Ec                      Ec      Ec
+isVertMinMaxOk          Ec      Ec                      Ec      Ec
+doVertLowPass           E               e       e       Ec      Ec
+doVertDefFilter         Ec      Ec      e       e       Ec      Ec
+isHorizDC               Ec      Ec                      Ec      Ec
+isHorizMinMaxOk         a       E                       Ec      Ec
+doHorizLowPass          E               e       e       Ec      Ec
+doHorizDefFilter        Ec      Ec      e       e       Ec      Ec
 do_a_deblock            Ec      E       Ec      E
-deRing                  E               e       e*      Ecp
+deRing                  E               e       e*      Ecp     e
 Vertical RKAlgo1        E               a       a
 Horizontal RKAlgo1                      a       a
 Vertical X1#            a               E       E
@@ -586,6 +586,9 @@ static av_always_inline void do_a_deblock_C(uint8_t *src, int step, int stride,
 #if (HAVE_AMD3DNOW && !HAVE_MMX2) || CONFIG_RUNTIME_CPUDETECT
 #define COMPILE_3DNOW
 #endif
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+// x86 without inline asm, the SSE2 versions use intrinsics
+#define COMPILE_SSE2
 #endif /* ARCH_X86 */
 
 #undef HAVE_MMX
@@ -596,6 +599,8 @@ static av_always_inline void do_a_deblock_C(uint8_t *src, int step, int stride,
 #define HAVE_AMD3DNOW 0
 #undef HAVE_ALTIVEC
 #define HAVE_ALTIVEC 0
+#undef HAVE_SSE2
+#define HAVE_SSE2 0
 
 #ifdef COMPILE_C
 #define RENAME(a) a ## _C
@@ -644,6 +649,16 @@ static av_always_inline void do_a_deblock_C(uint8_t *src, int step, int stride,
 #include "postprocess_template.c"
 #endif
 
+//SSE2 versions
+#ifdef COMPILE_SSE2
+#undef RENAME
+#undef HAVE_SSE2
+#define HAVE_SSE2 1
+#define RENAME(a) a ## _SSE2
+#include "postprocess_sse2_template.c"
+#include "postprocess_template.c"
+#endif
+
 // minor note: the HAVE_xyz is messed up after that line so do not use it.
 
 static inline void postProcess(const uint8_t src[], int srcStride, uint8_t dst[], int dstStride, int width, int height,
@@ -668,6 +683,11 @@ static inline void postProcess(const uint8_t src[], int srcStride, uint8_t dst[]
     else
         postProcess_C(src, srcStride, dst, dstStride, width, height, QPs, QPStride, isColor, c);
 #else
+#ifdef COMPILE_SSE2
+    if(c->cpuCaps & PP_CPU_CAPS_SSE2)
+            postProcess_SSE2(src, srcStride, dst, dstStride, width, height, QPs, QPStride, isColor, c);
+    else
+#endif
 #if HAVE_ALTIVEC
     if(c->cpuCaps & PP_CPU_CAPS_ALTIVEC)
             postProcess_altivec(src, srcStride, dst, dstStride, width, height, QPs, QPStride, isColor, c);
@@ -685,6 +705,11 @@ static inline void postProcess(const uint8_t src[], int srcStride, uint8_t dst[]
 #elif HAVE_ALTIVEC
             postProcess_altivec(src, srcStride, dst, dstStride, width, height, QPs, QPStride, isColor, c);
 #else
+#ifdef COMPILE_SSE2
+    if(c->cpuCaps & PP_CPU_CAPS_SSE2)
+            postProcess_SSE2(src, srcStride, dst, dstStride, width, height, QPs, QPStride, isColor, c);
+    else
+#endif
             postProcess_C(src, srcStride, dst, dstStride, width, height, QPs, QPStride, isColor, c);
 #endif
 #endif //!CONFIG_RUNTIME_CPUDETECT
@@ -0,0 +1,292 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * SSE2 intrinsics versions of the deblocking and deringing filters.
+ *
+ * These are meant for x86 builds without inline asm (MSVC x64). A block
+ * row is 8 pixels, which fit one register at 16-bit precision, so the
+ * filters compute the same values as the C versions instead of the
+ * pavgb approximations of the MMX2 ones. The horizontal filters run the
+ * vertical ones on a transposed copy of the block.
+ */
+
+#include <emmintrin.h>
+#include "libavutil/avutil.h"
+
+#define LOAD8(p)    _mm_loadl_epi64((const __m128i *)(p))
+#define STORE8(p, v) _mm_storel_epi64((__m128i *)(p), v)
+
+static inline __m128i abs_epi16_SSE2(__m128i a)
+{
+    return _mm_max_epi16(a, _mm_sub_epi16(_mm_setzero_si128(), a));
+}
+
+static inline __m128i absdiff_epu8_SSE2(__m128i a, __m128i b)
+{
+    return _mm_or_si128(_mm_subs_epu8(a, b), _mm_subs_epu8(b, a));
+}
+
+/**
+ * Check if the middle 8x8 Block in the given 8x16 block is flat
+ */
+static inline int vertClassify_SSE2(uint8_t src[], int stride, PPContext *c)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const int dcOffset = ((c->nonBQP*c->ppMode.baseDcDiff)>>8) + 1;
+    const __m128i offset = _mm_set1_epi8(FFMIN(dcOffset, 255));
+    const __m128i qp2 = _mm_set1_epi8(FFMIN(2*c->QP, 255));
+    __m128i r[8], a, b, eq, numEq, diff;
+    int i;
+
+    src+= stride*4; // src points to begin of the 8x8 Block
+    for (i = 0; i < 8; i++)
+        r[i] = LOAD8(src + i*stride);
+
+    /* |src[x] - src[x + stride]| <= dcOffset, two line pairs at a time */
+    numEq = zero;
+    for (i = 0; i < 6; i += 2) {
+        a  = _mm_unpacklo_epi64(r[i    ], r[i + 1]);
+        b  = _mm_unpacklo_epi64(r[i + 1], r[i + 2]);
+        eq = _mm_cmpeq_epi8(_mm_subs_epu8(absdiff_epu8_SSE2(a, b), offset), zero);
+        numEq = _mm_sub_epi8(numEq, eq);
+    }
+    eq = _mm_cmpeq_epi8(_mm_subs_epu8(absdiff_epu8_SSE2(r[6], r[7]), offset), zero);
+    numEq = _mm_sub_epi8(numEq, _mm_move_epi64(eq));
+    numEq = _mm_sad_epu8(numEq, zero);
+    numEq = _mm_add_epi32(numEq, _mm_srli_si128(numEq, 8));
+    if (_mm_cvtsi128_si32(numEq) <= c->ppMode.flatnessThreshold)
+        return 2;
+
+    /* lines 0-5, 2-7, 4-1 and 6-3 for columns 0-3, repeated for 4-7 */
+    diff = _mm_or_si128(
+           _mm_or_si128(_mm_and_si128(absdiff_epu8_SSE2(r[0], r[5]), _mm_set1_epi32(0x000000FF)),
+                        _mm_and_si128(absdiff_epu8_SSE2(r[2], r[7]), _mm_set1_epi32(0x0000FF00))),
+           _mm_or_si128(_mm_and_si128(absdiff_epu8_SSE2(r[4], r[1]), _mm_set1_epi32(0x00FF0000)),
+                        _mm_and_si128(absdiff_epu8_SSE2(r[6], r[3]), _mm_set1_epi32(0xFF000000))));
+    diff = _mm_cmpeq_epi8(_mm_subs_epu8(diff, qp2), zero);
+    return (_mm_movemask_epi8(diff) & 0xFF) == 0xFF;
+}
+
+/**
+ * Do a vertical low pass filter on the 8x16 block (only write to the 8x8 block in the middle)
+ * using the 9-Tap Filter (1,1,2,2,4,2,2,1,1)/16
+ */
+static inline void doVertLowPass_SSE2(uint8_t *src, int stride, PPContext *c)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i qp   = _mm_set1_epi16(c->QP);
+    __m128i v[10], sums[10], first, last, m;
+    int i;
+
+    src+= stride*3;
+    for (i = 0; i < 10; i++)
+        v[i] = _mm_unpacklo_epi8(LOAD8(src + i*stride), zero);
+
+    m     = _mm_cmplt_epi16(abs_epi16_SSE2(_mm_sub_epi16(v[0], v[1])), qp);
+    first = _mm_or_si128(_mm_and_si128(m, v[0]), _mm_andnot_si128(m, v[1]));
+    m     = _mm_cmplt_epi16(abs_epi16_SSE2(_mm_sub_epi16(v[8], v[9])), qp);
+    last  = _mm_or_si128(_mm_and_si128(m, v[9]), _mm_andnot_si128(m, v[8]));
+
+    sums[0] = _mm_add_epi16(_mm_add_epi16(_mm_slli_epi16(first, 2), _mm_set1_epi16(4)),
+                            _mm_add_epi16(_mm_add_epi16(v[1], v[2]), v[3]));
+    for (i = 1; i < 5; i++)
+        sums[i] = _mm_add_epi16(_mm_sub_epi16(sums[i - 1], first), v[i + 3]);
+    sums[5] = _mm_add_epi16(_mm_sub_epi16(sums[4], v[1]), v[8]);
+    for (i = 6; i < 10; i++)
+        sums[i] = _mm_add_epi16(_mm_sub_epi16(sums[i - 1], v[i - 4]), last);
+
+    for (i = 1; i < 9; i++) {
+        __m128i f = _mm_add_epi16(_mm_add_epi16(sums[i - 1], sums[i + 1]),
+                                  _mm_slli_epi16(v[i], 1));
+        f = _mm_srli_epi16(f, 4);
+        STORE8(src + i*stride, _mm_packus_epi16(f, f));
+    }
+}
+
+static inline void doVertDefFilter_SSE2(uint8_t src[], int stride, PPContext *c)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i v[9], middleEnergy, leftEnergy, rightEnergy, absMiddle, q, d, m, pos;
+    int i;
+
+#define ENERGY(a, b, c, d) \
+    _mm_add_epi16(_mm_mullo_epi16(_mm_sub_epi16(a, b), _mm_set1_epi16(5)), \
+                  _mm_slli_epi16(_mm_sub_epi16(c, d), 1))
+
+    src+= stride*3;
+    for (i = 1; i < 9; i++)
+        v[i] = _mm_unpacklo_epi8(LOAD8(src + i*stride), zero);
+
+    middleEnergy = ENERGY(v[5], v[4], v[3], v[6]);
+    absMiddle    = abs_epi16_SSE2(middleEnergy);
+    m = _mm_cmplt_epi16(absMiddle, _mm_set1_epi16(8*c->QP));
+    if (!_mm_movemask_epi8(m))
+        return;
+    leftEnergy  = ENERGY(v[3], v[2], v[1], v[4]);
+    rightEnergy = ENERGY(v[7], v[6], v[5], v[8]);
+#undef ENERGY
+
+    d = _mm_sub_epi16(absMiddle, _mm_min_epi16(abs_epi16_SSE2(leftEnergy),
+                                               abs_epi16_SSE2(rightEnergy)));
+    d = _mm_max_epi16(d, zero);
+    d = _mm_srai_epi16(_mm_add_epi16(_mm_mullo_epi16(d, _mm_set1_epi16(5)),
+                                     _mm_set1_epi16(32)), 6);
+    /* d*= FFSIGN(-middleEnergy) */
+    pos = _mm_cmpgt_epi16(middleEnergy, _mm_set1_epi16(-1));
+    d = _mm_sub_epi16(_mm_xor_si128(d, pos), pos);
+
+    /* q = (src[l4] - src[l5]) / 2, rounded towards 0; clip d between 0 and q */
+    q = _mm_sub_epi16(v[4], v[5]);
+    q = _mm_srai_epi16(_mm_sub_epi16(q, _mm_srai_epi16(q, 15)), 1);
+    d = _mm_max_epi16(d, _mm_min_epi16(q, zero));
+    d = _mm_min_epi16(d, _mm_max_epi16(q, zero));
+    d = _mm_and_si128(d, m);
+
+    v[4] = _mm_sub_epi16(v[4], d);
+    v[5] = _mm_add_epi16(v[5], d);
+    STORE8(src + 4*stride, _mm_packus_epi16(v[4], v[4]));
+    STORE8(src + 5*stride, _mm_packus_epi16(v[5], v[5]));
+}
+
+/**
+ * Dering the 8x8 block in the middle of the given 10x10 block.
+ * Unlike the C version, every pixel is filtered from the unfiltered
+ * values of its neighbours, as in the MMX2 version.
+ */
+static inline void dering_SSE2(uint8_t src[], int stride, PPContext *c)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i bits = _mm_setr_epi16(1, 2, 4, 8, 16, 32, 64, 128);
+    const __m128i QP2  = _mm_set1_epi16(c->QP/2 + 1);
+    __m128i h[10], mid[10], lo, hi, t;
+    int s[10];
+    int y, min, max, avg;
+
+    lo = hi = LOAD8(src + stride + 1);
+    for (y = 2; y < 9; y++) {
+        t  = LOAD8(src + stride*y + 1);
+        lo = _mm_min_epu8(lo, t);
+        hi = _mm_max_epu8(hi, t);
+    }
+    lo = _mm_min_epu8(lo, _mm_srli_si128(lo, 4));
+    lo = _mm_min_epu8(lo, _mm_srli_si128(lo, 2));
+    lo = _mm_min_epu8(lo, _mm_srli_si128(lo, 1));
+    hi = _mm_max_epu8(hi, _mm_srli_si128(hi, 4));
+    hi = _mm_max_epu8(hi, _mm_srli_si128(hi, 2));
+    hi = _mm_max_epu8(hi, _mm_srli_si128(hi, 1));
+    min = _mm_cvtsi128_si32(lo) & 0xFF;
+    max = _mm_cvtsi128_si32(hi) & 0xFF;
+    avg = (min + max + 1)>>1;
+
+    if(max - min <deringThreshold) return;
+
+    for (y = 0; y < 10; y++) {
+        __m128i line = _mm_loadu_si128((const __m128i *)(src + stride*y));
+        __m128i sign = _mm_set1_epi8(0x80);
+        int t = _mm_movemask_epi8(_mm_cmpgt_epi8(_mm_xor_si128(line, sign),
+                                                 _mm_set1_epi8(avg ^ 0x80))) & 0x3FF;
+
+        t |= (~t)<<16;
+        t &= (t<<1) & (t>>1);
+        s[y] = t;
+
+        /* src[x-1] + 2*src[x] + src[x+1] for x = 1..8 */
+        mid[y] = _mm_unpacklo_epi8(_mm_srli_si128(line, 1), zero);
+        h[y]   = _mm_add_epi16(_mm_add_epi16(_mm_unpacklo_epi8(line, zero),
+                                             _mm_unpacklo_epi8(_mm_srli_si128(line, 2), zero)),
+                               _mm_slli_epi16(mid[y], 1));
+    }
+
+    for(y=1; y<9; y++){
+        int t = s[y-1] & s[y] & s[y+1];
+        t|= t>>16;
+        s[y-1]= t;
+    }
+
+    for (y = 1; y < 9; y++) {
+        __m128i f, m;
+
+        if (!(s[y-1] & 0x1FE))
+            continue;
+        f = _mm_add_epi16(_mm_add_epi16(h[y-1], h[y+1]), _mm_slli_epi16(h[y], 1));
+        f = _mm_srli_epi16(_mm_add_epi16(f, _mm_set1_epi16(8)), 4);
+        f = _mm_max_epi16(f, _mm_sub_epi16(mid[y], QP2));
+        f = _mm_min_epi16(f, _mm_add_epi16(mid[y], QP2));
+        m = _mm_cmpeq_epi16(_mm_and_si128(_mm_set1_epi16(s[y-1]>>1), bits), bits);
+        f = _mm_or_si128(_mm_and_si128(m, f), _mm_andnot_si128(m, mid[y]));
+        STORE8(src + stride*y + 1, _mm_packus_epi16(f, f));
+    }
+}
+
+/**
+ * Transpose the 16x8 block at src (8 lines of 16 pixels) into 16 lines
+ * of 8 pixels at dst, which must be 16-byte aligned.
+ */
+static inline void transpose_16x8_SSE2(uint8_t *dst, const uint8_t *src, int stride)
+{
+    __m128i r[8], t[8], u[8];
+    int i;
+
+    for (i = 0; i < 8; i++)
+        r[i] = _mm_loadu_si128((const __m128i *)(src + i*stride));
+    for (i = 0; i < 8; i += 2) {
+        t[i    ] = _mm_unpacklo_epi8(r[i], r[i + 1]);
+        t[i + 1] = _mm_unpackhi_epi8(r[i], r[i + 1]);
+    }
+    for (i = 0; i < 8; i += 4) {
+        u[i    ] = _mm_unpacklo_epi16(t[i    ], t[i + 2]);
+        u[i + 1] = _mm_unpackhi_epi16(t[i    ], t[i + 2]);
+        u[i + 2] = _mm_unpacklo_epi16(t[i + 1], t[i + 3]);
+        u[i + 3] = _mm_unpackhi_epi16(t[i + 1], t[i + 3]);
+    }
+    for (i = 0; i < 4; i++) {
+        _mm_store_si128((__m128i *)(dst + 32*i     ), _mm_unpacklo_epi32(u[i], u[i + 4]));
+        _mm_store_si128((__m128i *)(dst + 32*i + 16), _mm_unpackhi_epi32(u[i], u[i + 4]));
+    }
+}
+
+/**
+ * Transpose the 8x8 block at src (packed lines of 8 pixels) back to dst.
+ */
+static inline void transpose_8x8_SSE2(uint8_t *dst, int stride, const uint8_t *src)
+{
+    __m128i t[4], u[4], v;
+    int i;
+
+    for (i = 0; i < 4; i++)
+        t[i] = _mm_unpacklo_epi8(LOAD8(src + 16*i), LOAD8(src + 16*i + 8));
+    u[0] = _mm_unpacklo_epi16(t[0], t[1]);
+    u[1] = _mm_unpackhi_epi16(t[0], t[1]);
+    u[2] = _mm_unpacklo_epi16(t[2], t[3]);
+    u[3] = _mm_unpackhi_epi16(t[2], t[3]);
+    for (i = 0; i < 4; i++) {
+        v = i & 1 ? _mm_unpackhi_epi32(u[i>>1], u[(i>>1) + 2])
+                  : _mm_unpacklo_epi32(u[i>>1], u[(i>>1) + 2]);
+        STORE8(dst + (2*i    )*stride, v);
+        STORE8(dst + (2*i + 1)*stride, _mm_srli_si128(v, 8));
+    }
+}
+
+#undef LOAD8
+#undef STORE8
+
+#define doHorizLowPass_SSE2   doHorizLowPass_C
+#define doHorizDefFilter_SSE2 doHorizDefFilter_C
+#define do_a_deblock_SSE2     do_a_deblock_C
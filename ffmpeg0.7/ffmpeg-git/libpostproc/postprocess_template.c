@@ -177,7 +177,7 @@ static inline int RENAME(vertClassify)(uint8_t src[], int stride, PPContext *c){
  * Do a vertical low pass filter on the 8x16 block (only write to the 8x8 block in the middle)
  * using the 9-Tap Filter (1,1,2,2,4,2,2,1,1)/16
  */
-#if !HAVE_ALTIVEC
+#if !HAVE_ALTIVEC && !HAVE_SSE2
 static inline void RENAME(doVertLowPass)(uint8_t *src, int stride, PPContext *c)
 {
 #if HAVE_MMX2 || HAVE_AMD3DNOW
@@ -348,7 +348,7 @@ static inline void RENAME(doVertLowPass)(uint8_t *src, int stride, PPContext *c)
     }
 #endif //HAVE_MMX2 || HAVE_AMD3DNOW
 }
-#endif //HAVE_ALTIVEC
+#endif //!HAVE_ALTIVEC && !HAVE_SSE2
 
 /**
  * Experimental Filter 1
@@ -482,7 +482,7 @@ static inline void RENAME(vertX1Filter)(uint8_t *src, int stride, PPContext *co)
 #endif //HAVE_MMX2 || HAVE_AMD3DNOW
 }
 
-#if !HAVE_ALTIVEC
+#if !HAVE_ALTIVEC && !HAVE_SSE2
 static inline void RENAME(doVertDefFilter)(uint8_t src[], int stride, PPContext *c)
 {
 #if HAVE_MMX2 || HAVE_AMD3DNOW
@@ -1038,9 +1038,9 @@ static inline void RENAME(doVertDefFilter)(uint8_t src[], int stride, PPContext
     }
 #endif //HAVE_MMX2 || HAVE_AMD3DNOW
 }
-#endif //HAVE_ALTIVEC
+#endif //!HAVE_ALTIVEC && !HAVE_SSE2
 
-#if !HAVE_ALTIVEC
+#if !HAVE_ALTIVEC && !HAVE_SSE2
 static inline void RENAME(dering)(uint8_t src[], int stride, PPContext *c)
 {
 #if HAVE_MMX2 || HAVE_AMD3DNOW
@@ -1387,7 +1387,7 @@ DERING_CORE((%0, %1, 8)    ,(%%REGd, %1, 4),%%mm2,%%mm4,%%mm0,%%mm3,%%mm5,%%mm1,
 #endif
 #endif //HAVE_MMX2 || HAVE_AMD3DNOW
 }
-#endif //HAVE_ALTIVEC
+#endif //!HAVE_ALTIVEC && !HAVE_SSE2
 
 /**
  * Deinterlace the given block by linearly interpolating every second line.
@@ -3529,6 +3529,18 @@ static void RENAME(postProcess)(const uint8_t src[], int srcStride, uint8_t dst[
                         doVertDefFilter_altivec(tempBlock-48, 16, &c);
                         transpose_8x16_char_fromPackedAlign_altivec(dstBlock - (4 + 1), tempBlock, stride);
                     }
+#elif HAVE_SSE2
+                    DECLARE_ALIGNED(16, uint8_t, tempBlock)[16*8];
+                    int t;
+                    transpose_16x8_SSE2(tempBlock, dstBlock - 8, stride);
+
+                    t= vertClassify_SSE2(tempBlock, 8, &c);
+                    if(t==1)
+                        doVertLowPass_SSE2(tempBlock, 8, &c);
+                    else if(t==2)
+                        doVertDefFilter_SSE2(tempBlock, 8, &c);
+                    if(t)
+                        transpose_8x8_SSE2(dstBlock - 4, stride, tempBlock + 4*8);
 #else
                     const int t= RENAME(horizClassify)(dstBlock-4, stride, &c);
 
@@ -0,0 +1,108 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Parser benchmark: splits a raw elementary stream into frames with the
+ * parser of the given codec, without decoding, and prints the throughput
+ * and the number of frames found.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libavcodec/avcodec.h"
+#include "libavformat/avformat.h"
+#include "libavutil/mem.h"
+
+#define MAX_SIZE (256 << 20)
+/* bytes passed to the parser per call, as a demuxer would */
+#define CHUNK    4096
+
+int main(int argc, char **argv)
+{
+    AVCodec *codec;
+    uint8_t *data;
+    int size, runs, run;
+    FILE *f;
+
+    if (argc < 3) {
+        printf("usage: %s decoder input [runs]\n"
+               "Split a raw elementary stream (h264, mpeg4, vc1, mpeg2video...)\n"
+               "into frames with the parser of the given decoder and print the\n"
+               "parsing speed.\n", argv[0]);
+        return 1;
+    }
+    runs = argc > 3 ? FFMAX(atoi(argv[3]), 1) : 10;
+
+    avcodec_register_all();
+    if (!(codec = avcodec_find_decoder_by_name(argv[1]))) {
+        fprintf(stderr, "unknown decoder %s\n", argv[1]);
+        return 1;
+    }
+
+    data = av_malloc(MAX_SIZE + FF_INPUT_BUFFER_PADDING_SIZE);
+    if (!data)
+        return 1;
+    if (!(f = fopen(argv[2], "rb"))) {
+        perror(argv[2]);
+        return 1;
+    }
+    size = fread(data, 1, MAX_SIZE, f);
+    fclose(f);
+    memset(data + size, 0, FF_INPUT_BUFFER_PADDING_SIZE);
+
+    for (run = 0; run < runs; run++) {
+        AVCodecParserContext *parser = av_parser_init(codec->id);
+        AVCodecContext *avctx = avcodec_alloc_context();
+        int pos = 0, frames = 0, bytes = 0;
+        int64_t t;
+
+        if (!parser || !avctx) {
+            fprintf(stderr, "no parser for %s\n", argv[1]);
+            return 1;
+        }
+        t = av_gettime();
+        /* an empty buffer at the end flushes the last frame */
+        while (pos <= size) {
+            uint8_t *out;
+            int out_size, len;
+
+            len = av_parser_parse2(parser, avctx, &out, &out_size,
+                                   data + pos, FFMIN(CHUNK, size - pos),
+                                   AV_NOPTS_VALUE, AV_NOPTS_VALUE, pos);
+            if (out_size) {
+                frames++;
+                bytes += out_size;
+            }
+            if (pos == size)
+                break;
+            pos += len;
+        }
+        t = av_gettime() - t;
+        if (!run)
+            printf("%s: %d bytes, %d frames, %d bytes in frames\n",
+                   argv[2], size, frames, bytes);
+        printf("run %2d: %8.1f MB/s\n", run, (double)size / FFMAX(t, 1));
+        av_parser_close(parser);
+        av_free(avctx);
+    }
+
+    av_free(data);
+    return 0;
+}
@@ -0,0 +1,158 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Postprocessing benchmark: runs every filter mode over a raw yuv420p
+ * clip with each CPU path and prints the frame rate and a checksum of
+ * the output, so that the paths can be compared for speed and exactness.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "config.h"
+#include "libavformat/avformat.h"
+#include "libavutil/adler32.h"
+#include "libavutil/mem.h"
+#include "libpostproc/postprocess.h"
+
+#define MAX_FRAMES 500
+
+static const char *const modes[] = {
+    "hb", "vb", "ha", "va", "h1", "v1", "dr", "tn", "al",
+    "hb/vb/dr", "ha/va/dr", "de", "fa",
+};
+
+/* the paths postprocess.c compiles and dispatches to for these caps */
+#if !ARCH_X86 && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define HAVE_SSE2_PATH 1
+#else
+#define HAVE_SSE2_PATH 0
+#endif
+
+static const struct {
+    const char *name;
+    int caps;
+    int compiled;
+} cpus[] = {
+    { "C",     0,                 CONFIG_RUNTIME_CPUDETECT || !(HAVE_MMX || HAVE_ALTIVEC) },
+    { "MMX",   PP_CPU_CAPS_MMX,   ARCH_X86 && (CONFIG_RUNTIME_CPUDETECT ||
+                                               (HAVE_MMX && !HAVE_MMX2 && !HAVE_AMD3DNOW)) },
+    { "MMX2",  PP_CPU_CAPS_MMX2,  ARCH_X86 && (CONFIG_RUNTIME_CPUDETECT || HAVE_MMX2) },
+    { "3DNow", PP_CPU_CAPS_3DNOW, ARCH_X86 && (CONFIG_RUNTIME_CPUDETECT ||
+                                               (HAVE_AMD3DNOW && !HAVE_MMX2)) },
+    { "SSE2",  PP_CPU_CAPS_SSE2,  HAVE_SSE2_PATH && (CONFIG_RUNTIME_CPUDETECT || !HAVE_ALTIVEC) },
+};
+
+int main(int argc, char **argv)
+{
+    int width, height, qp, nb_frames, frame_size, mb_width, mb_height;
+    int i, m, n, cpu;
+    uint8_t *frames, *out;
+    int8_t *qp_table;
+    FILE *f;
+
+    if (argc < 4) {
+        printf("usage: %s input.yuv width height [qp] [cpu]\n"
+               "Postprocess a raw yuv420p clip with every filter mode and print\n"
+               "the frame rate and output checksum of each CPU path, or only of\n"
+               "the given one (C, MMX, MMX2, 3DNow, SSE2).\n", argv[0]);
+        return 1;
+    }
+    width  = atoi(argv[2]);
+    height = atoi(argv[3]);
+    qp     = argc > 4 ? atoi(argv[4]) : 8;
+    if (width <= 0 || height <= 0 || (width | height) & 15) {
+        fprintf(stderr, "width and height must be multiples of 16\n");
+        return 1;
+    }
+    frame_size = width * height * 3 / 2;
+    mb_width   = width  >> 4;
+    mb_height  = height >> 4;
+
+    frames   = av_malloc((size_t)frame_size * MAX_FRAMES);
+    out      = av_malloc(frame_size);
+    qp_table = av_malloc(mb_width * mb_height);
+    if (!frames || !out || !qp_table)
+        return 1;
+    if (!(f = fopen(argv[1], "rb"))) {
+        perror(argv[1]);
+        return 1;
+    }
+    nb_frames = fread(frames, frame_size, MAX_FRAMES, f);
+    fclose(f);
+    if (!nb_frames) {
+        fprintf(stderr, "%s: no complete frame\n", argv[1]);
+        return 1;
+    }
+    /* vary the quantizer a little so that all classifications occur */
+    for (i = 0; i < mb_width * mb_height; i++)
+        qp_table[i] = FFMAX(qp + (i % 5) - 2, 1);
+
+    printf("%d frames %dx%d, qp %d\n", nb_frames, width, height, qp);
+    for (cpu = 0; cpu < FF_ARRAY_ELEMS(cpus); cpu++)
+        if (!cpus[cpu].compiled)
+            printf("%s path not compiled in, skipped\n", cpus[cpu].name);
+    printf("%-10s %-6s %10s %10s\n", "mode", "cpu", "fps", "adler32");
+
+    for (m = 0; m < FF_ARRAY_ELEMS(modes); m++) {
+        pp_mode *mode = pp_get_mode_by_name_and_quality(modes[m], PP_QUALITY_MAX);
+
+        if (!mode) {
+            fprintf(stderr, "unknown mode %s\n", modes[m]);
+            continue;
+        }
+        for (cpu = 0; cpu < FF_ARRAY_ELEMS(cpus); cpu++) {
+            pp_context *ctx;
+            uint32_t checksum = 1;
+            int64_t t = 0;
+
+            if (!cpus[cpu].compiled || (argc > 5 ? strcmp(argv[5], cpus[cpu].name) : 0))
+                continue;
+            ctx = pp_get_context(width, height, cpus[cpu].caps | PP_FORMAT_420);
+            for (n = 0; n < nb_frames; n++) {
+                const uint8_t *src[3];
+                uint8_t *dst[3];
+                const int src_stride[3] = { width, width >> 1, width >> 1 };
+
+                src[0] = frames + (size_t)n * frame_size;
+                src[1] = src[0] + width * height;
+                src[2] = src[1] + width * height / 4;
+                dst[0] = out;
+                dst[1] = dst[0] + width * height;
+                dst[2] = dst[1] + width * height / 4;
+                /* only the filtering is timed, not the checksum */
+                t -= av_gettime();
+                pp_postprocess(src, src_stride, dst, src_stride, width, height,
+                               qp_table, mb_width, mode, ctx, 0);
+                t += av_gettime();
+                checksum = av_adler32_update(checksum, out, frame_size);
+            }
+            printf("%-10s %-6s %10.1f   %08X\n", modes[m], cpus[cpu].name,
+                   nb_frames * 1000000.0 / FFMAX(t, 1), checksum);
+            pp_free_context(ctx);
+        }
+        pp_free_mode(mode);
+    }
+
+    av_free(frames);
+    av_free(out);
+    av_free(qp_table);
+    return 0;
+}
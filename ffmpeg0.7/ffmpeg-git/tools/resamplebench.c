@@ -0,0 +1,199 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Resampling benchmark: converts 5.1 sine tones between 44100 and 48000 Hz
+ * with av_resample() and with the float resampler, and prints the
+ * throughput and the THD+N of the worst channel of each.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libavcodec/avcodec.h"
+#include "libavformat/avformat.h"
+#include "libavutil/cpu.h"
+#include "libavutil/mathematics.h"
+#include "libavutil/mem.h"
+
+#define CHANNELS  6
+#define SECONDS   10
+#define CHUNK     1024
+#define AMPLITUDE 0.5
+/* samples ignored at both ends when measuring, covering the filter edges */
+#define MARGIN    2048
+
+static const double freqs[CHANNELS] = { 997, 3001, 6007, 9973, 12007, 15013 };
+
+static const struct {
+    const char *name;
+    int float_resampler;
+    int filter_length, log2_phase_count;
+    double cutoff;
+    int cpu_flags;
+} configs[] = {
+    { "av_resample",  0, 16, 10, 0.8,  0                                   },
+    { "float C",      1, 16, 10, 0.8,  AV_CPU_FLAG_FORCE                   },
+    { "float SSE",    1, 16, 10, 0.8,  AV_CPU_FLAG_FORCE | AV_CPU_FLAG_SSE },
+    { "float HQ C",   1, 32, 10, 0.95, AV_CPU_FLAG_FORCE                   },
+    { "float HQ SSE", 1, 32, 10, 0.95, AV_CPU_FLAG_FORCE | AV_CPU_FLAG_SSE },
+};
+
+static const int rates[][2] = { { 44100, 48000 }, { 48000, 44100 } };
+
+/**
+ * Fit a sine of the given frequency and a DC offset to the signal by least
+ * squares and return the ratio of the residual to the fit in dB.
+ */
+static double thd_n(const float *y, int len, double freq, int rate)
+{
+    double w = 2 * M_PI * freq / rate;
+    double m[3][4] = { { 0 } }, a[3], fit = 0, noise = 0;
+    int i, j, k;
+
+    for (i = MARGIN; i < len - MARGIN; i++) {
+        double v[3] = { cos(w * i), sin(w * i), 1 };
+        for (j = 0; j < 3; j++) {
+            for (k = 0; k < 3; k++)
+                m[j][k] += v[j] * v[k];
+            m[j][3] += v[j] * y[i];
+        }
+    }
+    /* Gauss-Jordan elimination of the normal equations */
+    for (j = 0; j < 3; j++)
+        for (k = 0; k < 3; k++) {
+            double f = m[k][j] / m[j][j];
+            if (k == j)
+                continue;
+            for (i = j; i < 4; i++)
+                m[k][i] -= f * m[j][i];
+        }
+    for (j = 0; j < 3; j++)
+        a[j] = m[j][3] / m[j][j];
+
+    for (i = MARGIN; i < len - MARGIN; i++) {
+        double s = a[0] * cos(w * i) + a[1] * sin(w * i);
+        fit   += s * s;
+        noise += (y[i] - s - a[2]) * (y[i] - s - a[2]);
+    }
+    return 10 * log10(noise / fit);
+}
+
+static int run_av_resample(float **out, float **in, int in_len, int out_max,
+                           int out_rate, int in_rate, int c)
+{
+    struct AVResampleContext *ctx;
+    int16_t *src = av_malloc(in_len * sizeof(*src));
+    int16_t *dst = av_malloc(out_max * sizeof(*dst));
+    int ch, i, consumed, n = 0;
+
+    ctx = av_resample_init(out_rate, in_rate, configs[c].filter_length,
+                           configs[c].log2_phase_count, 0, configs[c].cutoff);
+    if (!ctx || !src || !dst)
+        return -1;
+    for (ch = 0; ch < CHANNELS; ch++) {
+        for (i = 0; i < in_len; i++)
+            src[i] = lrintf(in[ch][i] * 32767);
+        n = av_resample(ctx, dst, src, &consumed, in_len, out_max, ch == CHANNELS - 1);
+        for (i = 0; i < n; i++)
+            out[ch][i] = dst[i] / 32768.0;
+    }
+    av_resample_close(ctx);
+    av_free(src);
+    av_free(dst);
+    return n;
+}
+
+static int run_resampler(float **out, float **in, int in_len, int out_max,
+                         int out_rate, int in_rate, int c)
+{
+    AVResampler *r = av_resampler_init(out_rate, in_rate, CHANNELS,
+                                       configs[c].filter_length,
+                                       configs[c].log2_phase_count,
+                                       configs[c].cutoff, configs[c].cpu_flags);
+    const float *src[CHANNELS];
+    float *dst[CHANNELS];
+    int ch, i, ret, n = 0;
+
+    if (!r)
+        return -1;
+    /* feed the input in small chunks, as a stream would, then flush */
+    for (i = 0; i < in_len + CHUNK; i += CHUNK) {
+        for (ch = 0; ch < CHANNELS; ch++) {
+            src[ch] = in[ch] + i;
+            dst[ch] = out[ch] + n;
+        }
+        ret = av_resampler_process(r, dst, out_max - n, i < in_len ? src : NULL,
+                                   FFMIN(CHUNK, in_len - i));
+        if (ret < 0)
+            return ret;
+        n += ret;
+    }
+    av_resampler_close(r);
+    return n;
+}
+
+int main(int argc, char **argv)
+{
+    float *in[CHANNELS], *out[CHANNELS];
+    int rt, c, ch, i;
+
+    printf("%d channels, %d s, amplitude %g\n", CHANNELS, SECONDS, AMPLITUDE);
+    printf("%-12s %-13s %10s %10s\n", "resampler", "rates", "Msamples/s", "THD+N dB");
+
+    for (rt = 0; rt < FF_ARRAY_ELEMS(rates); rt++) {
+        int in_rate  = rates[rt][0];
+        int out_rate = rates[rt][1];
+        int in_len   = in_rate * SECONDS;
+        int out_max  = (int64_t)in_len * out_rate / in_rate + CHUNK;
+
+        for (ch = 0; ch < CHANNELS; ch++) {
+            in[ch]  = av_malloc(in_len  * sizeof(**in));
+            out[ch] = av_malloc(out_max * sizeof(**out));
+            if (!in[ch] || !out[ch])
+                return 1;
+            for (i = 0; i < in_len; i++)
+                in[ch][i] = AMPLITUDE * sin(2 * M_PI * freqs[ch] * i / in_rate);
+        }
+
+        for (c = 0; c < FF_ARRAY_ELEMS(configs); c++) {
+            int64_t t = av_gettime();
+            int n = configs[c].float_resampler ?
+                    run_resampler  (out, in, in_len, out_max, out_rate, in_rate, c) :
+                    run_av_resample(out, in, in_len, out_max, out_rate, in_rate, c);
+            double worst = -INFINITY;
+
+            t = av_gettime() - t;
+            if (n <= 2 * MARGIN) {
+                fprintf(stderr, "%s failed\n", configs[c].name);
+                return 1;
+            }
+            for (ch = 0; ch < CHANNELS; ch++)
+                worst = FFMAX(worst, thd_n(out[ch], n, freqs[ch], out_rate));
+            printf("%-12s %5d->%-5d   %10.1f %10.1f\n", configs[c].name, in_rate, out_rate,
+                   (double)in_len * CHANNELS / FFMAX(t, 1), worst);
+        }
+
+        for (ch = 0; ch < CHANNELS; ch++) {
+            av_free(in[ch]);
+            av_free(out[ch]);
+        }
+    }
+    return 0;
+}
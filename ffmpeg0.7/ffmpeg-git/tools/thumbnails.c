@@ -0,0 +1,154 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Thumbnail extraction: seeks to evenly spaced keyframes of the first video
+ * stream and decodes one frame at each in keyframe-only mode, at the lowest
+ * resolution the decoder supports. Prints the time taken and optionally
+ * writes the luma planes as PGM files.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libavcodec/avcodec.h"
+#include "libavformat/avformat.h"
+#include "libavutil/mathematics.h"
+
+static void write_pgm(const char *prefix, int n, const AVFrame *frame,
+                      int width, int height)
+{
+    char name[1024];
+    FILE *f;
+    int y;
+
+    snprintf(name, sizeof(name), "%s%03d.pgm", prefix, n);
+    if (!(f = fopen(name, "wb"))) {
+        perror(name);
+        return;
+    }
+    fprintf(f, "P5\n%d %d\n255\n", width, height);
+    for (y = 0; y < height; y++)
+        fwrite(frame->data[0] + y * frame->linesize[0], 1, width, f);
+    fclose(f);
+}
+
+/**
+ * Decode packets of the given stream until a frame comes out.
+ * @return 1 if a frame was decoded, 0 at the end of the file
+ */
+static int decode_one(AVFormatContext *fmt, AVCodecContext *avctx, int stream,
+                      AVFrame *frame)
+{
+    AVPacket pkt;
+    int got_frame = 0;
+
+    while (!got_frame) {
+        if (av_read_frame(fmt, &pkt) < 0) {
+            /* drain the frames the decoder may be holding back */
+            av_init_packet(&pkt);
+            pkt.data = NULL;
+            pkt.size = 0;
+            avcodec_decode_video2(avctx, frame, &got_frame, &pkt);
+            return got_frame;
+        }
+        if (pkt.stream_index == stream)
+            avcodec_decode_video2(avctx, frame, &got_frame, &pkt);
+        av_free_packet(&pkt);
+    }
+    return 1;
+}
+
+int main(int argc, char **argv)
+{
+    AVFormatContext *fmt = NULL;
+    AVCodecContext *avctx;
+    AVCodec *codec;
+    AVStream *st;
+    AVFrame *frame;
+    int64_t duration, t;
+    int count, stream, i, found = 0;
+
+    if (argc < 2) {
+        printf("usage: %s input [count [prefix]]\n"
+               "Decode count (default 100) evenly spaced keyframes of the first\n"
+               "video stream, print the time taken and, if a prefix is given,\n"
+               "write their luma planes to prefixNNN.pgm.\n", argv[0]);
+        return 1;
+    }
+    count = argc > 2 ? FFMAX(atoi(argv[2]), 1) : 100;
+
+    av_register_all();
+    if (av_open_input_file(&fmt, argv[1], NULL, 0, NULL) < 0 ||
+        av_find_stream_info(fmt) < 0) {
+        fprintf(stderr, "could not open %s\n", argv[1]);
+        return 1;
+    }
+    stream = av_find_best_stream(fmt, AVMEDIA_TYPE_VIDEO, -1, -1, &codec, 0);
+    if (stream < 0 || !codec) {
+        fprintf(stderr, "no decodable video stream in %s\n", argv[1]);
+        return 1;
+    }
+    st    = fmt->streams[stream];
+    avctx = st->codec;
+
+    avctx->skip_frame       = AVDISCARD_NONKEY;
+    avctx->skip_loop_filter = AVDISCARD_ALL;
+    avctx->lowres           = codec->max_lowres;
+    if (avcodec_open(avctx, codec) < 0) {
+        fprintf(stderr, "could not open the %s decoder\n", codec->name);
+        return 1;
+    }
+    frame = avcodec_alloc_frame();
+
+    if (st->duration != AV_NOPTS_VALUE)
+        duration = st->duration;
+    else
+        duration = av_rescale_q(fmt->duration, AV_TIME_BASE_Q, st->time_base);
+    if (duration <= 0) {
+        fprintf(stderr, "unknown duration\n");
+        return 1;
+    }
+
+    t = av_gettime();
+    for (i = 0; i < count; i++) {
+        int64_t ts = av_rescale(duration, 2 * i + 1, 2 * count);
+
+        if (st->start_time != AV_NOPTS_VALUE)
+            ts += st->start_time;
+        if (av_seek_frame(fmt, stream, ts, AVSEEK_FLAG_BACKWARD) < 0)
+            continue;
+        avcodec_flush_buffers(avctx);
+        if (!decode_one(fmt, avctx, stream, frame))
+            continue;
+        found++;
+        if (argc > 3)
+            write_pgm(argv[3], i, frame, avctx->width, avctx->height);
+    }
+    t = av_gettime() - t;
+
+    printf("%s: %d/%d thumbnails at %dx%d (lowres %d) in %.3f s, %.1f ms each\n",
+           argv[1], found, count, avctx->width, avctx->height, avctx->lowres,
+           t / 1e6, t / 1e3 / FFMAX(found, 1));
+
+    av_free(frame);
+    avcodec_close(avctx);
+    av_close_input_file(fmt);
+    return 0;
+}